@@ -0,0 +1,104 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+//
+// Micro benchmarks, run with the name of a benchmark or without
+// arguments to run all of them.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "tmln_time.hh"
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double
+elapsed_sec(const bench_clock::time_point& start)
+{
+	std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	return elapsed.count();
+}
+
+static void
+report(const char* name, size_t num, double sec, int64_t check)
+{
+	printf("%-24s %10.0f /s (%zu in %.3fs, check %lld)\n",
+	       name, num / sec, num, sec, static_cast<long long>(check));
+}
+
+static void
+bench_time_parse()
+{
+	const size_t num = 1000000;
+	std::vector<std::string> strs;
+	strs.reserve(num);
+	char buf[64];
+	for (size_t i = 0; i < num; i++) {
+		snprintf(buf, sizeof(buf),
+			 "2022-%02zu-%02zuT%02zu:%02zu:%02zu.%03zu",
+			 1 + i % 12, 1 + i % 28, i % 24, i % 60,
+			 (i / 60) % 60, i % 1000);
+		strs.push_back(buf);
+	}
+
+	int64_t check = 0;
+	bench_clock::time_point start = bench_clock::now();
+	for (const std::string& str : strs) {
+		check += tmln::Ts::parse_strptime(str.c_str()).ns();
+	}
+	report("time_parse strptime", num, elapsed_sec(start), check);
+
+	check = 0;
+	start = bench_clock::now();
+	for (const std::string& str : strs) {
+		tmln::Ts ts;
+		tmln::Ts::parse_iso8601(str.c_str(), str.size(), ts);
+		check += ts.ns();
+	}
+	report("time_parse iso8601", num, elapsed_sec(start), check);
+}
+
+struct Bench {
+	const char* name;
+	void (*fun)();
+};
+
+static const Bench BENCHMARKS[] = {
+	{"time_parse", bench_time_parse},
+	{nullptr, nullptr}
+};
+
+int
+main(int argc, char* argv[])
+{
+	for (const Bench* bench = BENCHMARKS; bench->name; bench++) {
+		if (argc < 2 || strcmp(argv[1], bench->name) == 0) {
+			bench->fun();
+		}
+	}
+	return 0;
+}
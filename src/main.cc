@@ -20,13 +20,34 @@
 // IN THE SOFTWARE.
 // 
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
-
-#include "tmln_draw_cairo.hh"
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tmln_data_columnar.hh"
+#include "tmln_decompress.hh"
+#include "tmln_file_input.hh"
+#include "tmln_follow_file.hh"
+#include "tmln_json_reader.hh"
+#include "tmln_live_input.hh"
+#include "tmln_load_async.hh"
+#include "tmln_load_chrome.hh"
+#include "tmln_load_csv.hh"
+#include "tmln_load_files.hh"
 #include "tmln_load_json.hh"
+#include "tmln_load_ninja.hh"
 #include "tmln_render.hh"
 #include "tmln_scale.hh"
 #include "tmln_selection.hh"
+#include "tmln_snapshot.hh"
 
 #ifdef HAVE_FLTK
 
@@ -41,7 +62,9 @@
 static void
 fltk_cb_quit(Fl_Widget *widget, void *data)
 {
-	exit(0);
+	// return from Fl::run, background loading is stopped before
+	// exiting
+	widget->window()->hide();
 }
 
 static void
@@ -60,6 +83,22 @@ fltk_cb_zoom_out(Fl_Widget *widget, void *data)
 
 static Fl_Output *output;
 
+/**
+ * Seconds between polls of a followed file or live input, caps the
+ * redraw rate.
+ */
+static const double FOLLOW_INTERVAL = 0.1;
+
+static std::function<size_t()> poll_input;
+
+static tmln::LoadAsync *load_async;
+/**
+ * size of the input loaded by load_async in bytes, 0 if unknown as for
+ * compressed input.
+ */
+static size_t load_size;
+static Fl_Button *btn_cancel;
+
 static void
 fltk_cb_info(Fl_Widget *widget, void *data)
 {
@@ -67,10 +106,65 @@ fltk_cb_info(Fl_Widget *widget, void *data)
 	output->value(timeline->info().c_str());
 }
 
+static void
+fltk_cb_follow(void *data)
+{
+	tmln::Fl_Timeline *timeline = static_cast<tmln::Fl_Timeline*>(data);
+	if (poll_input() > 0) {
+		timeline->update_data();
+	}
+	Fl::repeat_timeout(FOLLOW_INTERVAL, fltk_cb_follow, data);
+}
+
+static void
+fltk_cb_cancel(Fl_Widget *widget, void *data)
+{
+	load_async->cancel();
+}
+
+/**
+ * Add loaded events to the timeline and show progress until loading
+ * is done.
+ */
+static void
+fltk_cb_load(void *data)
+{
+	tmln::Fl_Timeline *timeline = static_cast<tmln::Fl_Timeline*>(data);
+	if (load_async->poll() > 0 || load_async->done()) {
+		timeline->update_data();
+	}
+
+	std::string info;
+	if (load_async->cancelled()) {
+		info = "loading cancelled";
+	} else if (load_async->done()) {
+		info = load_async->status() ? "loaded " : "failed to load all, ";
+		info += std::to_string(load_async->num_loaded()) + " events";
+	} else {
+		const size_t mib = 1024 * 1024;
+		info = "loading "
+			+ std::to_string(load_async->num_bytes() / mib);
+		if (load_size > 0) {
+			info += " of " + std::to_string(load_size / mib);
+		}
+		info += " MiB, " + std::to_string(load_async->num_loaded())
+			+ " events parsed";
+	}
+	output->value(info.c_str());
+
+	if (load_async->done()) {
+		btn_cancel->hide();
+	} else {
+		Fl::repeat_timeout(FOLLOW_INTERVAL, fltk_cb_load, data);
+	}
+}
+
 static int
 fltk_ui_main(int argc, char *argv[],
-	     const tmln::VectorData &data_store,
-	     tmln::Styles &styles)
+	     const tmln::Data &data_store,
+	     tmln::Styles &styles,
+	     std::function<size_t()> poll,
+	     tmln::LoadAsync *load, size_t size)
 {
 	const int width = 1600;
 	const int height = 800;
@@ -82,7 +176,12 @@ fltk_ui_main(int argc, char *argv[],
 
 	Fl_Group *btn_group = new Fl_Group(0, 0, width, 20);
 	Fl_Button *btn_quit = new Fl_Button(0, 0, 50, 20, "Quit");
-	output = new Fl_Output(50, 0, width - 150, 20);
+	int output_width = width - 150 - (load != nullptr ? 60 : 0);
+	output = new Fl_Output(50, 0, output_width, 20);
+	if (load != nullptr) {
+		btn_cancel = new Fl_Button(50 + output_width, 0, 60, 20,
+					   "Cancel");
+	}
 	Fl_Button *btn_zoomo = new Fl_Button(width - 100, 0, 50, 20, "-");
 	Fl_Button *btn_zoomi = new Fl_Button(width - 50, 0, 50, 20, "+");
 	btn_group->resizable(output);
@@ -101,6 +200,16 @@ fltk_ui_main(int argc, char *argv[],
 	btn_zoomo->callback(fltk_cb_zoom_out, timeline);
 	btn_zoomi->callback(fltk_cb_zoom_in, timeline);
 	timeline->callback(fltk_cb_info, timeline);
+	if (poll) {
+		poll_input = poll;
+		Fl::add_timeout(FOLLOW_INTERVAL, fltk_cb_follow, timeline);
+	}
+	if (load != nullptr) {
+		load_async = load;
+		load_size = size;
+		btn_cancel->callback(fltk_cb_cancel, nullptr);
+		Fl::add_timeout(0, fltk_cb_load, timeline);
+	}
 
 	window->show(argc, argv);
 	return Fl::run();
@@ -110,8 +219,10 @@ fltk_ui_main(int argc, char *argv[],
 
 static int
 fltk_ui_main(int argc, char *argv[],
-	     const tmln::VectorData &data_store,
-	     tmln::Styles &styles)
+	     const tmln::Data &data_store,
+	     tmln::Styles &styles,
+	     std::function<size_t()> poll,
+	     tmln::LoadAsync *load, size_t size)
 {
 	std::cerr << "error: FLTK support not compiled in" << std::endl;
 	return 1;
@@ -125,13 +236,12 @@ fltk_ui_main(int argc, char *argv[],
 #include "tmln_draw_cairo.hh"
 
 static int
-cairo_render(int argc, char *argv[],
-	     const tmln::VectorData &data_store,
+cairo_render(const std::string& output_path,
+	     const tmln::Data &data_store,
 	     tmln::Styles &styles)
 {
 	const int width = 1600;
 	const int height = 800;
-	std::string output_path = argc  > 3 ? argv[3] : "render.png";
 
 	tmln::Scale scale(data_store.span(), data_store.size(), 0, 0);
 	tmln::NumTimeSelection data_sel(data_store, scale.num_events(),
@@ -150,8 +260,8 @@ cairo_render(int argc, char *argv[],
 
 
 static int
-cairo_render(int argc, char *argv[],
-	     const tmln::VectorData &data_store,
+cairo_render(const std::string& output_path,
+	     const tmln::Data &data_store,
 	     tmln::Styles &styles)
 {
 	std::cerr << "error: Cairo support not compiled in" << std::endl;
@@ -163,11 +273,316 @@ cairo_render(int argc, char *argv[],
 static int
 usage(const char *name)
 {
-	std::cout << name << ": [ui|render] data.json (output.png)"
-		  << std::endl;
+	std::cout << name << ": [ui|render|snapshot] data.json|data.tmlnb "
+		  << "(output.png|output.tmlnb)" << std::endl;
+	std::cout << name << ": [ui|render|snapshot] data.json|dir|'*.json' "
+		  << "... (output.png|output.tmlnb)" << std::endl;
+	std::cout << "  options before inputs: --offset path=2.5ms "
+		  << "--align marker-label" << std::endl;
+	std::cout << name << ": ui --follow data.ndjson" << std::endl;
+	std::cout << name << ": ui -|--listen /path/sock" << std::endl;
 	return 1;
 }
 
+static bool
+has_suffix(const std::string& str, const std::string& suffix)
+{
+	return str.size() >= suffix.size()
+		&& str.compare(str.size() - suffix.size(), suffix.size(),
+			       suffix) == 0;
+}
+
+static bool
+is_delimited(const std::string& path)
+{
+	return has_suffix(path, ".csv") || has_suffix(path, ".tsv");
+}
+
+static bool
+is_ndjson(const std::string& path)
+{
+	return has_suffix(path, ".ndjson") || has_suffix(path, ".jsonl");
+}
+
+/**
+ * Load data from buffer, the format is detected from the suffix of
+ * name for delimited text and NDJSON and from the content otherwise.
+ */
+static bool
+load_buffer(const std::string& name, const char* buf, size_t size,
+	    tmln::Data& data, tmln::Styles& styles)
+{
+	if (is_delimited(name)) {
+		tmln::LoadCsv csv(data, styles);
+		return csv.load(buf, size);
+	} else if (is_ndjson(name)) {
+		tmln::LoadJson json(data, styles);
+		return json.load_ndjson(buf, size);
+	} else if (tmln::LoadNinja::is_ninja_log(buf, size)) {
+		tmln::LoadNinja ninja(data, styles);
+		return ninja.load(buf, size);
+	} else if (tmln::LoadChrome::is_chrome_trace(buf, size)) {
+		tmln::LoadChrome chrome(data, styles);
+		return chrome.load(buf, size);
+	}
+	tmln::LoadJson json(data, styles);
+	return json.load(buf, size);
+}
+
+/**
+ * Load compressed input, parsed as it is decompressed. Line based
+ * formats are read in blocks of whole lines.
+ */
+static bool
+load_compressed(const std::string& path, const tmln::FileInput& input,
+		tmln::DecompressInput::Format format,
+		tmln::Data& data, tmln::Styles& styles)
+{
+	if (! tmln::DecompressInput::is_supported(format)) {
+		std::cerr << "error: compression of " << path
+			  << " is not supported" << std::endl;
+		return false;
+	}
+
+	std::string name(path, 0, path.rfind('.'));
+	tmln::DecompressInput decompress(input.data(), input.size(), format);
+	const char* head = "";
+	size_t head_size = 0;
+	decompress.peek(head, head_size);
+
+	bool status;
+	std::istream is(&decompress);
+	if (is_delimited(name)) {
+		tmln::LoadCsv csv(data, styles);
+		status = csv.load(is);
+	} else if (is_ndjson(name)) {
+		tmln::LoadJson json(data, styles);
+		status = json.load_ndjson(is);
+	} else if (tmln::LoadNinja::is_ninja_log(head, head_size)) {
+		tmln::LoadNinja ninja(data, styles);
+		status = ninja.load(is);
+	} else {
+		tmln::JsonReader reader(is);
+		if (tmln::LoadChrome::is_chrome_trace(head, head_size)) {
+			tmln::LoadChrome chrome(data, styles);
+			status = chrome.load(reader);
+		} else {
+			tmln::LoadJson json(data, styles);
+			status = json.load(reader);
+		}
+	}
+	return decompress.status() && status;
+}
+
+/**
+ * Load data from path, gzip and zstd compressed files are detected
+ * and decompressed while loading.
+ */
+static bool
+load_file(const std::string& path, tmln::Data& data, tmln::Styles& styles)
+{
+	tmln::FileInput input;
+	if (! input.open(path)) {
+		return false;
+	}
+
+	tmln::DecompressInput::Format format =
+		tmln::DecompressInput::detect(input.data(), input.size());
+	if (format != tmln::DecompressInput::FORMAT_NONE) {
+		return load_compressed(path, input, format, data, styles);
+	}
+	return load_buffer(path, input.data(), input.size(), data, styles);
+}
+
+/**
+ * Add regular files in directory path to paths, in name order and
+ * skipping hidden files.
+ */
+static bool
+expand_dir(const std::string& path, std::vector<std::string>& paths)
+{
+	DIR* dir = opendir(path.c_str());
+	if (dir == nullptr) {
+		return false;
+	}
+
+	std::vector<std::string> names;
+	struct dirent* ent;
+	while ((ent = readdir(dir)) != nullptr) {
+		if (ent->d_name[0] == '.') {
+			continue;
+		}
+		std::string name = path + "/" + ent->d_name;
+		struct stat st;
+		if (stat(name.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+			names.push_back(name);
+		}
+	}
+	closedir(dir);
+
+	std::sort(names.begin(), names.end());
+	paths.insert(paths.end(), names.begin(), names.end());
+	return true;
+}
+
+/**
+ * Expand input arguments to paths, directories are expanded to the
+ * files in them and arguments with glob characters, not expanded by
+ * the shell, to the matching files.
+ */
+static bool
+expand_inputs(const std::vector<std::string>& args,
+	      std::vector<std::string>& paths)
+{
+	for (const std::string& arg : args) {
+		struct stat st;
+		if (stat(arg.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+			if (! expand_dir(arg, paths)) {
+				std::cerr << "error: failed to read directory "
+					  << arg << std::endl;
+				return false;
+			}
+		} else if (arg.find_first_of("*?[") != std::string::npos) {
+			glob_t gl;
+			if (glob(arg.c_str(), 0, nullptr, &gl) != 0) {
+				std::cerr << "error: no files matching "
+					  << arg << std::endl;
+				return false;
+			}
+			for (size_t i = 0; i < gl.gl_pathc; i++) {
+				paths.push_back(gl.gl_pathv[i]);
+			}
+			globfree(&gl);
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	return true;
+}
+
+/**
+ * Parse clock offset of a file, path=offset where offset is a number
+ * with an optional s, ms, us or ns unit suffix, seconds by default.
+ */
+static bool
+parse_offset(const std::string& arg, std::string& path, tmln::Ts& offset)
+{
+	size_t sep = arg.rfind('=');
+	if (sep == std::string::npos || sep == 0) {
+		return false;
+	}
+	path = arg.substr(0, sep);
+	std::string value = arg.substr(sep + 1);
+
+	int64_t unit_ns = tmln::NSEC_PER_SEC;
+	size_t suffix = 0;
+	if (has_suffix(value, "ns")) {
+		unit_ns = 1;
+		suffix = 2;
+	} else if (has_suffix(value, "us")) {
+		unit_ns = 1000;
+		suffix = 2;
+	} else if (has_suffix(value, "ms")) {
+		unit_ns = 1000000;
+		suffix = 2;
+	} else if (has_suffix(value, "s")) {
+		suffix = 1;
+	}
+	// the number must be all of the value before the suffix
+	value.resize(value.size() - suffix);
+	return tmln::Ts::parse_number(value.c_str(), unit_ns, offset);
+}
+
+/**
+ * Create data store for paths, snapshots are opened directly and can
+ * not be combined with other inputs.
+ */
+static tmln::Data*
+open_inputs(const std::vector<std::string>& paths, tmln::Styles& styles)
+{
+	if (paths.size() == 1 && has_suffix(paths[0], ".tmlnb")) {
+		tmln::MmapData *mmap_data = new tmln::MmapData(paths[0], styles);
+		if (! mmap_data->is_open()) {
+			std::cerr << "error: failed to open snapshot "
+				  << paths[0] << std::endl;
+			delete mmap_data;
+			return nullptr;
+		}
+		return mmap_data;
+	}
+
+	std::string source;
+	for (const std::string& path : paths) {
+		if (has_suffix(path, ".tmlnb")) {
+			std::cerr << "error: snapshot " << path
+				  << " can not be merged with other inputs"
+				  << std::endl;
+			return nullptr;
+		}
+		source += source.empty() ? path : " " + path;
+	}
+	return new tmln::ColumnarData(source,
+				      tmln::ColumnarData::STEP_COMPACT,
+				      &styles);
+}
+
+/**
+ * Load paths into data, more than one path, or paths with clock
+ * offsets, are loaded in parallel and merged with each file as a
+ * source.
+ */
+static bool
+load_inputs(const std::vector<std::string>& paths,
+	    tmln::Data& data, tmln::Styles& styles,
+	    const std::map<std::string, tmln::Ts>& offsets,
+	    const std::string& align_marker)
+{
+	if (paths.size() == 1 && offsets.empty()) {
+		if (! load_file(paths[0], data, styles)) {
+			std::cerr << "warning: failed to load all of "
+				  << paths[0] << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	tmln::LoadFiles files(data, styles, load_file);
+	for (const auto& it : offsets) {
+		files.set_offset(it.first, it.second);
+	}
+	files.set_align_marker(align_marker);
+	if (! files.load(paths)) {
+		for (const std::string& path : files.failed()) {
+			std::cerr << "warning: failed to load all of "
+				  << path << std::endl;
+		}
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Total size of the files at paths, 0 if any of them is compressed as
+ * loaders report progress in bytes of decompressed input.
+ */
+static size_t
+inputs_size(const std::vector<std::string>& paths)
+{
+	size_t size = 0;
+	for (const std::string& path : paths) {
+		tmln::FileInput input;
+		if (! input.open(path)) {
+			continue;
+		} else if (tmln::DecompressInput::detect(input.data(),
+							 input.size())
+			   != tmln::DecompressInput::FORMAT_NONE) {
+			return 0;
+		}
+		size += input.size();
+	}
+	return size;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -176,19 +591,144 @@ main(int argc, char *argv[])
 	}
 
 	std::string mode(argv[1]);
-	std::string data_path(argv[2]);
-	if (mode != "ui" && mode != "render") {
+	bool follow = mode == "ui" && std::string(argv[2]) == "--follow";
+	bool listen = mode == "ui" && std::string(argv[2]) == "--listen";
+	if (mode != "ui" && mode != "render" && mode != "snapshot") {
+		return usage(argv[0]);
+	}
+	if ((mode == "snapshot" || follow || listen) && argc < 4) {
+		return usage(argv[0]);
+	}
+
+	int inputs_begin = 2;
+	std::map<std::string, tmln::Ts> offsets;
+	std::string align_marker;
+	while (! follow && ! listen && inputs_begin + 1 < argc) {
+		std::string opt(argv[inputs_begin]);
+		if (opt == "--offset") {
+			std::string path;
+			tmln::Ts offset;
+			if (! parse_offset(argv[inputs_begin + 1], path,
+					   offset)) {
+				std::cerr << "error: invalid offset "
+					  << argv[inputs_begin + 1]
+					  << std::endl;
+				return 1;
+			}
+			offsets[path] = offset;
+		} else if (opt == "--align") {
+			align_marker = argv[inputs_begin + 1];
+		} else {
+			break;
+		}
+		inputs_begin += 2;
+	}
+
+	// inputs are followed by the output, or options to FLTK for ui
+	int inputs_end = argc;
+	std::string output_path;
+	if (follow || listen) {
+		inputs_end = 4;
+	} else if (mode == "ui") {
+		for (inputs_end = inputs_begin; inputs_end < argc;
+		     inputs_end++) {
+			if (argv[inputs_end][0] == '-'
+			    && argv[inputs_end][1] != '\0') {
+				break;
+			}
+		}
+	} else if (mode == "snapshot") {
+		output_path = argv[--inputs_end];
+	} else if (argc > inputs_begin + 1
+		   && has_suffix(argv[argc - 1], ".png")) {
+		output_path = argv[--inputs_end];
+	} else {
+		output_path = "render.png";
+	}
+	if (inputs_end <= inputs_begin) {
 		return usage(argv[0]);
 	}
 
-	tmln::VectorData data_store(data_path);
 	tmln::Styles styles;
-	tmln::LoadJson json(data_store, styles);
-	json.load_file(data_path);
+	std::unique_ptr<tmln::Data> data_store;
+	std::unique_ptr<tmln::FollowFile> follow_file;
+	std::unique_ptr<tmln::LiveInput> live_input;
+	std::unique_ptr<tmln::LoadAsync> loader;
+	size_t loader_size = 0;
+	std::function<size_t()> poll;
+	bool stdin_input = mode == "ui" && inputs_end == inputs_begin + 1
+		&& std::string(argv[inputs_begin]) == "-";
+	if (listen || stdin_input) {
+		std::string source(stdin_input ? "-" : argv[3]);
+		data_store.reset(new tmln::ColumnarData(
+			source, tmln::ColumnarData::STEP_COMPACT, &styles));
+		data_store->finalize();
+		live_input.reset(new tmln::LiveInput(*data_store, styles));
+		bool status = stdin_input
+			? live_input->open_fd(STDIN_FILENO)
+			: live_input->listen(source);
+		if (! status || ! live_input->start()) {
+			std::cerr << "error: failed to read from " << source
+				  << std::endl;
+			return 1;
+		}
+		poll = [&live_input]() { return live_input->poll(); };
+	} else if (follow) {
+		std::string data_path(argv[3]);
+		data_store.reset(new tmln::ColumnarData(
+			data_path, tmln::ColumnarData::STEP_COMPACT,
+			&styles));
+		follow_file.reset(new tmln::FollowFile(*data_store, styles));
+		if (! follow_file->open(data_path)) {
+			std::cerr << "error: failed to open " << data_path
+				  << std::endl;
+			return 1;
+		}
+		poll = [&follow_file]() { return follow_file->poll(); };
+	} else {
+		std::vector<std::string> paths;
+		if (! expand_inputs(std::vector<std::string>(
+					    argv + inputs_begin,
+					    argv + inputs_end),
+				    paths)) {
+			return 1;
+		}
+		if (paths.empty()) {
+			return usage(argv[0]);
+		}
+		data_store.reset(open_inputs(paths, styles));
+		if (! data_store) {
+			return 1;
+		}
+
+		bool is_snapshot = paths.size() == 1
+			&& has_suffix(paths[0], ".tmlnb");
+		if (mode == "ui" && ! is_snapshot) {
+			// the window opens right away, events are added as
+			// they are loaded
+			loader.reset(new tmln::LoadAsync(*data_store, styles));
+			loader->start([paths, offsets, align_marker](
+					      tmln::Data& data,
+					      tmln::Styles& styles) {
+				return load_inputs(paths, data, styles,
+						   offsets, align_marker);
+			});
+			loader_size = inputs_size(paths);
+		} else if (! is_snapshot) {
+			load_inputs(paths, *data_store, styles, offsets,
+				    align_marker);
+		}
+	}
 
 	if (mode == "ui") {
-		return fltk_ui_main(argc - 3, argv + 3, data_store, styles);
+		// argv[0] of the FLTK arguments is the last input
+		return fltk_ui_main(argc - inputs_end + 1,
+				    argv + inputs_end - 1,
+				    *data_store, styles, poll,
+				    loader.get(), loader_size);
+	} else if (mode == "render") {
+		return cairo_render(output_path, *data_store, styles);
 	} else {
-		return cairo_render(argc, argv, data_store, styles);
+		return tmln::write_snapshot(*data_store, output_path) ? 0 : 1;
 	}
 }
@@ -0,0 +1,160 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "tmln_arena.hh"
+
+const size_t tmln::Arena::BLOCK_SIZE;
+const size_t tmln::Arena::NUM_CLASSES;
+
+tmln::Arena::Arena(size_t block_size)
+	: _block_size(block_size),
+	  _pos(nullptr),
+	  _end(nullptr),
+	  _size(0)
+{
+	for (size_t i = 0; i < NUM_CLASSES; i++) {
+		_free[i] = nullptr;
+	}
+}
+
+tmln::Arena::~Arena()
+{
+	std::vector<void*>::iterator it = _blocks.begin();
+	for (; it != _blocks.end(); ++it) {
+		::free(*it);
+	}
+	large_map::iterator large = _large.begin();
+	for (; large != _large.end(); ++large) {
+		::free(large->second.first);
+	}
+}
+
+/**
+ * Allocate size bytes aligned to align, which must be a power of two.
+ */
+void*
+tmln::Arena::alloc(size_t size, size_t align)
+{
+	if (is_large(size)) {
+		// large allocation, give it a block of its own to not
+		// waste the remains of the current block.
+		void* block = ::malloc(size + align);
+		if (block == nullptr) {
+			throw std::bad_alloc();
+		}
+		_size += size + align;
+		uintptr_t start = reinterpret_cast<uintptr_t>(block);
+		start = (start + align - 1) & ~(uintptr_t(align) - 1);
+		_large.emplace(reinterpret_cast<void*>(start),
+			       std::make_pair(block, size + align));
+		return reinterpret_cast<void*>(start);
+	}
+
+	size_t cls = size_class(size);
+	void* ptr = _free[cls];
+	if (ptr != nullptr && reinterpret_cast<uintptr_t>(ptr) % align == 0) {
+		_free[cls] = *static_cast<void**>(ptr);
+		return ptr;
+	}
+
+	size = class_size(cls);
+	uintptr_t pos = reinterpret_cast<uintptr_t>(_pos);
+	uintptr_t aligned = (pos + align - 1) & ~(uintptr_t(align) - 1);
+	if (_pos == nullptr
+	    || aligned + size > reinterpret_cast<uintptr_t>(_end)) {
+		_pos = static_cast<char*>(alloc_block(_block_size));
+		_end = _pos + _block_size;
+		pos = reinterpret_cast<uintptr_t>(_pos);
+		aligned = (pos + align - 1) & ~(uintptr_t(align) - 1);
+	}
+	_pos = reinterpret_cast<char*>(aligned + size);
+	return reinterpret_cast<void*>(aligned);
+}
+
+/**
+ * Return size bytes at ptr, allocated with alloc, to the arena. Large
+ * allocations are freed, others are reused by allocations of the same
+ * size class.
+ */
+void
+tmln::Arena::free(void* ptr, size_t size)
+{
+	if (is_large(size)) {
+		large_map::iterator large = _large.find(ptr);
+		if (large != _large.end()) {
+			::free(large->second.first);
+			_size -= large->second.second;
+			_large.erase(large);
+		}
+		return;
+	}
+
+	void*& head = _free[size_class(size)];
+	*static_cast<void**>(ptr) = head;
+	head = ptr;
+}
+
+/**
+ * Size class of size, 8 byte steps up to 512 bytes and four classes
+ * per power of two above.
+ */
+size_t
+tmln::Arena::size_class(size_t size)
+{
+	if (size <= 512) {
+		return size == 0 ? 0 : (size - 1) / 8;
+	}
+	size_t bits = 0;
+	for (size_t val = size - 1; val > 1; val >>= 1) {
+		bits++;
+	}
+	return 64 + (bits - 9) * 4 + (((size - 1) >> (bits - 2)) & 3);
+}
+
+/**
+ * Largest size in size class cls.
+ */
+size_t
+tmln::Arena::class_size(size_t cls)
+{
+	if (cls < 64) {
+		return (cls + 1) * 8;
+	}
+	size_t bits = 9 + (cls - 64) / 4;
+	return (4 + (cls - 64) % 4 + 1) << (bits - 2);
+}
+
+void*
+tmln::Arena::alloc_block(size_t size)
+{
+	void* block = ::malloc(size);
+	if (block == nullptr) {
+		throw std::bad_alloc();
+	}
+	_blocks.push_back(block);
+	_size += size;
+	return block;
+}
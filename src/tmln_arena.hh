@@ -0,0 +1,160 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_ARENA_HH_
+#define _TMLN_ARENA_HH_
+
+#include "config.h"
+
+#include <cstddef>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tmln {
+
+	/**
+	 * Bump allocator handing out memory from large blocks, freed in
+	 * one go when the arena is destroyed. Destructors of objects
+	 * placed in the arena are not run.
+	 *
+	 * Allocation sizes are rounded up to a size class, 8 byte steps
+	 * up to 512 bytes and four classes per power of two above that.
+	 * Memory returned with free is kept in a free list per class and
+	 * reused by allocations of the same class, large allocations are
+	 * returned to the system. This keeps outgrown buffers of growing
+	 * containers from piling up in the arena.
+	 *
+	 * An arena is not thread-safe, like the Data owning it, it must
+	 * only be used by one thread at a time.
+	 */
+	class Arena {
+	public:
+		static const size_t BLOCK_SIZE = 1024 * 1024;
+		/** Number of size classes, enough for any size_t. */
+		static const size_t NUM_CLASSES = 64 + 4 * (64 - 9);
+
+		Arena(size_t block_size = BLOCK_SIZE);
+		Arena(const Arena&) = delete;
+		~Arena();
+
+		Arena& operator=(const Arena&) = delete;
+
+		/** Number of bytes allocated from the system. */
+		size_t size() const { return _size; }
+
+		void* alloc(size_t size, size_t align = alignof(std::max_align_t));
+		void free(void* ptr, size_t size);
+
+	private:
+		typedef std::unordered_map<void*, std::pair<void*, size_t>>
+			large_map;
+
+		static size_t size_class(size_t size);
+		static size_t class_size(size_t cls);
+
+		/**
+		 * Allocations larger than this get a block of their own,
+		 * decided on size alone so free does not have to look up
+		 * the address.
+		 */
+		bool is_large(size_t size) const
+		{
+			return size > _block_size / 8;
+		}
+		void* alloc_block(size_t size);
+
+	private:
+		size_t _block_size;
+		char* _pos;
+		char* _end;
+		size_t _size;
+		std::vector<void*> _blocks;
+		/** large allocations by address, with block and size. */
+		large_map _large;
+		/** head of the free list for each size class. */
+		void* _free[NUM_CLASSES];
+	};
+
+	/**
+	 * Standard library allocator using an Arena, deallocated memory is
+	 * returned to the arena for reuse. Without an arena memory is
+	 * allocated with operator new.
+	 */
+	template<typename T>
+	class ArenaAllocator {
+	public:
+		typedef T value_type;
+
+		ArenaAllocator(Arena* arena = nullptr)
+			: _arena(arena)
+		{
+		}
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& alloc)
+			: _arena(alloc.arena())
+		{
+		}
+
+		Arena* arena() const { return _arena; }
+
+		T* allocate(size_t n)
+		{
+			if (_arena == nullptr) {
+				return static_cast<T*>(
+					::operator new(n * sizeof(T)));
+			}
+			return static_cast<T*>(
+				_arena->alloc(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* ptr, size_t n)
+		{
+			if (_arena == nullptr) {
+				::operator delete(ptr);
+			} else {
+				_arena->free(ptr, n * sizeof(T));
+			}
+		}
+
+	private:
+		Arena* _arena;
+	};
+
+	template<typename T, typename U>
+	bool operator==(const ArenaAllocator<T>& lhs,
+			const ArenaAllocator<U>& rhs)
+	{
+		return lhs.arena() == rhs.arena();
+	}
+
+	template<typename T, typename U>
+	bool operator!=(const ArenaAllocator<T>& lhs,
+			const ArenaAllocator<U>& rhs)
+	{
+		return lhs.arena() != rhs.arena();
+	}
+}
+
+#endif // _TMLN_ARENA_HH_
@@ -20,20 +20,28 @@
 // IN THE SOFTWARE.
 // 
 
+#include <cassert>
+
 #include "tmln_data.hh"
+#include "tmln_data_columnar.hh"
+#include "tmln_sort.hh"
 
 // EventStep
 
-tmln::EventStep::EventStep(const std::string& label, const std::string& info,
+tmln::EventStep::EventStep(StrRef label, StrRef info,
 			   const Ts& start, const Ts& end, const Style& style)
-	: _label(label),
+	: _strings(label.pool()),
+	  _label(label.id()),
+	  _info(info.id()),
 	  _span(start, end),
-	  _style(style)
+	  _style(&style)
 {
+	assert(info.pool() == _strings);
 }
 
 tmln::EventStep::EventStep(const EventStep& event)
-	: _label(event._label),
+	: _strings(event._strings),
+	  _label(event._label),
 	  _info(event._info),
 	  _span(event._span),
 	  _style(event._style)
@@ -44,32 +52,68 @@ tmln::EventStep::~EventStep()
 {
 }
 
+/**
+ * Steps with strings in the same pool compare string ids, steps from
+ * different pools compare the strings.
+ */
 bool
 tmln::operator==(const EventStep& lhs, const EventStep& rhs)
 {
-	return lhs.label() == rhs.label()
-		&& lhs.info() == rhs.info()
+	return lhs.label_ref() == rhs.label_ref()
+		&& lhs.info_ref() == rhs.info_ref()
 		&& lhs.span() == rhs.span()
 		&& lhs.style() == rhs.style();
 }
 
 // Event
 
-tmln::Event::Event(const std::string& label, const std::string& info,
-		   const Ts& start, const Ts& end, const Style& style)
-	: _label(label),
-	  _info(info),
+tmln::Event::Event(StrRef label, StrRef info,
+		   const Ts& start, const Ts& end, const Style& style,
+		   Arena* arena)
+	: _strings(label.pool()),
+	  _label(label.id()),
+	  _info(info.id()),
 	  _span(start, end),
-	  _style(style)
+	  _style(&style),
+	  _steps(step_vector::allocator_type(arena))
 {
+	assert(info.pool() == _strings);
 }
 
+/**
+ * Copy event with steps allocated using operator new, a copy does not
+ * keep the arena of event alive and may outlive its data store.
+ */
 tmln::Event::Event(const Event &event)
-	: _label(event._label),
+	: _strings(event._strings),
+	  _label(event._label),
+	  _info(event._info),
+	  _span(event._span),
+	  _style(event._style),
+	  _steps(event._steps, step_vector::allocator_type())
+{
+}
+
+/**
+ * Copy event with steps allocated from arena.
+ */
+tmln::Event::Event(const Event &event, Arena* arena)
+	: _strings(event._strings),
+	  _label(event._label),
 	  _info(event._info),
 	  _span(event._span),
 	  _style(event._style),
-	  _steps(event._steps)
+	  _steps(event._steps, step_vector::allocator_type(arena))
+{
+}
+
+tmln::Event::Event(Event&& event) noexcept
+	: _strings(event._strings),
+	  _label(event._label),
+	  _info(event._info),
+	  _span(event._span),
+	  _style(event._style),
+	  _steps(std::move(event._steps))
 {
 }
 
@@ -77,27 +121,106 @@ tmln::Event::~Event()
 {
 }
 
+tmln::Event&
+tmln::Event::operator=(const Event& event)
+{
+	_strings = event._strings;
+	_label = event._label;
+	_info = event._info;
+	_span = event._span;
+	_style = event._style;
+	_steps = event._steps;
+	return *this;
+}
+
+tmln::Event&
+tmln::Event::operator=(Event&& event) noexcept
+{
+	_strings = event._strings;
+	_label = event._label;
+	_info = event._info;
+	_span = event._span;
+	_style = event._style;
+	_steps = std::move(event._steps);
+	return *this;
+}
+
 void
-tmln::Event::add_step(const std::string& label, const std::string& info,
+tmln::Event::add_step(StrRef label, StrRef info,
 		      const Ts& start, const Ts& end, const Style& style)
 {
-	_steps.emplace_back(EventStep(label, info, start, end, style));
+	_steps.emplace_back(label, info, start, end, style);
 }
 
+/**
+ * Compare events as for EventStep.
+ */
 bool
 tmln::operator==(const Event& lhs, const Event& rhs)
 {
-	return lhs.label() == rhs.label()
-		&& lhs.info() == rhs.info()
+	return lhs.label_ref() == rhs.label_ref()
+		&& lhs.info_ref() == rhs.info_ref()
 		&& lhs.span() == rhs.span()
 		&& lhs.style() == rhs.style()
 		&& lhs.steps() == rhs.steps();
 }
 
+// StepDecoder
+
+tmln::StepDecoder::~StepDecoder()
+{
+}
+
+// EventBuilder
+
+tmln::EventBuilder::EventBuilder()
+	: _data(nullptr),
+	  _idx(0)
+{
+}
+
+tmln::EventBuilder::EventBuilder(Data* data, size_t idx)
+	: _data(data),
+	  _idx(idx)
+{
+}
+
+tmln::EventBuilder::~EventBuilder()
+{
+}
+
+bool
+tmln::EventBuilder::add_step(StrRef label, StrRef info,
+			     const Ts& start, const Ts& end, const Style& style)
+{
+	if (_data == nullptr) {
+		return false;
+	}
+	return _data->emplace_step(_idx, label, info, start, end, style);
+}
+
+/**
+ * Add the steps of the event as data parsed by decoder when the event
+ * is accessed, with offset added to their timestamps. Returns false if
+ * the data does not keep unparsed steps.
+ */
+bool
+tmln::EventBuilder::add_raw_steps(
+	const std::shared_ptr<const StepDecoder>& decoder,
+	const char* data, size_t size, const Ts& offset)
+{
+	if (_data == nullptr) {
+		return false;
+	}
+	return _data->emplace_raw_steps(_idx, decoder, data, size, offset);
+}
+
 // Data
 
 tmln::Data::Data(const std::string& source)
-	: _source(source)
+	: _source(source),
+	  _sources(1, source),
+	  _strings(&_arena)
 {
 }
 
@@ -105,11 +228,55 @@ tmln::Data::~Data()
 {
 }
 
+/**
+ * Drop the interval index, events may have been reordered. The index
+ * is built on first use, data only used to load events into another
+ * data store never builds it.
+ */
+void
+tmln::Data::finalize()
+{
+	_interval_index.clear();
+}
+
+/**
+ * Add source, returns the index of the source in sources().
+ */
+size_t
+tmln::Data::add_source(const std::string& source)
+{
+	_sources.push_back(source);
+	return _sources.size() - 1;
+}
+
+/**
+ * Append events by emplacing them one at a time, with mapped strings
+ * instead of interning every label.
+ */
+bool
+tmln::Data::append(const ColumnarData& src, size_t begin, size_t end,
+		   const IdMap& map, const Ts& offset)
+{
+	return src.copy_events(*this, begin, end, map, offset);
+}
+
+const tmln::IntervalIndex&
+tmln::Data::interval_index() const
+{
+	if (_interval_index.size() == 0) {
+		_interval_index.build(*this);
+	} else if (_interval_index.size() != size()) {
+		_interval_index.update(*this);
+	}
+	return _interval_index;
+}
+
 // VectorData
 
 tmln::VectorData::VectorData(const std::string& source)
 	: Data(source),
-	  _span(Ts(0, 0), Ts(0, 0))
+	  _span(Ts(0, 0), Ts(0, 0)),
+	  _data(event_vector::allocator_type(&arena()))
 {
 }
 
@@ -126,11 +293,105 @@ tmln::VectorData::operator[](size_t idx) const
 bool
 tmln::VectorData::add_event(const Event &event)
 {
-	_data.push_back(event);
-	if (_data.size() == 1) {
-		_span = event.span();
-	} else {
-		_span.set_end(event.end());
+	_data.push_back(Event(event, &arena()));
+	update_span(event.span());
+	return true;
+}
+
+bool
+tmln::VectorData::add_event(Event&& event)
+{
+	if (event.steps().get_allocator().arena() != &arena()) {
+		return add_event(static_cast<const Event&>(event));
 	}
+	TsSpan span = event.span();
+	_data.push_back(std::move(event));
+	update_span(span);
+	return true;
+}
+
+tmln::EventBuilder
+tmln::VectorData::emplace_event(StrRef label,
+				StrRef info,
+				const Ts& start, const Ts& end,
+				const Style& style)
+{
+	_data.emplace_back(label, info, start, end, style, &arena());
+	update_span(_data.back().span());
+	return EventBuilder(this, _data.size() - 1);
+}
+
+bool
+tmln::VectorData::emplace_step(size_t idx,
+			       StrRef label, StrRef info,
+			       const Ts& start, const Ts& end,
+			       const Style& style)
+{
+	_data[idx].add_step(label, info, start, end, style);
 	return true;
 }
+
+/**
+ * Sort events by start, keeping the order of events with the same
+ * start.
+ */
+void
+tmln::VectorData::finalize()
+{
+	std::vector<std::pair<Ts, size_t>> order;
+	order.reserve(_data.size());
+	bool sorted = true;
+	for (size_t i = 0; i < _data.size(); i++) {
+		order.push_back(std::make_pair(_data[i].start(), i));
+		if (i > 0 && order[i].first < order[i - 1].first) {
+			sorted = false;
+		}
+	}
+
+	if (! sorted) {
+		parallel_sort(order.begin(), order.end(),
+			      [](const std::pair<Ts, size_t>& lhs,
+				 const std::pair<Ts, size_t>& rhs) {
+				      return lhs.first < rhs.first;
+			      });
+
+		// apply the permutation following each cycle, order[i]
+		// is set to i once event i is in place.
+		for (size_t i = 0; i < order.size(); i++) {
+			if (order[i].second == i) {
+				continue;
+			}
+			Event event(std::move(_data[i]));
+			size_t pos = i;
+			while (order[pos].second != i) {
+				size_t from = order[pos].second;
+				_data[pos] = std::move(_data[from]);
+				order[pos].second = pos;
+				pos = from;
+			}
+			_data[pos] = std::move(event);
+			order[pos].second = pos;
+		}
+	}
+
+	Data::finalize();
+}
+
+/**
+ * Extend span to include span, events are not required to be added in
+ * start order.
+ */
+void
+tmln::VectorData::update_span(const TsSpan& span)
+{
+	if (_data.size() == 1) {
+		_span = span;
+		return;
+	}
+	if (span.start() < _span.start()) {
+		_span.set_start(span.start());
+	}
+	if (span.end() > _span.end()) {
+		_span.set_end(span.end());
+	}
+}
@@ -25,79 +25,166 @@
 
 #include "config.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "tmln_arena.hh"
+#include "tmln_interval_index.hh"
+#include "tmln_string_pool.hh"
 #include "tmln_time.hh"
 #include "tmln_style.hh"
 
 namespace tmln {
 
 	/**
-	 * Step of Event.
+	 * Step of Event, label and info are ids of strings interned in
+	 * the StringPool of the Data the step belongs to. Both must be
+	 * interned in the same pool.
 	 */
 	class EventStep {
 	public:
-		EventStep(const std::string& label, const std::string& info,
+		EventStep(StrRef label, StrRef info,
 			  const Ts& start, const Ts& end,
 			  const Style& style);
 		EventStep(const EventStep& step);
 		~EventStep();
 
-		const std::string& label() const { return _label; }
-		const std::string& info() const { return _info; }
+		const std::string& label() const
+		{
+			return _strings->str(_label);
+		}
+		const std::string& info() const { return _strings->str(_info); }
+		StrRef label_ref() const { return _strings->ref(_label); }
+		StrRef info_ref() const { return _strings->ref(_info); }
 		const TsSpan& span() const { return _span; }
 		const Ts& start() const { return _span.start(); }
 		const Ts& end() const { return _span.end(); }
-		const Style& style() const { return _style; }
+		const Style& style() const { return *_style; }
 
 	private:
-		std::string _label;
-		std::string _info;
+		const StringPool* _strings;
+		StrId _label;
+		StrId _info;
 		TsSpan _span;
-		const Style& _style;
+		const Style* _style;
 	};
 
 	bool operator==(const EventStep& lhs, const EventStep& rhs);
 
 	/**
-	 * Single event in the timeline consisting of multiple steps.
+	 * Single event in the timeline consisting of multiple steps, label
+	 * and info are ids of interned strings as for EventStep.
 	 */
 	class Event {
 	public:
-		typedef std::vector<EventStep> step_vector;
-		typedef std::vector<EventStep>::const_iterator step_iterator;
+		typedef std::vector<EventStep, ArenaAllocator<EventStep>>
+			step_vector;
+		typedef step_vector::const_iterator step_iterator;
 
-		Event(const std::string& label, const std::string& info,
-		      const Ts& start, const Ts& end, const Style& style);
+		Event(StrRef label, StrRef info,
+		      const Ts& start, const Ts& end, const Style& style,
+		      Arena* arena = nullptr);
 		Event(const Event& event);
+		Event(const Event& event, Arena* arena);
+		Event(Event&& event) noexcept;
 		~Event();
 
-		const std::string& label() const { return _label; }
-		const std::string& info() const { return _info; }
+		Event& operator=(const Event& event);
+		Event& operator=(Event&& event) noexcept;
+
+		const std::string& label() const
+		{
+			return _strings->str(_label);
+		}
+		const std::string& info() const { return _strings->str(_info); }
+		StrRef label_ref() const { return _strings->ref(_label); }
+		StrRef info_ref() const { return _strings->ref(_info); }
 		const TsSpan& span() const { return _span; }
 		const Ts& start() const { return _span.start(); }
 		const Ts& end() const { return _span.end(); }
-		const Style& style() const { return _style; }
+		const Style& style() const { return *_style; }
 
 		const step_vector& steps() const { return _steps; }
 		step_iterator cbegin() const { return _steps.cbegin(); }
 		step_iterator cend() const { return _steps.cend(); }
 
-		void add_step(const std::string& label,
-			      const std::string& info,
+		void add_step(StrRef label, StrRef info,
 			      const Ts& start, const Ts& end,
 			      const Style &style);
 
 	private:
-		std::string _label;
-		std::string _info;
+		const StringPool* _strings;
+		StrId _label;
+		StrId _info;
 		TsSpan _span;
-		const Style& _style;
+		const Style* _style;
 
 		step_vector _steps;
 	};
 
+	class ColumnarData;
+	class Data;
+
+	/**
+	 * Parser of steps a loader added unparsed with
+	 * EventBuilder::add_raw_steps, used when the event is accessed.
+	 */
+	class StepDecoder {
+	public:
+		virtual ~StepDecoder();
+
+		/**
+		 * Add the steps in data to event with offset added to
+		 * their timestamps. Strings are interned in strings and
+		 * styles referenced by name in styles, invalid steps are
+		 * skipped.
+		 */
+		virtual void decode(const char* data, size_t size,
+				    const Ts& offset, StringPool& strings,
+				    Styles& styles, Event& event) const = 0;
+	};
+
+	/**
+	 * Strings and styles of a ColumnarData mapped to another data
+	 * store, indexed by id in the ColumnarData. Strings are ids in
+	 * the StringPool of the other data store, target is the Styles
+	 * styles are mapped to.
+	 */
+	struct IdMap {
+		IdMap() : target(nullptr) { }
+
+		std::vector<StrId> strings;
+		std::vector<const Style*> styles;
+		Styles* target;
+	};
+
+	/**
+	 * Handle for adding steps to an event constructed in place with
+	 * Data::emplace_event, only valid until the next event is added.
+	 */
+	class EventBuilder {
+	public:
+		EventBuilder();
+		EventBuilder(Data* data, size_t idx);
+		~EventBuilder();
+
+		bool valid() const { return _data != nullptr; }
+		size_t idx() const { return _idx; }
+
+		bool add_step(StrRef label, StrRef info,
+			      const Ts& start, const Ts& end,
+			      const Style& style);
+		bool add_raw_steps(
+			const std::shared_ptr<const StepDecoder>& decoder,
+			const char* data, size_t size,
+			const Ts& offset = Ts());
+
+	private:
+		Data* _data;
+		size_t _idx;
+	};
+
 	/**
 	 * Interface for accessing timeline data.
 	 */
@@ -107,26 +194,152 @@ namespace tmln {
 		virtual ~Data();
 
 		virtual const std::string& source() const { return _source; }
+
+		/**
+		 * Sources events were loaded from, source 0 is source()
+		 * and further sources are added with add_source.
+		 */
+		const std::vector<std::string>& sources() const
+		{
+			return _sources;
+		}
+		size_t add_source(const std::string& source);
+
+		/** Source of event at idx, index in sources(). */
+		virtual size_t event_source(size_t /*idx*/) const { return 0; }
+		/**
+		 * Tag event at idx with source, returns false if the
+		 * implementation does not store event sources.
+		 */
+		virtual bool set_event_source(size_t /*idx*/, size_t source)
+		{
+			return source == 0;
+		}
+
+		/**
+		 * Arena the data store allocates events and steps from,
+		 * freed when the Data is destroyed.
+		 */
+		Arena& arena() { return _arena; }
+
+		/**
+		 * Pool labels and info of events added to the data are
+		 * interned in.
+		 */
+		StringPool& strings() { return _strings; }
+		const StringPool& strings() const { return _strings; }
+
 		virtual const TsSpan& span() const = 0;
 		virtual size_t size() const = 0;
 		virtual size_t begin() const = 0;
 		virtual size_t end() const = 0;
 		virtual const Event& operator[](size_t idx) const = 0;
 		virtual bool add_event(const Event& event) = 0;
+		virtual bool add_event(Event&& event)
+		{
+			return add_event(static_cast<const Event&>(event));
+		}
+
+		/**
+		 * Add event without steps constructed in place, steps are
+		 * added using the returned builder. Label and info must
+		 * be interned in strings().
+		 */
+		virtual EventBuilder emplace_event(StrRef label,
+						   StrRef info,
+						   const Ts& start,
+						   const Ts& end,
+						   const Style& style) = 0;
+
+		/**
+		 * Append events begin to end of src with offset added to
+		 * their timestamps, strings and styles are mapped with map
+		 * filled in by src.map_ids. Returns false if any event or
+		 * step was rejected.
+		 */
+		virtual bool append(const ColumnarData& src,
+				    size_t begin, size_t end,
+				    const IdMap& map, const Ts& offset = Ts());
+
+		/**
+		 * Span of event at idx, implementations not storing Event
+		 * objects should override this to avoid constructing one.
+		 */
+		virtual TsSpan event_span(size_t idx) const
+		{
+			return (*this)[idx].span();
+		}
+
+		/**
+		 * Index over event spans, built on first use and updated
+		 * with events added since.
+		 */
+		const IntervalIndex& interval_index() const;
+
+		/**
+		 * Called when all events have been added, sorts events by
+		 * start and resets indexes. Events can be added in any
+		 * order before this is called.
+		 */
+		virtual void finalize();
+
+		/**
+		 * Set when loading into the data has been cancelled,
+		 * loaders check this between events and stop early.
+		 */
+		virtual bool cancelled() const { return false; }
+
+		/**
+		 * Report that bytes more of the input have been parsed,
+		 * for showing loading progress. Loaders may call this
+		 * from any thread, ignored by default.
+		 */
+		virtual void add_progress(size_t /*bytes*/) { }
+
+		/**
+		 * Set if steps added with EventBuilder::add_raw_steps are
+		 * kept unparsed, loaders skip parsing steps if so.
+		 */
+		virtual bool stores_raw_steps() const { return false; }
+
+	protected:
+		virtual bool emplace_step(size_t /*idx*/,
+					  StrRef /*label*/, StrRef /*info*/,
+					  const Ts& /*start*/,
+					  const Ts& /*end*/,
+					  const Style& /*style*/)
+		{
+			return false;
+		}
+		virtual bool emplace_raw_steps(
+			size_t /*idx*/,
+			const std::shared_ptr<const StepDecoder>& /*decoder*/,
+			const char* /*data*/, size_t /*size*/,
+			const Ts& /*offset*/)
+		{
+			return false;
+		}
 
 	private:
 		std::string _source;
+		std::vector<std::string> _sources;
+		Arena _arena;
+		StringPool _strings;
+		mutable IntervalIndex _interval_index;
+
+		friend class EventBuilder;
 	};
 
 	bool operator==(const Event& lhs, const Event& rhs);
 
 	/**
-	 * std::vector backed Data implementation
+	 * std::vector backed Data implementation, events and their steps
+	 * are allocated from the arena of the Data.
 	 */
 	class VectorData : public Data
 	{
 	public:
-		typedef std::vector<Event> event_vector;
+		typedef std::vector<Event, ArenaAllocator<Event>> event_vector;
 
 		VectorData(const std::string& source);
 		virtual ~VectorData();
@@ -137,6 +350,22 @@ namespace tmln {
 		virtual size_t end() const override { return _data.size(); }
 		virtual const Event& operator[](size_t idx) const override;
 		virtual bool add_event(const Event& event) override;
+		virtual bool add_event(Event&& event) override;
+		virtual EventBuilder emplace_event(StrRef label,
+						   StrRef info,
+						   const Ts& start,
+						   const Ts& end,
+						   const Style& style) override;
+		virtual void finalize() override;
+
+	protected:
+		virtual bool emplace_step(size_t idx,
+					  StrRef label, StrRef info,
+					  const Ts& start, const Ts& end,
+					  const Style& style) override;
+
+	private:
+		void update_span(const TsSpan& span);
 
 	private:
 		TsSpan _span;
@@ -0,0 +1,734 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <limits>
+
+#include "tmln_data_columnar.hh"
+#include "tmln_sort.hh"
+
+const size_t tmln::ColumnarData::CACHE_SIZE;
+const size_t tmln::ColumnarData::DECODED_CACHE_SIZE;
+
+/**
+ * First byte of the step data of an event with STEP_COMPACT, followed
+ * by the encoded steps or by the decoder id, offset and raw steps.
+ */
+static const uint8_t STEP_DATA_ENCODED = 0;
+static const uint8_t STEP_DATA_RAW = 1;
+
+static void
+put_varint(std::vector<uint8_t>& data, uint64_t val)
+{
+	while (val >= 0x80) {
+		data.push_back(static_cast<uint8_t>(val | 0x80));
+		val >>= 7;
+	}
+	data.push_back(static_cast<uint8_t>(val));
+}
+
+static uint64_t
+get_varint(const uint8_t*& pos)
+{
+	uint64_t val = 0;
+	for (int shift = 0; ; shift += 7) {
+		uint8_t byte = *pos++;
+		val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if (! (byte & 0x80)) {
+			return val;
+		}
+	}
+}
+
+static uint64_t
+zigzag(int64_t val)
+{
+	return (static_cast<uint64_t>(val) << 1)
+		^ static_cast<uint64_t>(val >> 63);
+}
+
+static int64_t
+unzigzag(uint64_t val)
+{
+	return static_cast<int64_t>(val >> 1) ^ -static_cast<int64_t>(val & 1);
+}
+
+/**
+ * Style with the name of style in the Styles of map.
+ */
+static const tmln::Style&
+target_style(const tmln::Style& style, const tmln::IdMap& map)
+{
+	if (style.id() == 0) {
+		return map.target->default_style();
+	}
+	return map.target->ref_style(style.name());
+}
+
+tmln::ColumnarData::ColumnarData(const std::string& source,
+				 StepStorage step_storage, Styles* styles)
+	: Data(source),
+	  _step_storage(step_storage),
+	  _span(Ts(0, 0), Ts(0, 0)),
+	  _num_steps(0),
+	  _step_styles(step_storage == STEP_COMPACT ? styles : nullptr),
+	  _cache_idx(CACHE_SIZE, std::numeric_limits<size_t>::max()),
+	  _cache(CACHE_SIZE)
+{
+	_step_offset.push_back(0);
+}
+
+tmln::ColumnarData::~ColumnarData()
+{
+}
+
+/**
+ * Construct Event at idx from the column data, the returned reference
+ * is valid until the next call to operator[].
+ */
+const tmln::Event&
+tmln::ColumnarData::operator[](size_t idx) const
+{
+	if (is_raw(idx)) {
+		return decoded_event(idx);
+	}
+
+	size_t slot = idx % CACHE_SIZE;
+	if (_cache_idx[slot] == idx) {
+		return *_cache[slot];
+	}
+
+	const StringPool& pool = strings();
+	Event* event = new Event(pool.ref(_label[idx]), pool.ref(_info[idx]),
+				 _start[idx], _end[idx],
+				 *_styles[_style[idx]]);
+	if (_step_storage == STEP_COMPACT) {
+		decode_steps(idx, *event);
+	} else {
+		for (uint64_t i = _step_offset[idx];
+		     i < _step_offset[idx + 1]; i++) {
+			event->add_step(pool.ref(_step_label[i]),
+					pool.ref(_step_info[i]),
+					_step_start[i], _step_end[i],
+					*_styles[_step_style[i]]);
+		}
+	}
+	_cache[slot].reset(event);
+	_cache_idx[slot] = idx;
+	return *event;
+}
+
+bool
+tmln::ColumnarData::add_event(const Event& event)
+{
+	uint64_t num_steps = _num_steps + event.steps().size();
+	if (_step_storage == STEP_COLUMNS
+	    && num_steps > std::numeric_limits<uint32_t>::max()) {
+		return false;
+	}
+
+	EventBuilder builder = emplace_event(event.label_ref(),
+					     event.info_ref(),
+					     event.start(), event.end(),
+					     event.style());
+	bool status = true;
+	Event::step_iterator it = event.cbegin();
+	for (; it != event.cend(); ++it) {
+		status = builder.add_step(it->label_ref(), it->info_ref(),
+					  it->start(), it->end(), it->style())
+			&& status;
+	}
+	return status;
+}
+
+tmln::EventBuilder
+tmln::ColumnarData::emplace_event(StrRef label,
+				  StrRef info,
+				  const Ts& start, const Ts& end,
+				  const Style& style)
+{
+	push_event(start, end, str_id(label), str_id(info), add_style(style));
+	return EventBuilder(this, _start.size() - 1);
+}
+
+/**
+ * Append events of src, columns are copied with the ids mapped
+ * without constructing Event objects or interning strings.
+ */
+bool
+tmln::ColumnarData::append(const ColumnarData& src,
+			   size_t begin, size_t end,
+			   const IdMap& map, const Ts& offset)
+{
+	bool status = true;
+	for (size_t idx = begin; idx < end; idx++) {
+		push_event(src._start[idx] + offset, src._end[idx] + offset,
+			   map.strings[src._label[idx]],
+			   map.strings[src._info[idx]],
+			   add_style(*map.styles[src._style[idx]]));
+		if (src.is_raw(idx)) {
+			EventBuilder builder(this, _start.size() - 1);
+			status = src.copy_raw_steps(idx, *this, builder, map,
+						    offset)
+				&& status;
+			continue;
+		}
+		src.for_each_step(idx, [this, &map, &offset, &status](
+					  const Ts& start, const Ts& end,
+					  StrId label, StrId info,
+					  StyleId style) {
+			status = push_step(start + offset, end + offset,
+					   map.strings[label],
+					   map.strings[info],
+					   add_style(*map.styles[style]))
+				&& status;
+		});
+	}
+	return status;
+}
+
+/**
+ * Map strings and styles of the data not yet in map to data and
+ * styles, styles are mapped by name.
+ */
+void
+tmln::ColumnarData::map_ids(Data& data, Styles& styles, IdMap& map) const
+{
+	StringPool& pool = data.strings();
+	for (size_t id = map.strings.size(); id < strings().size(); id++) {
+		map.strings.push_back(pool.intern_id(strings().str(id)));
+	}
+	for (size_t id = map.styles.size(); id < _styles.size(); id++) {
+		const Style* style = _styles[id];
+		if (style == nullptr || style->id() == 0) {
+			map.styles.push_back(&styles.default_style());
+		} else {
+			map.styles.push_back(&styles.ref_style(style->name()));
+		}
+	}
+	map.target = &styles;
+}
+
+/**
+ * Copy events begin to end to data using emplace_event, for data
+ * stores not storing ids.
+ */
+bool
+tmln::ColumnarData::copy_events(Data& data, size_t begin, size_t end,
+				const IdMap& map, const Ts& offset) const
+{
+	const StringPool& pool = data.strings();
+	bool status = true;
+	for (size_t idx = begin; idx < end; idx++) {
+		EventBuilder builder = data.emplace_event(
+			pool.ref(map.strings[_label[idx]]),
+			pool.ref(map.strings[_info[idx]]),
+			_start[idx] + offset, _end[idx] + offset,
+			*map.styles[_style[idx]]);
+		if (! builder.valid()) {
+			status = false;
+			continue;
+		} else if (is_raw(idx)) {
+			status = copy_raw_steps(idx, data, builder, map, offset)
+				&& status;
+			continue;
+		}
+		for_each_step(idx, [&pool, &map, &offset, &status, &builder](
+				      const Ts& start, const Ts& end,
+				      StrId label, StrId info, StyleId style) {
+			status = builder.add_step(pool.ref(map.strings[label]),
+						  pool.ref(map.strings[info]),
+						  start + offset, end + offset,
+						  *map.styles[style])
+				&& status;
+		});
+	}
+	return status;
+}
+
+void
+tmln::ColumnarData::push_event(const Ts& start, const Ts& end,
+			       StrId label, StrId info, StyleId style)
+{
+	_start.push_back(start);
+	_end.push_back(end);
+	_label.push_back(label);
+	_info.push_back(info);
+	_style.push_back(style);
+	_step_offset.push_back(_step_offset.back());
+	_step_last_end = start;
+
+	if (_start.size() == 1) {
+		_span = TsSpan(start, end);
+	} else {
+		if (start < _span.start()) {
+			_span.set_start(start);
+		}
+		if (end > _span.end()) {
+			_span.set_end(end);
+		}
+	}
+
+	invalidate(_start.size() - 1);
+}
+
+/**
+ * Append step to the event at idx, steps are stored in one array so
+ * only the last added event can get steps added.
+ */
+bool
+tmln::ColumnarData::emplace_step(size_t idx,
+				 StrRef label, StrRef info,
+				 const Ts& start, const Ts& end,
+				 const Style& style)
+{
+	if (idx + 1 != _start.size()) {
+		return false;
+	}
+
+	return push_step(start, end, str_id(label), str_id(info),
+			 add_style(style));
+}
+
+/**
+ * Id of str in strings(), strings interned in another pool are
+ * interned by value.
+ */
+tmln::StrId
+tmln::ColumnarData::str_id(StrRef str)
+{
+	if (str.pool() == &strings()) {
+		return str.id();
+	}
+	return strings().intern_id(str.str());
+}
+
+/**
+ * Append step to the last added event.
+ */
+bool
+tmln::ColumnarData::push_step(const Ts& start, const Ts& end,
+			      StrId label, StrId info, StyleId style)
+{
+	if (_step_storage == STEP_COMPACT) {
+		uint64_t first = _step_offset[_start.size() - 1];
+		if (first == _step_data.size()) {
+			_step_data.push_back(STEP_DATA_ENCODED);
+		} else if (_step_data[first] != STEP_DATA_ENCODED) {
+			// raw steps can not be added to
+			return false;
+		}
+		encode_step(start, end, label, info, style);
+		_step_offset.back() = _step_data.size();
+	} else {
+		if (_step_offset.back()
+		    == std::numeric_limits<uint32_t>::max()) {
+			return false;
+		}
+		_step_start.push_back(start);
+		_step_end.push_back(end);
+		_step_label.push_back(label);
+		_step_info.push_back(info);
+		_step_style.push_back(style);
+		_step_offset.back()++;
+	}
+	_num_steps++;
+
+	invalidate(_start.size() - 1);
+	return true;
+}
+
+/**
+ * Encode step as varints, start relative to the end of the previous
+ * step (or event start) and end as a duration. Steps mostly follow
+ * each other so most steps encode to a handful of bytes.
+ */
+void
+tmln::ColumnarData::encode_step(const Ts& start, const Ts& end,
+				StrId label, StrId info, StyleId style)
+{
+	put_varint(_step_data, zigzag(start.ns() - _step_last_end.ns()));
+	put_varint(_step_data, zigzag(end.ns() - start.ns()));
+	put_varint(_step_data, label);
+	put_varint(_step_data, info);
+	put_varint(_step_data, style);
+	_step_last_end = end;
+}
+
+/**
+ * Decode the compact steps of the event at idx into event.
+ */
+void
+tmln::ColumnarData::decode_steps(size_t idx, Event& event) const
+{
+	const StringPool& pool = strings();
+	for_each_step(idx, [this, &pool, &event](const Ts& start,
+						 const Ts& end,
+						 StrId label, StrId info,
+						 StyleId style) {
+		event.add_step(pool.ref(label), pool.ref(info), start, end,
+			       *_styles[style]);
+	});
+}
+
+/**
+ * Keep steps of the last added event, without steps, as data parsed
+ * by decoder on access. Only with STEP_COMPACT and styles set.
+ */
+bool
+tmln::ColumnarData::emplace_raw_steps(
+	size_t idx, const std::shared_ptr<const StepDecoder>& decoder,
+	const char* data, size_t size, const Ts& offset)
+{
+	if (_step_styles == nullptr || idx + 1 != _start.size()
+	    || _step_offset[idx] != _step_data.size()) {
+		return false;
+	}
+
+	// events mostly share the decoder of the previous event
+	size_t id = _decoders.size();
+	while (id > 0 && _decoders[id - 1] != decoder) {
+		id--;
+	}
+	if (id == 0) {
+		_decoders.push_back(decoder);
+		id = _decoders.size();
+	}
+
+	_step_data.push_back(STEP_DATA_RAW);
+	put_varint(_step_data, id - 1);
+	put_varint(_step_data, zigzag(offset.ns()));
+	_step_data.insert(_step_data.end(),
+			  reinterpret_cast<const uint8_t*>(data),
+			  reinterpret_cast<const uint8_t*>(data) + size);
+	_step_offset.back() = _step_data.size();
+
+	invalidate(idx);
+	return true;
+}
+
+bool
+tmln::ColumnarData::is_raw(size_t idx) const
+{
+	return _step_storage == STEP_COMPACT
+		&& _step_offset[idx] != _step_offset[idx + 1]
+		&& _step_data[_step_offset[idx]] == STEP_DATA_RAW;
+}
+
+/**
+ * Get event at idx with its raw steps parsed, from the cache of
+ * decoded events or parsed now evicting the least recently used.
+ */
+const tmln::Event&
+tmln::ColumnarData::decoded_event(size_t idx) const
+{
+	auto it = _decoded_idx.find(idx);
+	if (it != _decoded_idx.end()) {
+		_decoded.splice(_decoded.begin(), _decoded, it->second);
+		return *it->second->second;
+	}
+
+	if (_decoded.size() >= DECODED_CACHE_SIZE) {
+		_decoded_idx.erase(_decoded.back().first);
+		_decoded.pop_back();
+	}
+
+	const StringPool& pool = strings();
+	Event* event = new Event(pool.ref(_label[idx]), pool.ref(_info[idx]),
+				 _start[idx], _end[idx],
+				 *_styles[_style[idx]]);
+	const uint8_t* pos = _step_data.data() + _step_offset[idx] + 1;
+	const uint8_t* end = _step_data.data() + _step_offset[idx + 1];
+	const StepDecoder& decoder = *_decoders[get_varint(pos)];
+	Ts offset = Ts::from_ns(unzigzag(get_varint(pos)));
+	decoder.decode(reinterpret_cast<const char*>(pos), end - pos, offset,
+		       _step_strings, *_step_styles, *event);
+
+	_decoded.emplace_front(idx, std::unique_ptr<Event>(event));
+	_decoded_idx[idx] = _decoded.begin();
+	return *event;
+}
+
+/**
+ * Add the raw steps of the event at idx to builder, an event of data.
+ * Steps are kept raw if data stores raw steps and parsed otherwise,
+ * with strings interned in data and styles mapped with map.
+ */
+bool
+tmln::ColumnarData::copy_raw_steps(size_t idx, Data& data,
+				   EventBuilder& builder, const IdMap& map,
+				   const Ts& offset) const
+{
+	const uint8_t* pos = _step_data.data() + _step_offset[idx] + 1;
+	const uint8_t* end = _step_data.data() + _step_offset[idx + 1];
+	const std::shared_ptr<const StepDecoder>& decoder =
+		_decoders[get_varint(pos)];
+	Ts step_offset = Ts::from_ns(unzigzag(get_varint(pos))) + offset;
+	if (data.stores_raw_steps()
+	    && builder.add_raw_steps(decoder,
+				     reinterpret_cast<const char*>(pos),
+				     end - pos, step_offset)) {
+		return true;
+	}
+
+	StringPool& pool = data.strings();
+	const Event& event = (*this)[idx];
+	bool status = true;
+	Event::step_iterator it = event.cbegin();
+	for (; it != event.cend(); ++it) {
+		status = builder.add_step(pool.intern(it->label()),
+					  pool.intern(it->info()),
+					  it->start() + offset,
+					  it->end() + offset,
+					  target_style(it->style(), map))
+			&& status;
+	}
+	return status;
+}
+
+/**
+ * Call fun with the timestamps and ids of each step of the event at
+ * idx, in order. Raw steps are not visited.
+ */
+template<typename Fun>
+void
+tmln::ColumnarData::for_each_step(size_t idx, Fun fun) const
+{
+	if (_step_storage == STEP_COLUMNS) {
+		for (uint64_t i = _step_offset[idx];
+		     i < _step_offset[idx + 1]; i++) {
+			fun(_step_start[i], _step_end[i], _step_label[i],
+			    _step_info[i], _step_style[i]);
+		}
+		return;
+	}
+
+	const uint8_t* pos = _step_data.data() + _step_offset[idx];
+	const uint8_t* end = _step_data.data() + _step_offset[idx + 1];
+	if (pos == end || *pos++ != STEP_DATA_ENCODED) {
+		return;
+	}
+	int64_t last_end = _start[idx].ns();
+	while (pos < end) {
+		int64_t step_start = last_end + unzigzag(get_varint(pos));
+		int64_t step_end = step_start + unzigzag(get_varint(pos));
+		StrId label = static_cast<StrId>(get_varint(pos));
+		StrId info = static_cast<StrId>(get_varint(pos));
+		StyleId style = static_cast<StyleId>(get_varint(pos));
+		fun(Ts::from_ns(step_start), Ts::from_ns(step_end),
+		    label, info, style);
+		last_end = step_end;
+	}
+}
+
+tmln::TsSpan
+tmln::ColumnarData::event_span(size_t idx) const
+{
+	return TsSpan(_start[idx], _end[idx]);
+}
+
+size_t
+tmln::ColumnarData::event_source(size_t idx) const
+{
+	return idx < _source.size() ? _source[idx] : 0;
+}
+
+bool
+tmln::ColumnarData::set_event_source(size_t idx, size_t source)
+{
+	if (source > std::numeric_limits<uint16_t>::max()) {
+		return false;
+	} else if (source == 0 && idx >= _source.size()) {
+		return true;
+	}
+	if (_source.size() < _start.size()) {
+		_source.resize(_start.size(), 0);
+	}
+	_source[idx] = static_cast<uint16_t>(source);
+	return true;
+}
+
+/**
+ * Get id of style, the id of the style in its palette. Styles from
+ * another palette, with an id already in use, get an unused id.
+ */
+tmln::StyleId
+tmln::ColumnarData::add_style(const Style& style)
+{
+	StyleId id = style.id();
+	if (id >= _styles.size()) {
+		_styles.resize(id + 1, nullptr);
+	}
+	if (_styles[id] == nullptr) {
+		_styles[id] = &style;
+	}
+	if (_styles[id] == &style) {
+		return id;
+	}
+
+	std::vector<const Style*>::iterator it =
+		std::find(_styles.begin(), _styles.end(), &style);
+	if (it != _styles.end()) {
+		return static_cast<StyleId>(it - _styles.begin());
+	} else if (_styles.size() > std::numeric_limits<StyleId>::max()) {
+		// out of style ids, fallback to the style using the id
+		return id;
+	}
+	_styles.push_back(&style);
+	return static_cast<StyleId>(_styles.size() - 1);
+}
+
+/**
+ * Sort events by start, keeping the order of events with the same
+ * start. Steps are reordered to follow their event.
+ */
+void
+tmln::ColumnarData::finalize()
+{
+	if (std::is_sorted(_start.begin(), _start.end())) {
+		Data::finalize();
+		return;
+	}
+
+	std::vector<uint32_t> order(_start.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = static_cast<uint32_t>(i);
+	}
+	parallel_sort(order.begin(), order.end(),
+		      [this](uint32_t lhs, uint32_t rhs) {
+			      return _start[lhs] < _start[rhs];
+		      });
+
+	permute(_start, order);
+	permute(_end, order);
+	permute(_label, order);
+	permute(_info, order);
+	permute(_style, order);
+	if (! _source.empty()) {
+		_source.resize(_start.size(), 0);
+		permute(_source, order);
+	}
+
+	if (_step_storage == STEP_COMPACT) {
+		permute_compact(order);
+	} else {
+		permute_columns(order);
+	}
+
+	for (size_t i = 0; i < CACHE_SIZE; i++) {
+		_cache_idx[i] = std::numeric_limits<size_t>::max();
+		_cache[i].reset();
+	}
+	_decoded.clear();
+	_decoded_idx.clear();
+
+	Data::finalize();
+}
+
+bool
+tmln::ColumnarData::stores_raw_steps() const
+{
+	return _step_styles != nullptr;
+}
+
+/**
+ * Reorder the encoded step byte ranges to follow the event order,
+ * steps are relative to their own event so they are moved as is.
+ */
+void
+tmln::ColumnarData::permute_compact(const std::vector<uint32_t>& order)
+{
+	std::vector<uint8_t> step_data;
+	step_data.reserve(_step_data.size());
+	std::vector<uint64_t> step_offset;
+	step_offset.reserve(_step_offset.size());
+	step_offset.push_back(0);
+	for (size_t i = 0; i < order.size(); i++) {
+		step_data.insert(step_data.end(),
+				 _step_data.begin() + _step_offset[order[i]],
+				 _step_data.begin() + _step_offset[order[i] + 1]);
+		step_offset.push_back(step_data.size());
+	}
+	_step_data.swap(step_data);
+	_step_offset.swap(step_offset);
+}
+
+void
+tmln::ColumnarData::permute_columns(const std::vector<uint32_t>& order)
+{
+	std::vector<uint32_t> step_order;
+	step_order.reserve(_step_start.size());
+	std::vector<uint64_t> step_offset;
+	step_offset.reserve(_step_offset.size());
+	step_offset.push_back(0);
+	for (size_t i = 0; i < order.size(); i++) {
+		uint64_t first = _step_offset[order[i]];
+		uint64_t last = _step_offset[order[i] + 1];
+		for (uint64_t j = first; j < last; j++) {
+			step_order.push_back(static_cast<uint32_t>(j));
+		}
+		step_offset.push_back(step_order.size());
+	}
+	_step_offset.swap(step_offset);
+	permute(_step_start, step_order);
+	permute(_step_end, step_order);
+	permute(_step_label, step_order);
+	permute(_step_info, step_order);
+	permute(_step_style, step_order);
+}
+
+/**
+ * Reorder column so that element i is the previous element order[i].
+ */
+template<typename T>
+void
+tmln::ColumnarData::permute(std::vector<T>& column,
+			    const std::vector<uint32_t>& order)
+{
+	std::vector<T> sorted;
+	sorted.reserve(column.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		sorted.push_back(column[order[i]]);
+	}
+	column.swap(sorted);
+}
+
+/**
+ * Drop cached Event for idx, called when the event is modified.
+ */
+void
+tmln::ColumnarData::invalidate(size_t idx)
+{
+	size_t slot = idx % CACHE_SIZE;
+	if (_cache_idx[slot] == idx) {
+		_cache_idx[slot] = std::numeric_limits<size_t>::max();
+		_cache[slot].reset();
+	}
+	if (! _decoded.empty()) {
+		auto it = _decoded_idx.find(idx);
+		if (it != _decoded_idx.end()) {
+			_decoded.erase(it->second);
+			_decoded_idx.erase(it);
+		}
+	}
+}
@@ -0,0 +1,204 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_DATA_COLUMNAR_HH_
+#define _TMLN_DATA_COLUMNAR_HH_
+
+#include "config.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tmln_data.hh"
+
+namespace tmln {
+
+	/**
+	 * Structure-of-arrays backed Data implementation.
+	 *
+	 * Event and step timestamps are stored as parallel arrays of
+	 * timestamps, labels as ids in the interned string pool and
+	 * styles as the StyleId of their Styles palette. Steps of all
+	 * events are stored in one set of arrays with a per event offset
+	 * table.
+	 *
+	 * With STEP_COMPACT steps are instead stored as one byte string
+	 * per event, decoded only when the event is accessed. Steps
+	 * added with add_step are variable length encoded. With styles
+	 * set, steps loaders add with EventBuilder::add_raw_steps are
+	 * kept as the text the loader read and parsed only when their
+	 * event is accessed, so loading does not parse steps at all.
+	 * Strings of parsed steps are interned in a pool of their own and
+	 * styles are referenced by name in styles.
+	 *
+	 * Event objects are only constructed when accessed using
+	 * operator[] and are kept in a small direct mapped cache, slot
+	 * idx modulo CACHE_SIZE. Events with parsed raw steps are kept
+	 * in a cache of their own, holding the DECODED_CACHE_SIZE most
+	 * recently accessed. A returned reference is only valid until
+	 * the next call to operator[].
+	 */
+	class ColumnarData : public Data {
+	public:
+		static const size_t CACHE_SIZE = 1024;
+		static const size_t DECODED_CACHE_SIZE = 256;
+
+		enum StepStorage {
+			STEP_COLUMNS,
+			STEP_COMPACT
+		};
+
+		ColumnarData(const std::string& source,
+			     StepStorage step_storage = STEP_COLUMNS,
+			     Styles* styles = nullptr);
+		virtual ~ColumnarData();
+
+		virtual const TsSpan& span() const override { return _span; }
+		virtual size_t size() const override { return _start.size(); }
+		virtual size_t begin() const override { return 0; }
+		virtual size_t end() const override { return _start.size(); }
+		virtual const Event& operator[](size_t idx) const override;
+		virtual bool add_event(const Event& event) override;
+		using Data::add_event;
+		virtual EventBuilder emplace_event(StrRef label,
+						   StrRef info,
+						   const Ts& start,
+						   const Ts& end,
+						   const Style& style) override;
+		virtual bool append(const ColumnarData& src,
+				    size_t begin, size_t end,
+				    const IdMap& map,
+				    const Ts& offset = Ts()) override;
+		virtual TsSpan event_span(size_t idx) const override;
+		virtual size_t event_source(size_t idx) const override;
+		virtual bool set_event_source(size_t idx,
+					      size_t source) override;
+		virtual void finalize() override;
+		virtual bool stores_raw_steps() const override;
+
+		/** Number of steps, raw steps are not counted. */
+		size_t num_steps() const { return _num_steps; }
+		/** StyleId of the style of event at idx. */
+		StyleId style_id(size_t idx) const { return _style[idx]; }
+		/** StrId of the label of event at idx in strings(). */
+		StrId label_id(size_t idx) const { return _label[idx]; }
+
+		void map_ids(Data& data, Styles& styles, IdMap& map) const;
+		bool copy_events(Data& data, size_t begin, size_t end,
+				 const IdMap& map, const Ts& offset) const;
+
+	protected:
+		virtual bool emplace_step(size_t idx,
+					  StrRef label, StrRef info,
+					  const Ts& start, const Ts& end,
+					  const Style& style) override;
+		virtual bool emplace_raw_steps(
+			size_t idx,
+			const std::shared_ptr<const StepDecoder>& decoder,
+			const char* data, size_t size,
+			const Ts& offset) override;
+
+	private:
+		typedef std::list<std::pair<size_t, std::unique_ptr<Event>>>
+			decoded_list;
+
+		StyleId add_style(const Style& style);
+		StrId str_id(StrRef str);
+		void push_event(const Ts& start, const Ts& end,
+				StrId label, StrId info, StyleId style);
+		bool push_step(const Ts& start, const Ts& end,
+			       StrId label, StrId info, StyleId style);
+		void invalidate(size_t idx);
+
+		template<typename Fun>
+		void for_each_step(size_t idx, Fun fun) const;
+
+		void encode_step(const Ts& start, const Ts& end,
+				 StrId label, StrId info, StyleId style);
+		void decode_steps(size_t idx, Event& event) const;
+
+		bool is_raw(size_t idx) const;
+		const Event& decoded_event(size_t idx) const;
+		bool copy_raw_steps(size_t idx, Data& data,
+				    EventBuilder& builder, const IdMap& map,
+				    const Ts& offset) const;
+
+		void permute_compact(const std::vector<uint32_t>& order);
+		void permute_columns(const std::vector<uint32_t>& order);
+
+		template<typename T>
+		static void permute(std::vector<T>& column,
+				    const std::vector<uint32_t>& order);
+
+	private:
+		StepStorage _step_storage;
+		TsSpan _span;
+		size_t _num_steps;
+
+		std::vector<Ts> _start;
+		std::vector<Ts> _end;
+		std::vector<StrId> _label;
+		std::vector<StrId> _info;
+		std::vector<StyleId> _style;
+		/** source of each event, empty while all are source 0. */
+		std::vector<uint16_t> _source;
+		/**
+		 * offset of first step, or byte in _step_data, size() + 1
+		 * entries.
+		 */
+		std::vector<uint64_t> _step_offset;
+
+		std::vector<Ts> _step_start;
+		std::vector<Ts> _step_end;
+		std::vector<StrId> _step_label;
+		std::vector<StrId> _step_info;
+		std::vector<StyleId> _step_style;
+
+		std::vector<uint8_t> _step_data;
+		/** end of last encoded step, steps are delta encoded. */
+		Ts _step_last_end;
+		/** decoders of raw steps, indexed by id in _step_data. */
+		std::vector<std::shared_ptr<const StepDecoder>> _decoders;
+		/** styles raw steps reference, nullptr if not kept. */
+		Styles* _step_styles;
+		/** strings of parsed raw steps. */
+		mutable StringPool _step_strings;
+
+		/** style of each id, ids of styles all from one palette. */
+		std::vector<const Style*> _styles;
+
+		mutable std::vector<size_t> _cache_idx;
+		mutable std::vector<std::unique_ptr<Event>> _cache;
+		/** events with parsed raw steps, most recently used first. */
+		mutable decoded_list _decoded;
+		mutable std::unordered_map<size_t, decoded_list::iterator>
+			_decoded_idx;
+	};
+};
+
+#endif // _TMLN_DATA_COLUMNAR_HH_
@@ -0,0 +1,316 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "tmln_decompress.hh"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif // HAVE_ZLIB
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif // HAVE_ZSTD
+
+const size_t tmln::DecompressInput::BLOCK_SIZE;
+const size_t tmln::DecompressInput::MAX_BLOCKS;
+
+static const unsigned char GZIP_MAGIC[] = { 0x1f, 0x8b };
+static const unsigned char ZSTD_MAGIC[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+tmln::DecompressInput::DecompressInput(const char* data, size_t size,
+				       Format format)
+	: _data(data),
+	  _size(size),
+	  _format(format),
+	  _done(false),
+	  _stop(false),
+	  _status(true)
+{
+	setg(nullptr, nullptr, nullptr);
+	_thread = std::thread(&DecompressInput::run, this);
+}
+
+tmln::DecompressInput::~DecompressInput()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cond.notify_all();
+	_thread.join();
+}
+
+/**
+ * Detect compression format from the magic bytes at the start of data.
+ */
+tmln::DecompressInput::Format
+tmln::DecompressInput::detect(const char* data, size_t size)
+{
+	if (size >= sizeof(GZIP_MAGIC)
+	    && memcmp(data, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0) {
+		return FORMAT_GZIP;
+	} else if (size >= sizeof(ZSTD_MAGIC)
+		   && memcmp(data, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)) == 0) {
+		return FORMAT_ZSTD;
+	}
+	return FORMAT_NONE;
+}
+
+/**
+ * Check if format can be decompressed, depends on available libraries.
+ */
+bool
+tmln::DecompressInput::is_supported(Format format)
+{
+	switch (format) {
+	case FORMAT_GZIP:
+#ifdef HAVE_ZLIB
+		return true;
+#else // ! HAVE_ZLIB
+		return false;
+#endif // HAVE_ZLIB
+	case FORMAT_ZSTD:
+#ifdef HAVE_ZSTD
+		return true;
+#else // ! HAVE_ZSTD
+		return false;
+#endif // HAVE_ZSTD
+	default:
+		return false;
+	}
+}
+
+/**
+ * Get the decompressed data available to read without consuming it,
+ * waits for the first block. Returns false at end of input.
+ */
+bool
+tmln::DecompressInput::peek(const char*& data, size_t& size)
+{
+	if (gptr() == egptr() && underflow() == traits_type::eof()) {
+		return false;
+	}
+	data = gptr();
+	size = egptr() - gptr();
+	return true;
+}
+
+/**
+ * Append all of the remaining decompressed data to buf, returns
+ * status().
+ */
+bool
+tmln::DecompressInput::read_all(std::vector<char>& buf)
+{
+	buf.insert(buf.end(), gptr(), egptr());
+	setg(nullptr, nullptr, nullptr);
+	while (next_block()) {
+		if (buf.empty()) {
+			buf.swap(_block);
+		} else {
+			buf.insert(buf.end(), _block.begin(), _block.end());
+		}
+	}
+	return status();
+}
+
+/**
+ * Returns false if the compressed input is invalid or truncated, only
+ * final once all of the input has been read.
+ */
+bool
+tmln::DecompressInput::status()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _status;
+}
+
+tmln::DecompressInput::int_type
+tmln::DecompressInput::underflow()
+{
+	if (gptr() == egptr()) {
+		if (! next_block()) {
+			return traits_type::eof();
+		}
+		setg(_block.data(), _block.data(),
+		     _block.data() + _block.size());
+	}
+	return traits_type::to_int_type(*gptr());
+}
+
+void
+tmln::DecompressInput::run()
+{
+	bool status = false;
+	if (_format == FORMAT_GZIP) {
+		status = run_gzip();
+	} else if (_format == FORMAT_ZSTD) {
+		status = run_zstd();
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_status = status;
+	_done = true;
+	_cond.notify_all();
+}
+
+/**
+ * Inflate gzip members, or zlib streams, until the end of input.
+ */
+bool
+tmln::DecompressInput::run_gzip()
+{
+#ifdef HAVE_ZLIB
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	// 32 enables gzip and zlib header detection
+	if (inflateInit2(&zs, MAX_WBITS + 32) != Z_OK) {
+		return false;
+	}
+
+	const char* pos = _data;
+	const char* end = _data + _size;
+	std::vector<char> block;
+	int ret = Z_OK;
+	for (;;) {
+		if (zs.avail_in == 0 && pos < end) {
+			size_t len = std::min(static_cast<size_t>(end - pos),
+					      static_cast<size_t>(INT_MAX));
+			zs.next_in = reinterpret_cast<Bytef*>(
+				const_cast<char*>(pos));
+			zs.avail_in = len;
+			pos += len;
+		}
+
+		block.resize(BLOCK_SIZE);
+		zs.next_out = reinterpret_cast<Bytef*>(block.data());
+		zs.avail_out = block.size();
+		ret = inflate(&zs, Z_NO_FLUSH);
+		if (ret != Z_OK && ret != Z_STREAM_END) {
+			break;
+		}
+		bool full = zs.avail_out == 0;
+		block.resize(block.size() - zs.avail_out);
+		if (! block.empty() && ! put_block(block)) {
+			ret = Z_OK;
+			break;
+		}
+
+		bool input_left = zs.avail_in > 0 || pos < end;
+		if (ret == Z_STREAM_END) {
+			if (! input_left) {
+				break;
+			}
+			// concatenated members, as produced by pigz
+			inflateReset(&zs);
+		} else if (! input_left && ! full) {
+			// truncated input
+			break;
+		}
+	}
+	inflateEnd(&zs);
+	return ret == Z_STREAM_END;
+#else // ! HAVE_ZLIB
+	return false;
+#endif // HAVE_ZLIB
+}
+
+bool
+tmln::DecompressInput::run_zstd()
+{
+#ifdef HAVE_ZSTD
+	ZSTD_DStream* zds = ZSTD_createDStream();
+	if (zds == nullptr) {
+		return false;
+	}
+	ZSTD_initDStream(zds);
+
+	ZSTD_inBuffer in = { _data, _size, 0 };
+	std::vector<char> block;
+	size_t ret = 0;
+	bool status = true;
+	bool full = true;
+	while (in.pos < in.size || full) {
+		block.resize(BLOCK_SIZE);
+		ZSTD_outBuffer out = { block.data(), block.size(), 0 };
+		ret = ZSTD_decompressStream(zds, &out, &in);
+		if (ZSTD_isError(ret)) {
+			break;
+		}
+		full = out.pos == out.size;
+		block.resize(out.pos);
+		if (! block.empty() && ! put_block(block)) {
+			status = false;
+			break;
+		}
+	}
+	ZSTD_freeDStream(zds);
+	// 0 once a frame is completely decoded and flushed
+	return status && ! ZSTD_isError(ret) && ret == 0;
+#else // ! HAVE_ZSTD
+	return false;
+#endif // HAVE_ZSTD
+}
+
+/**
+ * Hand over block to the reader, waits while MAX_BLOCKS are queued.
+ * Returns false if the reader is gone.
+ */
+bool
+tmln::DecompressInput::put_block(std::vector<char>& block)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cond.wait(lock, [this]() {
+		return _stop || _blocks.size() < MAX_BLOCKS;
+	});
+	if (_stop) {
+		return false;
+	}
+	_blocks.emplace_back();
+	_blocks.back().swap(block);
+	_cond.notify_all();
+	return true;
+}
+
+/**
+ * Replace _block with the next decompressed block, waits for the
+ * decompression thread. Returns false at the end of input.
+ */
+bool
+tmln::DecompressInput::next_block()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cond.wait(lock, [this]() {
+		return _done || ! _blocks.empty();
+	});
+	if (_blocks.empty()) {
+		return false;
+	}
+	_block.swap(_blocks.front());
+	_blocks.pop_front();
+	_cond.notify_all();
+	return true;
+}
@@ -0,0 +1,99 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_DECOMPRESS_HH_
+#define _TMLN_DECOMPRESS_HH_
+
+#include "config.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace tmln {
+
+	/**
+	 * Stream buffer with the decompressed contents of a gzip or
+	 * zstd compressed buffer.
+	 *
+	 * Decompression runs in a separate thread, started on
+	 * construction, producing BLOCK_SIZE blocks with at most
+	 * MAX_BLOCKS blocks ahead of the reader. The compressed buffer
+	 * must stay valid for the lifetime of the DecompressInput.
+	 */
+	class DecompressInput : public std::streambuf {
+	public:
+		static const size_t BLOCK_SIZE = 1024 * 1024;
+		static const size_t MAX_BLOCKS = 4;
+
+		enum Format {
+			FORMAT_NONE,
+			FORMAT_GZIP,
+			FORMAT_ZSTD
+		};
+
+		DecompressInput(const char* data, size_t size, Format format);
+		DecompressInput(const DecompressInput&) = delete;
+		DecompressInput& operator=(const DecompressInput&) = delete;
+		virtual ~DecompressInput();
+
+		static Format detect(const char* data, size_t size);
+		static bool is_supported(Format format);
+
+		bool peek(const char*& data, size_t& size);
+		bool read_all(std::vector<char>& buf);
+		bool status();
+
+	protected:
+		virtual int_type underflow() override;
+
+	private:
+		void run();
+		bool run_gzip();
+		bool run_zstd();
+		bool put_block(std::vector<char>& block);
+		bool next_block();
+
+	private:
+		const char* _data;
+		size_t _size;
+		Format _format;
+
+		std::mutex _mutex;
+		std::condition_variable _cond;
+		/** decompressed blocks not yet read. */
+		std::deque<std::vector<char>> _blocks;
+		bool _done;
+		bool _stop;
+		bool _status;
+
+		/** block being read, the get area. */
+		std::vector<char> _block;
+		std::thread _thread;
+	};
+}
+
+#endif // _TMLN_DECOMPRESS_HH_
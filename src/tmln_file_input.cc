@@ -0,0 +1,138 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tmln_file_input.hh"
+
+const size_t tmln::FileInput::READ_SIZE;
+
+tmln::FileInput::FileInput()
+	: _is_open(false),
+	  _map(nullptr),
+	  _data(nullptr),
+	  _size(0)
+{
+}
+
+tmln::FileInput::FileInput(const std::string& path)
+	: FileInput()
+{
+	open(path);
+}
+
+tmln::FileInput::~FileInput()
+{
+	close();
+}
+
+bool
+tmln::FileInput::open(const std::string& path)
+{
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+	bool status = open_fd(fd);
+	::close(fd);
+	return status;
+}
+
+/**
+ * Map or read the file referenced by fd, fd is not closed.
+ */
+bool
+tmln::FileInput::open_fd(int fd)
+{
+	close();
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		return false;
+	}
+
+	if (S_ISREG(st.st_mode) && st.st_size > 0) {
+		void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE,
+				 fd, 0);
+		if (map != MAP_FAILED) {
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			_map = map;
+			_data = static_cast<const char*>(map);
+			_size = st.st_size;
+			_is_open = true;
+			return true;
+		}
+	}
+
+	_is_open = read_fd(fd, S_ISREG(st.st_mode) ? st.st_size : 0);
+	if (! _is_open) {
+		close();
+	}
+	return _is_open;
+}
+
+void
+tmln::FileInput::close()
+{
+	if (_map != nullptr) {
+		munmap(_map, _size);
+	}
+	_map = nullptr;
+	std::vector<char>().swap(_buf);
+	_data = nullptr;
+	_size = 0;
+	_is_open = false;
+}
+
+/**
+ * Read all of fd into _buf, growing it READ_SIZE at a time once past
+ * size_hint.
+ */
+bool
+tmln::FileInput::read_fd(int fd, size_t size_hint)
+{
+	_buf.resize(size_hint > 0 ? size_hint : READ_SIZE);
+	size_t size = 0;
+	for (;;) {
+		if (size == _buf.size()) {
+			_buf.resize(_buf.size() + READ_SIZE);
+		}
+		ssize_t ret = read(fd, _buf.data() + size, _buf.size() - size);
+		if (ret == -1 && errno == EINTR) {
+			continue;
+		} else if (ret == -1) {
+			return false;
+		} else if (ret == 0) {
+			break;
+		}
+		size += ret;
+	}
+	_buf.resize(size);
+	_data = _buf.data();
+	_size = size;
+	return true;
+}
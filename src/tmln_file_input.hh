@@ -0,0 +1,73 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_FILE_INPUT_HH_
+#define _TMLN_FILE_INPUT_HH_
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+
+namespace tmln {
+
+	/**
+	 * Contents of a file as one contiguous read-only buffer.
+	 *
+	 * Regular files are mapped with mmap, pipes and other files
+	 * that can not be mapped are read in full into memory with no
+	 * further copies.
+	 */
+	class FileInput {
+	public:
+		/** Size of reads when the input size is unknown. */
+		static const size_t READ_SIZE = 1024 * 1024;
+
+		FileInput();
+		FileInput(const std::string& path);
+		FileInput(const FileInput&) = delete;
+		FileInput& operator=(const FileInput&) = delete;
+		~FileInput();
+
+		bool open(const std::string& path);
+		bool open_fd(int fd);
+		void close();
+
+		bool is_open() const { return _is_open; }
+		bool is_mapped() const { return _map != nullptr; }
+		const char* data() const { return _data; }
+		size_t size() const { return _size; }
+
+	private:
+		bool read_fd(int fd, size_t size_hint);
+
+	private:
+		bool _is_open;
+		void* _map;
+		std::vector<char> _buf;
+		const char* _data;
+		size_t _size;
+	};
+}
+
+#endif // _TMLN_FILE_INPUT_HH_
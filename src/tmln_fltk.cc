@@ -199,8 +199,10 @@ tmln::Fl_Timeline::resize(int x, int y, int w, int h)
 	Fl_Group::resize(x, y, w, h);
 	_x_scrollbar.resize(x, y + h - 20, w - 20, 20);
 	_y_scrollbar.resize(x + w - 20, y, 20, h - 20);
-	_scale->set_actual_size(w - 20, h - 20);
-	update_scrollbar();
+	if (has_data()) {
+		_scale->set_actual_size(w - 20, h - 20);
+		update_scrollbar();
+	}
 }
 
 void
@@ -224,6 +226,10 @@ tmln::Fl_Timeline::draw()
 	fl_rectf(x() + w() - 20, y() + h() - 20, 20, 20);
 }
 
+/**
+ * Check if there is data to show, data loaded or followed while shown
+ * starts out empty and update_data is called as it grows.
+ */
 bool
 tmln::Fl_Timeline::has_data() const
 {
@@ -234,13 +240,15 @@ tmln::Fl_Timeline::has_data() const
 }
 
 void
-tmln::Fl_Timeline::update_scrollbar()
+tmln::Fl_Timeline::update_scrollbar(bool keep_position)
 {
 	int x_num = static_cast<int>(_scale->span().to_sec());
 	int x_tot = static_cast<int>(_data_sel->data_span().to_sec());
-	_x_scrollbar.value(0, x_num, 0, x_tot);
-	_y_scrollbar.value(0, _scale->num_events(), 0, _data_sel->data_size());
-	
+	int x_pos = keep_position ? _x_scrollbar.value() : 0;
+	int y_pos = keep_position ? _y_scrollbar.value() : 0;
+	_x_scrollbar.value(x_pos, x_num, 0, x_tot);
+	_y_scrollbar.value(y_pos, _scale->num_events(), 0,
+			   _data_sel->data_size());
 }
 
 void
@@ -279,6 +287,24 @@ tmln::Fl_Timeline::set_info(const std::string& info)
 	do_callback();
 }
 
+/**
+ * Update the view after events were appended to the data, keeping the
+ * scroll position and the selection.
+ */
+void
+tmln::Fl_Timeline::update_data()
+{
+	if (! has_data()) {
+		return;
+	}
+
+	_scale->set_actual(_data_sel->data_span(), _data_sel->data_size());
+	_scale->set_actual_size(w() - 20, h() - 20);
+	_data_sel->update();
+	update_scrollbar(true);
+	redraw();
+}
+
 void
 tmln::Fl_Timeline::zoom(double diff)
 {
@@ -56,10 +56,11 @@ namespace tmln {
 		const std::string& info() const { return _info; }
 		void set_info(const std::string& info);
 		void zoom(double diff);
+		void update_data();
 
 	private:
 		bool has_data() const;
-		void update_scrollbar();
+		void update_scrollbar(bool keep_position = false);
 
 		bool handle_button_press(int button, int x, int y);
 
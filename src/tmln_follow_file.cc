@@ -0,0 +1,231 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <sys/stat.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tmln_file_input.hh"
+#include "tmln_follow_file.hh"
+
+const size_t tmln::FollowFile::READ_SIZE;
+const size_t tmln::FollowFile::POLL_MAX;
+
+tmln::FollowFile::FollowFile(Data& data, Styles& styles)
+	: _data(data),
+	  _styles(styles),
+	  _load(data, styles),
+	  _fd(-1),
+	  _regular(false),
+	  _dev(0),
+	  _ino(0),
+	  _offset(0),
+	  _status(true),
+	  _load_end(0)
+{
+}
+
+tmln::FollowFile::~FollowFile()
+{
+	close();
+}
+
+/**
+ * Open file at path, the current contents of regular files are loaded
+ * in the background and added by poll. Other files are read as is and
+ * the data is finalized.
+ */
+bool
+tmln::FollowFile::open(const std::string& path)
+{
+	close();
+	// non-blocking for reads of named pipes, ignored for files
+	_fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK);
+	if (_fd == -1) {
+		return false;
+	}
+	_path = path;
+
+	struct stat st;
+	if (fstat(_fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		_regular = true;
+		_dev = st.st_dev;
+		_ino = st.st_ino;
+	}
+	if (_regular && st.st_size > 0) {
+		start_load();
+	} else {
+		poll();
+		_data.finalize();
+	}
+	return true;
+}
+
+void
+tmln::FollowFile::close()
+{
+	// the loader maps the file using the descriptor
+	_async.reset();
+	if (_fd != -1) {
+		::close(_fd);
+		_fd = -1;
+	}
+	_regular = false;
+	_offset = 0;
+	_buf.clear();
+}
+
+/**
+ * Read data appended since the last poll, up to POLL_MAX bytes, returns
+ * the number of events added to the data. While the contents at open
+ * are loading, the loaded events are added instead.
+ */
+size_t
+tmln::FollowFile::poll()
+{
+	if (_async) {
+		return poll_load();
+	}
+
+	check_truncated();
+	size_t num_events = _data.size();
+	for (size_t total = 0; _fd != -1 && total < POLL_MAX; ) {
+		size_t len = _buf.size();
+		_buf.resize(len + READ_SIZE);
+		ssize_t nread = read(_fd, _buf.data() + len, READ_SIZE);
+		_buf.resize(len + (nread > 0 ? nread : 0));
+		if (nread == -1 && errno == EINTR) {
+			continue;
+		} else if (nread == 0 && reopen_rotated()) {
+			continue;
+		} else if (nread <= 0) {
+			break;
+		}
+		total += nread;
+		_offset += nread;
+
+		size_t line_end = _buf.size();
+		while (line_end > len && _buf[line_end - 1] != '\n') {
+			line_end--;
+		}
+		if (line_end > len) {
+			if (! _load.load_lines(_buf.data(), line_end)) {
+				_status = false;
+			}
+			_buf.erase(_buf.begin(), _buf.begin() + line_end);
+		}
+		if (static_cast<size_t>(nread) < READ_SIZE) {
+			break;
+		}
+	}
+	return _data.size() - num_events;
+}
+
+/**
+ * Load the whole lines of the file as it is when opened in a thread,
+ * the end of the loaded lines is where reading appended data starts.
+ */
+void
+tmln::FollowFile::start_load()
+{
+	int fd = _fd;
+	size_t* load_end = &_load_end;
+	_load_end = 0;
+	_async.reset(new LoadAsync(_data, _styles));
+	_async->start([fd, load_end](Data& data, Styles& styles) {
+		FileInput input;
+		if (! input.open_fd(fd)) {
+			return false;
+		}
+		size_t line_end = input.size();
+		while (line_end > 0 && input.data()[line_end - 1] != '\n') {
+			line_end--;
+		}
+		*load_end = line_end;
+		LoadJson load(data, styles);
+		return load.load_ndjson(input.data(), line_end);
+	});
+}
+
+/**
+ * Add events loaded by the thread, once all are added the file is
+ * read from the end of the loaded lines.
+ */
+size_t
+tmln::FollowFile::poll_load()
+{
+	size_t num_events = _async->poll();
+	if (_async->done()) {
+		_status = _async->status() && _status;
+		// the loader thread has been joined, _load_end is set
+		_offset = _load_end;
+		lseek(_fd, _offset, SEEK_SET);
+		_async.reset();
+	}
+	return num_events;
+}
+
+/**
+ * Read the file from the start if it has been truncated below the
+ * read offset, the incomplete last line read is dropped.
+ */
+void
+tmln::FollowFile::check_truncated()
+{
+	struct stat st;
+	if (_regular && fstat(_fd, &st) == 0
+	    && static_cast<size_t>(st.st_size) < _offset) {
+		lseek(_fd, 0, SEEK_SET);
+		_offset = 0;
+		_buf.clear();
+	}
+}
+
+/**
+ * Reopen the path if it refers to another file than the one read, for
+ * files that are rotated. Called at the end of the open file, returns
+ * true if reopened.
+ */
+bool
+tmln::FollowFile::reopen_rotated()
+{
+	struct stat st;
+	if (! _regular || stat(_path.c_str(), &st) == -1
+	    || (st.st_dev == _dev && st.st_ino == _ino)) {
+		return false;
+	}
+
+	int fd = ::open(_path.c_str(), O_RDONLY | O_NONBLOCK);
+	if (fd == -1) {
+		return false;
+	}
+	::close(_fd);
+	_fd = fd;
+	_regular = fstat(_fd, &st) == 0 && S_ISREG(st.st_mode);
+	_dev = st.st_dev;
+	_ino = st.st_ino;
+	_offset = 0;
+	_buf.clear();
+	return true;
+}
@@ -0,0 +1,111 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_FOLLOW_FILE_HH_
+#define _TMLN_FOLLOW_FILE_HH_
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tmln_data.hh"
+#include "tmln_load_async.hh"
+#include "tmln_load_json.hh"
+#include "tmln_style.hh"
+
+namespace tmln {
+
+	/**
+	 * NDJSON file that is appended to while viewed, see LoadJson.
+	 *
+	 * The current contents of a regular file are loaded in the
+	 * background with LoadAsync, poll adds the loaded events and the
+	 * data is finalized once all of them are added. After that lines
+	 * appended since the last poll are added to the data, an
+	 * incomplete last line is kept until the rest of it is written.
+	 * Events are appended without finalizing the data, the interval
+	 * index of the data is updated with the new events on next use.
+	 *
+	 * A file truncated below the read offset is read again from the
+	 * start and a file replaced at the path, as when rotated, is
+	 * reopened once the old file has been read to the end. Events
+	 * already added are kept.
+	 *
+	 * poll is called from the UI thread, at most POLL_MAX bytes are
+	 * read and parsed per call. Large appends are added over several
+	 * polls.
+	 */
+	class FollowFile {
+	public:
+		/** Size of reads of appended data. */
+		static const size_t READ_SIZE = 256 * 1024;
+		/** Maximum number of bytes read per poll. */
+		static const size_t POLL_MAX = 4 * READ_SIZE;
+
+		FollowFile(Data& data, Styles& styles);
+		FollowFile(const FollowFile&) = delete;
+		FollowFile& operator=(const FollowFile&) = delete;
+		~FollowFile();
+
+		bool open(const std::string& path);
+		void close();
+		bool is_open() const { return _fd != -1; }
+		/** Set while the contents at open are being loaded. */
+		bool loading() const { return _async != nullptr; }
+
+		size_t poll();
+		/** false if any line read so far was invalid. */
+		bool status() const { return _status; }
+
+	private:
+		void start_load();
+		size_t poll_load();
+		void check_truncated();
+		bool reopen_rotated();
+
+	private:
+		Data& _data;
+		Styles& _styles;
+		LoadJson _load;
+		std::string _path;
+		int _fd;
+		/** set if the open file is a regular file. */
+		bool _regular;
+		/** device and inode of the open file. */
+		dev_t _dev;
+		ino_t _ino;
+		/** offset in the file of the end of the data read. */
+		size_t _offset;
+		/** incomplete last line followed by data being read. */
+		std::vector<char> _buf;
+		bool _status;
+		/** end of the contents loaded at open, set by the loader. */
+		size_t _load_end;
+		std::unique_ptr<LoadAsync> _async;
+	};
+}
+
+#endif // _TMLN_FOLLOW_FILE_HH_
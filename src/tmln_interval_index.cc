@@ -0,0 +1,265 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <iterator>
+
+#include "tmln_data.hh"
+#include "tmln_interval_index.hh"
+#include "tmln_sort.hh"
+
+tmln::IntervalIndex::IntervalIndex()
+	: _data(nullptr),
+	  _root_level(0)
+{
+}
+
+/**
+ * Copies start out empty, the index refers to the data it was built
+ * from and is rebuilt for the copied data on first use.
+ */
+tmln::IntervalIndex::IntervalIndex(const IntervalIndex&)
+	: _data(nullptr),
+	  _root_level(0)
+{
+}
+
+tmln::IntervalIndex::~IntervalIndex()
+{
+}
+
+tmln::IntervalIndex&
+tmln::IntervalIndex::operator=(const IntervalIndex&)
+{
+	clear();
+	return *this;
+}
+
+void
+tmln::IntervalIndex::clear()
+{
+	_idx.clear();
+	_max_end.clear();
+	_root_level = 0;
+}
+
+/**
+ * Build index from all events in data. Finalized data is already
+ * sorted by start, the data order is then used as is.
+ */
+void
+tmln::IntervalIndex::build(const Data& data)
+{
+	_data = &data;
+	_idx.clear();
+	bool sorted = true;
+	for (size_t i = 1; i < data.size() && sorted; i++) {
+		sorted = ! (data.event_span(i).start()
+			    < data.event_span(i - 1).start());
+	}
+
+	if (! sorted) {
+		_idx.resize(data.size());
+		for (size_t i = 0; i < _idx.size(); i++) {
+			_idx[i] = i;
+		}
+		parallel_sort(_idx.begin(), _idx.end(),
+			      [&data](size_t lhs, size_t rhs) {
+				      return data.event_span(lhs).start()
+					      < data.event_span(rhs).start();
+			      });
+	}
+	_max_end.clear();
+	_max_end.resize(data.size(), Ts(0, 0));
+	build_max_end(0);
+}
+
+/**
+ * Add events added to data since the index was built. Events starting
+ * before the last indexed event are sorted and merged into the index,
+ * only the part of the index after the first of them is rewritten.
+ */
+void
+tmln::IntervalIndex::update(const Data& data)
+{
+	_data = &data;
+	size_t from = size();
+	std::vector<size_t> added;
+	added.reserve(data.size() - from);
+	bool sorted = true;
+	Ts last = from > 0 ? span(from - 1).start() : Ts();
+	for (size_t i = from; i < data.size(); i++) {
+		Ts start = data.event_span(i).start();
+		if ((from > 0 || i > from) && start < last) {
+			sorted = false;
+		}
+		last = start;
+		added.push_back(i);
+	}
+
+	_max_end.resize(data.size(), Ts(0, 0));
+	if (sorted) {
+		if (! _idx.empty()) {
+			_idx.insert(_idx.end(), added.begin(), added.end());
+		}
+		build_max_end(from);
+		return;
+	}
+
+	if (_idx.empty()) {
+		_idx.resize(from);
+		for (size_t i = 0; i < from; i++) {
+			_idx[i] = i;
+		}
+	}
+	auto by_start = [&data](size_t lhs, size_t rhs) {
+		return data.event_span(lhs).start()
+			< data.event_span(rhs).start();
+	};
+	std::stable_sort(added.begin(), added.end(), by_start);
+	size_t pos = std::upper_bound(_idx.begin(), _idx.end(), added.front(),
+				      by_start) - _idx.begin();
+	std::vector<size_t> tail(_idx.begin() + pos, _idx.end());
+	_idx.resize(pos);
+	// equal starts are taken from the tail first, keeping indexed
+	// events before added ones
+	std::merge(tail.begin(), tail.end(), added.begin(), added.end(),
+		   std::back_inserter(_idx), by_start);
+	build_max_end(pos);
+}
+
+/**
+ * Get index of up to max_num events overlapping span, in start order.
+ */
+void
+tmln::IntervalIndex::query(const TsSpan& span, size_t max_num,
+			   std::vector<size_t>& result) const
+{
+	result.clear();
+	if (size() > 0 && max_num > 0) {
+		query((size_t(1) << _root_level) - 1, _root_level, span,
+		      max_num, result);
+	}
+}
+
+/**
+ * Span of the event at pos in start order.
+ */
+tmln::TsSpan
+tmln::IntervalIndex::span(size_t pos) const
+{
+	return _data->event_span(idx(pos));
+}
+
+/**
+ * Get maximum end of the subtree at pos on level, positions past the
+ * last event have no event of their own and only their left subtree
+ * has events. Returns false if the subtree has no events.
+ */
+bool
+tmln::IntervalIndex::subtree_max_end(size_t pos, size_t level,
+				     Ts& end) const
+{
+	for (; pos >= size(); level--) {
+		if (level == 0) {
+			return false;
+		}
+		pos -= size_t(1) << (level - 1);
+	}
+	end = _max_end[pos];
+	return true;
+}
+
+/**
+ * Update maximum ends of all nodes with positions from from in their
+ * subtree, bottom up one level at a time.
+ */
+void
+tmln::IntervalIndex::build_max_end(size_t from)
+{
+	size_t num = size();
+	_root_level = 0;
+	while ((size_t(2) << _root_level) - 1 < num) {
+		_root_level++;
+	}
+
+	for (size_t level = 0; level <= _root_level; level++) {
+		size_t half = level > 0 ? size_t(1) << (level - 1) : 0;
+		size_t step = size_t(2) << level;
+		// first node on level covering from
+		size_t pos = (size_t(1) << level) - 1;
+		if (from > pos + pos) {
+			pos += (from - pos - pos + step - 1) / step * step;
+		}
+		for (; pos < num; pos += step) {
+			Ts end = span(pos).end();
+			if (level > 0) {
+				Ts sub = _max_end[pos - half];
+				if (sub > end) {
+					end = sub;
+				}
+				if (subtree_max_end(pos + half, level - 1, sub)
+				    && sub > end) {
+					end = sub;
+				}
+			}
+			_max_end[pos] = end;
+		}
+	}
+}
+
+/**
+ * Add events overlapping span in the subtree at pos on level to result
+ * in start order, until result has max_num events.
+ */
+void
+tmln::IntervalIndex::query(size_t pos, size_t level, const TsSpan& span,
+			   size_t max_num, std::vector<size_t>& result) const
+{
+	size_t half = level > 0 ? size_t(1) << (level - 1) : 0;
+	if (pos >= size()) {
+		if (level > 0) {
+			query(pos - half, level - 1, span, max_num, result);
+		}
+		return;
+	} else if (_max_end[pos] < span.start()) {
+		return;
+	}
+
+	if (level > 0) {
+		query(pos - half, level - 1, span, max_num, result);
+	}
+	if (result.size() >= max_num) {
+		return;
+	}
+	TsSpan pos_span = this->span(pos);
+	if (! (pos_span.start() < span.end())) {
+		return;
+	}
+	if (span.overlaps(pos_span)) {
+		result.push_back(idx(pos));
+	}
+	if (level > 0) {
+		query(pos + half, level - 1, span, max_num, result);
+	}
+}
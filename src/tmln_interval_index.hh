@@ -0,0 +1,95 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_INTERVAL_INDEX_HH_
+#define _TMLN_INTERVAL_INDEX_HH_
+
+#include "config.h"
+
+#include <vector>
+
+#include "tmln_time.hh"
+
+namespace tmln {
+
+	class Data;
+
+	/**
+	 * Index over event spans of a Data for finding all events
+	 * overlapping a timespan.
+	 *
+	 * Events are kept sorted by start and form an implicit augmented
+	 * interval tree, the event at position i in start order is a
+	 * node at the level given by the number of trailing one bits of
+	 * i and stores the maximum end of its subtree. Queries skip
+	 * subtrees ending before the span, so a single long event only
+	 * adds its path from the root instead of making every query scan
+	 * from it.
+	 *
+	 * Only the order of the events and the maximum ends are stored,
+	 * event spans are read from the data the index was built from.
+	 * Data already sorted by start is indexed in data order without
+	 * storing the order.
+	 */
+	class IntervalIndex {
+	public:
+		IntervalIndex();
+		IntervalIndex(const IntervalIndex& index);
+		~IntervalIndex();
+
+		IntervalIndex& operator=(const IntervalIndex& index);
+
+		size_t size() const { return _max_end.size(); }
+
+		void clear();
+		void build(const Data& data);
+		void update(const Data& data);
+		void query(const TsSpan& span, size_t max_num,
+			   std::vector<size_t>& result) const;
+
+	private:
+		size_t idx(size_t pos) const
+		{
+			return _idx.empty() ? pos : _idx[pos];
+		}
+		TsSpan span(size_t pos) const;
+		bool subtree_max_end(size_t pos, size_t level, Ts& end) const;
+		void build_max_end(size_t from);
+		void query(size_t pos, size_t level, const TsSpan& span,
+			   size_t max_num, std::vector<size_t>& result) const;
+
+	private:
+		const Data* _data;
+		/**
+		 * event index in Data, sorted by start, empty if the data
+		 * is sorted by start.
+		 */
+		std::vector<size_t> _idx;
+		/** maximum end of the subtree at each position. */
+		std::vector<Ts> _max_end;
+		/** level of the root node. */
+		size_t _root_level;
+	};
+}
+
+#endif // _TMLN_INTERVAL_INDEX_HH_
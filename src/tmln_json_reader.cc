@@ -0,0 +1,406 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include "tmln_json_reader.hh"
+
+const size_t tmln::JsonReader::BUF_SIZE;
+
+tmln::JsonReader::JsonReader(const char* data, size_t size, bool elements)
+	: _is(nullptr),
+	  _elements(elements),
+	  _begin(data),
+	  _offset(0),
+	  _pos(data),
+	  _end(data + size),
+	  _expect(EXPECT_VALUE)
+{
+	if (_elements) {
+		_stack.push_back('[');
+		_expect = EXPECT_VALUE_OR_END;
+	}
+}
+
+tmln::JsonReader::JsonReader(std::istream& is)
+	: _is(&is),
+	  _elements(false),
+	  _buf(BUF_SIZE),
+	  _begin(nullptr),
+	  _offset(0),
+	  _pos(nullptr),
+	  _end(nullptr),
+	  _expect(EXPECT_VALUE)
+{
+}
+
+tmln::JsonReader::~JsonReader()
+{
+}
+
+/**
+ * Read next token, TOKEN_END is returned once the top level value has
+ * been read and TOKEN_ERROR on invalid input. Errors are sticky.
+ */
+tmln::JsonReader::Token
+tmln::JsonReader::next()
+{
+	char c;
+	for (;;) {
+		if (_expect == EXPECT_ERROR) {
+			return TOKEN_ERROR;
+		}
+
+		skip_ws();
+		bool eof = ! peek(c);
+		if (_expect == EXPECT_SEP_OR_END && _stack.empty()) {
+			return eof ? TOKEN_END : error();
+		} else if (eof && _elements && _stack.size() == 1
+			   && (_expect == EXPECT_SEP_OR_END
+			       || _expect == EXPECT_VALUE_OR_END)) {
+			// end of data ends the implicit array
+			_stack.pop_back();
+			_expect = EXPECT_SEP_OR_END;
+			return TOKEN_ARRAY_END;
+		} else if (eof) {
+			return error();
+		}
+
+		switch (_expect) {
+		case EXPECT_VALUE:
+			return value_token(c);
+		case EXPECT_VALUE_OR_END:
+			return c == ']' ? end_token(c) : value_token(c);
+		case EXPECT_KEY_OR_END:
+			if (c == '}') {
+				return end_token(c);
+			}
+			// fall through
+		case EXPECT_KEY:
+			if (c != '"' || ! read_string()) {
+				return error();
+			}
+			skip_ws();
+			if (! peek(c) || c != ':') {
+				return error();
+			}
+			_pos++;
+			_expect = EXPECT_VALUE;
+			return TOKEN_KEY;
+		case EXPECT_SEP_OR_END:
+			if (c != ',') {
+				return end_token(c);
+			}
+			_pos++;
+			_expect = _stack.back() == '{'
+				? EXPECT_KEY : EXPECT_VALUE;
+			break;
+		case EXPECT_ERROR:
+			return TOKEN_ERROR;
+		}
+	}
+}
+
+/**
+ * Skip the value started by token, objects and arrays are read until
+ * their end. Returns false on errors.
+ */
+bool
+tmln::JsonReader::skip(Token token)
+{
+	if (token == TOKEN_ERROR) {
+		return false;
+	} else if (token != TOKEN_OBJECT_BEGIN && token != TOKEN_ARRAY_BEGIN) {
+		return true;
+	}
+
+	size_t depth = _stack.size();
+	while (_stack.size() >= depth) {
+		token = next();
+		if (token == TOKEN_ERROR || token == TOKEN_END) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+tmln::JsonReader::fill()
+{
+	if (_is == nullptr || ! _is->good()) {
+		return false;
+	}
+	_offset += _end - _begin;
+	_is->read(_buf.data(), _buf.size());
+	_begin = _buf.data();
+	_pos = _buf.data();
+	_end = _pos + _is->gcount();
+	return _pos != _end;
+}
+
+bool
+tmln::JsonReader::peek(char& c)
+{
+	if (_pos == _end && ! fill()) {
+		return false;
+	}
+	c = *_pos;
+	return true;
+}
+
+void
+tmln::JsonReader::skip_ws()
+{
+	char c;
+	while (peek(c) && (c == ' ' || c == '\t' || c == '\n' || c == '\r')) {
+		_pos++;
+	}
+}
+
+tmln::JsonReader::Token
+tmln::JsonReader::value_token(char c)
+{
+	_expect = EXPECT_SEP_OR_END;
+	switch (c) {
+	case '{':
+		_pos++;
+		_stack.push_back(c);
+		_expect = EXPECT_KEY_OR_END;
+		return TOKEN_OBJECT_BEGIN;
+	case '[':
+		_pos++;
+		_stack.push_back(c);
+		_expect = EXPECT_VALUE_OR_END;
+		return TOKEN_ARRAY_BEGIN;
+	case '"':
+		return read_string() ? TOKEN_STRING : error();
+	case 't':
+		return read_literal("true") ? TOKEN_TRUE : error();
+	case 'f':
+		return read_literal("false") ? TOKEN_FALSE : error();
+	case 'n':
+		return read_literal("null") ? TOKEN_NULL : error();
+	default:
+		return read_number() ? TOKEN_NUMBER : error();
+	}
+}
+
+tmln::JsonReader::Token
+tmln::JsonReader::end_token(char c)
+{
+	if (_stack.empty()) {
+		return error();
+	} else if (c == '}' && _stack.back() == '{') {
+		_pos++;
+		_stack.pop_back();
+		_expect = EXPECT_SEP_OR_END;
+		return TOKEN_OBJECT_END;
+	} else if (c == ']' && _stack.back() == '[') {
+		_pos++;
+		_stack.pop_back();
+		_expect = EXPECT_SEP_OR_END;
+		return TOKEN_ARRAY_END;
+	}
+	return error();
+}
+
+tmln::JsonReader::Token
+tmln::JsonReader::error()
+{
+	_expect = EXPECT_ERROR;
+	return TOKEN_ERROR;
+}
+
+/**
+ * Read string at the current position, including the quotes, into
+ * _value with escapes resolved.
+ */
+bool
+tmln::JsonReader::read_string()
+{
+	_value.clear();
+	_pos++;
+
+	char c;
+	for (;;) {
+		if (! peek(c)) {
+			return false;
+		}
+
+		// copy runs without escapes in one go
+		const char* start = _pos;
+		while (_pos != _end && *_pos != '"' && *_pos != '\\'
+		       && static_cast<unsigned char>(*_pos) >= 0x20) {
+			_pos++;
+		}
+		_value.append(start, _pos - start);
+		if (_pos == _end) {
+			continue;
+		}
+
+		c = *_pos++;
+		if (c == '"') {
+			return true;
+		} else if (c != '\\' || ! peek(c)) {
+			return false;
+		}
+
+		_pos++;
+		uint32_t code;
+		switch (c) {
+		case '"':
+		case '\\':
+		case '/':
+			_value.push_back(c);
+			break;
+		case 'b':
+			_value.push_back('\b');
+			break;
+		case 'f':
+			_value.push_back('\f');
+			break;
+		case 'n':
+			_value.push_back('\n');
+			break;
+		case 'r':
+			_value.push_back('\r');
+			break;
+		case 't':
+			_value.push_back('\t');
+			break;
+		case 'u':
+			if (! read_hex(code)) {
+				return false;
+			}
+			if (code >= 0xd800 && code < 0xdc00) {
+				// surrogate pair
+				uint32_t low;
+				if (! read_literal("\\u") || ! read_hex(low)
+				    || low < 0xdc00 || low >= 0xe000) {
+					return false;
+				}
+				code = 0x10000 + ((code - 0xd800) << 10)
+					+ (low - 0xdc00);
+			}
+			put_utf8(code);
+			break;
+		default:
+			return false;
+		}
+	}
+}
+
+bool
+tmln::JsonReader::read_hex(uint32_t& code)
+{
+	code = 0;
+	char c;
+	for (int i = 0; i < 4; i++) {
+		if (! peek(c)) {
+			return false;
+		}
+		_pos++;
+		code <<= 4;
+		if (c >= '0' && c <= '9') {
+			code |= c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			code |= c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			code |= c - 'A' + 10;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+void
+tmln::JsonReader::put_utf8(uint32_t code)
+{
+	if (code < 0x80) {
+		_value.push_back(static_cast<char>(code));
+	} else if (code < 0x800) {
+		_value.push_back(static_cast<char>(0xc0 | (code >> 6)));
+		_value.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+	} else if (code < 0x10000) {
+		_value.push_back(static_cast<char>(0xe0 | (code >> 12)));
+		_value.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+		_value.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+	} else {
+		_value.push_back(static_cast<char>(0xf0 | (code >> 18)));
+		_value.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+		_value.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+		_value.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+	}
+}
+
+/**
+ * Read number text into _value, -?int(.digits)?([eE][+-]?digits)?
+ */
+bool
+tmln::JsonReader::read_number()
+{
+	_value.clear();
+	char c;
+	if (peek(c) && c == '-') {
+		_value.push_back(c);
+		_pos++;
+	}
+
+	int state = 0; // 0 int, 1 fraction, 2 exponent
+	bool digits = false;
+	while (peek(c)) {
+		if (c >= '0' && c <= '9') {
+			digits = true;
+		} else if (c == '.' && state == 0 && digits) {
+			state = 1;
+			digits = false;
+		} else if ((c == 'e' || c == 'E') && state < 2 && digits) {
+			state = 2;
+			digits = false;
+			_value.push_back(c);
+			_pos++;
+			if (peek(c) && (c == '+' || c == '-')) {
+				_value.push_back(c);
+				_pos++;
+			}
+			continue;
+		} else {
+			break;
+		}
+		_value.push_back(c);
+		_pos++;
+	}
+	return digits;
+}
+
+bool
+tmln::JsonReader::read_literal(const char* literal)
+{
+	char c;
+	for (; *literal; literal++) {
+		if (! peek(c) || c != *literal) {
+			return false;
+		}
+		_pos++;
+	}
+	return true;
+}
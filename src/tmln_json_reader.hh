@@ -0,0 +1,125 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+#ifndef _TMLN_JSON_READER_HH_
+#define _TMLN_JSON_READER_HH_
+
+#include "config.h"
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace tmln {
+
+	/**
+	 * Streaming JSON reader, the input is read as a sequence of
+	 * tokens without building a document. Memory use depends only
+	 * on the nesting depth and the size of the largest string.
+	 *
+	 * Input is either an in memory buffer, that must stay valid
+	 * while reading, or a stream read in BUF_SIZE chunks.
+	 *
+	 * With elements set the buffer is read as the elements of an
+	 * array without the surrounding brackets, used to read parts of
+	 * an array.
+	 */
+	class JsonReader {
+	public:
+		static const size_t BUF_SIZE = 64 * 1024;
+
+		enum Token {
+			TOKEN_ERROR,
+			TOKEN_END,
+			TOKEN_OBJECT_BEGIN,
+			TOKEN_OBJECT_END,
+			TOKEN_ARRAY_BEGIN,
+			TOKEN_ARRAY_END,
+			TOKEN_KEY,
+			TOKEN_STRING,
+			TOKEN_NUMBER,
+			TOKEN_TRUE,
+			TOKEN_FALSE,
+			TOKEN_NULL
+		};
+
+		JsonReader(const char* data, size_t size, bool elements = false);
+		JsonReader(std::istream& is);
+		~JsonReader();
+
+		Token next();
+		bool skip(Token token);
+
+		bool is_buffer() const { return _is == nullptr; }
+		const char* buffer_pos() const { return _pos; }
+		const char* buffer_end() const { return _end; }
+		void set_buffer_pos(const char* pos) { _pos = pos; }
+		/** Number of bytes of the input consumed. */
+		size_t offset() const { return _offset + (_pos - _begin); }
+
+		/** Key, string or number text of the last token. */
+		const std::string& value() const { return _value; }
+		/** Number of open objects and arrays. */
+		size_t depth() const { return _stack.size(); }
+
+	private:
+		enum Expect {
+			EXPECT_VALUE,
+			EXPECT_VALUE_OR_END,
+			EXPECT_KEY,
+			EXPECT_KEY_OR_END,
+			EXPECT_SEP_OR_END,
+			EXPECT_ERROR
+		};
+
+		bool fill();
+		bool peek(char& c);
+		void skip_ws();
+
+		Token value_token(char c);
+		Token end_token(char c);
+		Token error();
+		bool read_string();
+		bool read_hex(uint32_t& code);
+		void put_utf8(uint32_t code);
+		bool read_number();
+		bool read_literal(const char* literal);
+
+	private:
+		std::istream* _is;
+		bool _elements;
+		std::vector<char> _buf;
+		/** start of the buffer, at offset in the input. */
+		const char* _begin;
+		size_t _offset;
+		const char* _pos;
+		const char* _end;
+
+		Expect _expect;
+		/** '{' or '[' for each open container. */
+		std::vector<char> _stack;
+		std::string _value;
+	};
+}
+
+#endif // _TMLN_JSON_READER_HH_
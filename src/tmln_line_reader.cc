@@ -0,0 +1,89 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include "tmln_line_reader.hh"
+
+tmln::LineReader::LineReader(std::istream& is, size_t read_size,
+			     bool quotes)
+	: _is(is),
+	  _read_size(read_size),
+	  _quotes(quotes),
+	  _used(0)
+{
+}
+
+tmln::LineReader::~LineReader()
+{
+}
+
+/**
+ * Get the next block of whole lines, valid until the next call. The
+ * last block ends at the end of input with or without a newline.
+ * Returns false at the end of input.
+ */
+bool
+tmln::LineReader::next(const char*& data, size_t& size)
+{
+	_buf.erase(_buf.begin(), _buf.begin() + _used);
+	_used = 0;
+	while (_is.good()) {
+		size_t len = _buf.size();
+		_buf.resize(len + _read_size);
+		_is.read(_buf.data() + len, _read_size);
+		_buf.resize(len + _is.gcount());
+
+		size_t end = _is.good() ? line_end() : _buf.size();
+		if (end > 0) {
+			data = _buf.data();
+			size = end;
+			_used = end;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Get the end of the last whole line in the buffer, 0 if there is none.
+ */
+size_t
+tmln::LineReader::line_end() const
+{
+	size_t end = 0;
+	if (_quotes) {
+		bool quoted = false;
+		for (size_t i = 0; i < _buf.size(); i++) {
+			if (_buf[i] == '"') {
+				quoted = ! quoted;
+			} else if (_buf[i] == '\n' && ! quoted) {
+				end = i + 1;
+			}
+		}
+	} else {
+		end = _buf.size();
+		while (end > 0 && _buf[end - 1] != '\n') {
+			end--;
+		}
+	}
+	return end;
+}
@@ -0,0 +1,64 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+#ifndef _TMLN_LINE_READER_HH_
+#define _TMLN_LINE_READER_HH_
+
+#include "config.h"
+
+#include <istream>
+#include <vector>
+
+namespace tmln {
+
+	/**
+	 * Stream read in blocks of whole lines, the partial line at the
+	 * end of a read is carried over to the next block so only about
+	 * read_size bytes of input are held in memory.
+	 *
+	 * With quotes set newlines inside " quoted fields do not end a
+	 * line, for delimited text with quoted multi line fields.
+	 */
+	class LineReader {
+	public:
+		LineReader(std::istream& is, size_t read_size,
+			   bool quotes = false);
+		~LineReader();
+
+		bool next(const char*& data, size_t& size);
+
+	private:
+		size_t line_end() const;
+
+	private:
+		std::istream& _is;
+		size_t _read_size;
+		bool _quotes;
+
+		/** last returned block followed by the partial line. */
+		std::vector<char> _buf;
+		/** size of the last returned block. */
+		size_t _used;
+	};
+}
+
+#endif // _TMLN_LINE_READER_HH_
@@ -0,0 +1,319 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+
+#include "tmln_data_columnar.hh"
+#include "tmln_live_input.hh"
+#include "tmln_load_json.hh"
+
+const size_t tmln::LiveInput::READ_SIZE;
+const int tmln::LiveInput::HAND_OFF_INTERVAL;
+const size_t tmln::LiveInput::POLL_MAX;
+
+/**
+ * Events and styles parsed by the thread, owned by the thread until
+ * handed off. Raw steps are kept if the data of the LiveInput keeps
+ * them.
+ */
+struct tmln::LiveInput::Batch {
+	Batch(bool raw_steps)
+		: data("live", ColumnarData::STEP_COMPACT,
+		       raw_steps ? &styles : nullptr),
+		  load(data, styles, 1),
+		  empty(true),
+		  status(true)
+	{
+	}
+
+	ColumnarData data;
+	Styles styles;
+	LoadJson load;
+	/** set until lines are loaded into the batch. */
+	bool empty;
+	bool status;
+};
+
+tmln::LiveInput::LiveInput(Data& data, Styles& styles)
+	: _data(data),
+	  _styles(styles),
+	  _status(true),
+	  _batch_pos(0),
+	  _listen_fd(-1)
+{
+	_wake[0] = -1;
+	_wake[1] = -1;
+}
+
+tmln::LiveInput::~LiveInput()
+{
+	close();
+}
+
+/**
+ * Read events from fd until end of input, fd is closed when done.
+ * Must be called before start.
+ */
+bool
+tmln::LiveInput::open_fd(int fd)
+{
+	if (fd == -1 || _thread.joinable()) {
+		return false;
+	}
+	_inputs.push_back(Input{fd, std::vector<char>()});
+	return true;
+}
+
+/**
+ * Listen for clients on Unix domain socket at path, each client
+ * sends events until it disconnects. A stale socket at path is
+ * replaced. Must be called before start.
+ */
+bool
+tmln::LiveInput::listen(const std::string& path)
+{
+	struct sockaddr_un addr;
+	if (_listen_fd != -1 || _thread.joinable()
+	    || path.size() >= sizeof(addr.sun_path)) {
+		return false;
+	}
+
+	struct stat st;
+	if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+		unlink(path.c_str());
+	}
+
+	_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (_listen_fd == -1) {
+		return false;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	if (bind(_listen_fd, reinterpret_cast<struct sockaddr*>(&addr),
+		 sizeof(addr)) == -1
+	    || ::listen(_listen_fd, SOMAXCONN) == -1) {
+		::close(_listen_fd);
+		_listen_fd = -1;
+		return false;
+	}
+	_listen_path = path;
+	return true;
+}
+
+/**
+ * Start reading inputs in a thread.
+ */
+bool
+tmln::LiveInput::start()
+{
+	if (_thread.joinable() || pipe(_wake) == -1) {
+		return false;
+	}
+	_thread = std::thread([this]() { run(); });
+	return true;
+}
+
+/**
+ * Stop reading, events read but not yet taken with poll are dropped.
+ */
+void
+tmln::LiveInput::close()
+{
+	if (_thread.joinable()) {
+		char c = 0;
+		while (write(_wake[1], &c, 1) == -1 && errno == EINTR) {
+		}
+		_thread.join();
+	}
+	for (int& fd : _wake) {
+		if (fd != -1) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+	for (Input& input : _inputs) {
+		::close(input.fd);
+	}
+	_inputs.clear();
+	if (_listen_fd != -1) {
+		::close(_listen_fd);
+		_listen_fd = -1;
+		unlink(_listen_path.c_str());
+	}
+	_ready.reset();
+	_batch.reset();
+}
+
+/**
+ * Append at most POLL_MAX events of the batch handed off by the thread
+ * to the data, the next batch is taken once all events of the current
+ * one are added. Returns the number of events added.
+ */
+size_t
+tmln::LiveInput::poll()
+{
+	if (! _batch) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_batch.swap(_ready);
+		}
+		if (! _batch) {
+			return 0;
+		}
+
+		if (! _batch->status) {
+			_status = false;
+		}
+		_styles.add_styles(_batch->styles);
+		_map = IdMap();
+		_batch->data.map_ids(_data, _styles, _map);
+		_batch_pos = 0;
+	}
+
+	size_t num_events = _data.size();
+	size_t end = std::min(_batch->data.size(), _batch_pos + POLL_MAX);
+	_data.append(_batch->data, _batch_pos, end, _map);
+	_batch_pos = end;
+	if (_batch_pos == _batch->data.size()) {
+		_batch.reset();
+	}
+	return _data.size() - num_events;
+}
+
+/**
+ * Read inputs until closed or all inputs end, lines read while the
+ * previous batch is not yet taken are added to the current batch.
+ */
+void
+tmln::LiveInput::run()
+{
+	std::unique_ptr<Batch> batch(new Batch(_data.stores_raw_steps()));
+	std::vector<struct pollfd> fds;
+	while (_listen_fd != -1 || ! _inputs.empty() || ! batch->empty) {
+		fds.clear();
+		fds.push_back(pollfd{_wake[0], POLLIN, 0});
+		if (_listen_fd != -1) {
+			fds.push_back(pollfd{_listen_fd, POLLIN, 0});
+		}
+		for (const Input& input : _inputs) {
+			fds.push_back(pollfd{input.fd, POLLIN, 0});
+		}
+
+		int timeout = batch->empty ? -1 : HAND_OFF_INTERVAL;
+		if (::poll(fds.data(), fds.size(), timeout) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		if (fds[0].revents) {
+			break;
+		}
+
+		size_t j = _listen_fd == -1 ? 1 : 2;
+		for (size_t i = 0; i < _inputs.size(); j++) {
+			if (fds[j].revents == 0
+			    || read_input(_inputs[i], *batch)) {
+				i++;
+			} else {
+				::close(_inputs[i].fd);
+				_inputs.erase(_inputs.begin() + i);
+			}
+		}
+		if (_listen_fd != -1 && (fds[1].revents & POLLIN)) {
+			accept_input();
+		}
+
+		if (! batch->empty) {
+			hand_off(batch);
+		}
+	}
+}
+
+void
+tmln::LiveInput::accept_input()
+{
+	int fd = accept(_listen_fd, nullptr, nullptr);
+	if (fd != -1) {
+		_inputs.push_back(Input{fd, std::vector<char>()});
+	}
+}
+
+/**
+ * Read from input and load complete lines into batch, returns false
+ * at end of input. The last line is loaded at end of input even if
+ * not terminated by a newline.
+ */
+bool
+tmln::LiveInput::read_input(Input& input, Batch& batch)
+{
+	size_t len = input.buf.size();
+	input.buf.resize(len + READ_SIZE);
+	ssize_t nread = read(input.fd, input.buf.data() + len, READ_SIZE);
+	input.buf.resize(len + (nread > 0 ? nread : 0));
+	if (nread == -1 && (errno == EINTR || errno == EAGAIN)) {
+		return true;
+	}
+
+	size_t line_end = input.buf.size();
+	if (nread > 0) {
+		while (line_end > len && input.buf[line_end - 1] != '\n') {
+			line_end--;
+		}
+		if (line_end == len) {
+			return true;
+		}
+	}
+	if (line_end > 0) {
+		if (! batch.load.load_lines(input.buf.data(), line_end)) {
+			batch.status = false;
+		}
+		batch.empty = false;
+	}
+	input.buf.erase(input.buf.begin(), input.buf.begin() + line_end);
+	return nread > 0;
+}
+
+/**
+ * Hand off batch if the previous batch has been taken, batch is
+ * replaced with an empty batch when handed off.
+ */
+bool
+tmln::LiveInput::hand_off(std::unique_ptr<Batch>& batch)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_ready) {
+		return false;
+	}
+	_ready.swap(batch);
+	batch.reset(new Batch(_data.stores_raw_steps()));
+	return true;
+}
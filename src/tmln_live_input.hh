@@ -0,0 +1,113 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_LIVE_INPUT_HH_
+#define _TMLN_LIVE_INPUT_HH_
+
+#include "config.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tmln_data.hh"
+#include "tmln_style.hh"
+
+namespace tmln {
+
+	/**
+	 * NDJSON events streamed from a pipe, such as stdin, or from
+	 * clients connecting to a Unix domain socket, see LoadJson.
+	 *
+	 * Input is read and parsed by a thread into a batch with its own
+	 * data and styles. The batch is handed off once the previous one
+	 * has been taken with poll, poll appends at most POLL_MAX events
+	 * of the taken batch per call and takes the next batch once all
+	 * of them are added. The caller controls the rate events are
+	 * added to the data by how often it polls. Events are appended
+	 * without finalizing the data as for FollowFile.
+	 */
+	class LiveInput {
+	public:
+		/** Size of reads from inputs. */
+		static const size_t READ_SIZE = 64 * 1024;
+		/** Milliseconds between hand-off attempts of a batch. */
+		static const int HAND_OFF_INTERVAL = 50;
+		/** Maximum number of events added to the data per poll. */
+		static const size_t POLL_MAX = 32 * 1024;
+
+		LiveInput(Data& data, Styles& styles);
+		LiveInput(const LiveInput&) = delete;
+		LiveInput& operator=(const LiveInput&) = delete;
+		~LiveInput();
+
+		bool open_fd(int fd);
+		bool listen(const std::string& path);
+		bool start();
+		void close();
+
+		size_t poll();
+		/** false if any line read so far was invalid. */
+		bool status() const { return _status; }
+
+	private:
+		struct Batch;
+		struct Input {
+			int fd;
+			/** incomplete last line followed by data read. */
+			std::vector<char> buf;
+		};
+
+		void run();
+		void accept_input();
+		bool read_input(Input& input, Batch& batch);
+		bool hand_off(std::unique_ptr<Batch>& batch);
+
+	private:
+		Data& _data;
+		Styles& _styles;
+		bool _status;
+		/** batch taken with poll, being added to the data. */
+		std::unique_ptr<Batch> _batch;
+		/** next event of _batch to add. */
+		size_t _batch_pos;
+		/** strings and styles of _batch in the data. */
+		IdMap _map;
+
+		int _listen_fd;
+		std::string _listen_path;
+		/** pipe waking up the thread when closing. */
+		int _wake[2];
+		/** inputs being read, only used by the thread once started. */
+		std::vector<Input> _inputs;
+		std::thread _thread;
+
+		std::mutex _mutex;
+		/** batch ready to be added to the data, guarded by _mutex. */
+		std::unique_ptr<Batch> _ready;
+	};
+}
+
+#endif // _TMLN_LIVE_INPUT_HH_
@@ -0,0 +1,488 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+#include "tmln_data_columnar.hh"
+#include "tmln_load_async.hh"
+
+const size_t tmln::LoadAsync::BATCH_MIN;
+const size_t tmln::LoadAsync::POLL_MAX;
+
+/**
+ * Events of a batch, referencing only the styles of the batch. The
+ * styles are defined from the styles of the load function when the
+ * batch is handed off. Raw steps are kept if the data of the LoadAsync
+ * keeps them.
+ */
+struct tmln::LoadAsync::Batch {
+	Batch(bool raw_steps)
+		: data("batch",
+		       raw_steps ? ColumnarData::STEP_COMPACT
+				 : ColumnarData::STEP_COLUMNS,
+		       &styles)
+	{
+	}
+
+	ColumnarData data;
+	Styles styles;
+};
+
+/**
+ * Data store given to the load function, events are added to the
+ * current batch. Only events of the current batch are accessible.
+ */
+class tmln::LoadAsync::BatchData : public Data {
+public:
+	BatchData(State& state);
+	virtual ~BatchData();
+
+	virtual const TsSpan& span() const override { return _span; }
+	virtual size_t size() const override { return _size; }
+	virtual size_t begin() const override { return 0; }
+	virtual size_t end() const override { return _size; }
+	virtual const Event& operator[](size_t idx) const override;
+	virtual bool add_event(const Event& event) override;
+	using Data::add_event;
+	virtual EventBuilder emplace_event(StrRef label,
+					   StrRef info,
+					   const Ts& start,
+					   const Ts& end,
+					   const Style& style) override;
+	virtual bool set_event_source(size_t idx, size_t source) override;
+	virtual void finalize() override;
+	virtual bool cancelled() const override;
+	virtual void add_progress(size_t bytes) override;
+	virtual bool stores_raw_steps() const override;
+
+protected:
+	virtual bool emplace_step(size_t idx,
+				  StrRef label, StrRef info,
+				  const Ts& start, const Ts& end,
+				  const Style& style) override;
+	virtual bool emplace_raw_steps(
+		size_t idx, const std::shared_ptr<const StepDecoder>& decoder,
+		const char* data, size_t size, const Ts& offset) override;
+
+private:
+	const Style& batch_style(const Style& style);
+	bool hand_off(bool force);
+
+private:
+	State& _state;
+	TsSpan _span;
+	size_t _size;
+	std::unique_ptr<Batch> _batch;
+	/** index of the first event of the current batch. */
+	size_t _batch_begin;
+	/** builder of the last event in the current batch. */
+	EventBuilder _builder;
+	/** style of the current batch, indexed by StyleId. */
+	std::vector<const Style*> _style_map;
+};
+
+/**
+ * State shared with the thread, kept until both the thread and the
+ * LoadAsync are done with it.
+ */
+struct tmln::LoadAsync::State {
+	State(bool raw_steps)
+		: raw_steps(raw_steps),
+		  data(*this),
+		  loaded(false),
+		  status(true),
+		  cancel(false),
+		  num_loaded(0),
+		  num_bytes(0)
+	{
+	}
+
+	/** set if the data of the LoadAsync keeps raw steps. */
+	const bool raw_steps;
+	/** data and styles of the load function, used by the thread. */
+	BatchData data;
+	Styles styles;
+
+	std::mutex mutex;
+	/** batches handed off, guarded by mutex. */
+	std::vector<std::unique_ptr<Batch>> ready;
+	/** set when the load function has returned, guarded by mutex. */
+	bool loaded;
+	bool status;
+
+	std::atomic<bool> cancel;
+	std::atomic<size_t> num_loaded;
+	/** bytes of the input parsed by the load function. */
+	std::atomic<size_t> num_bytes;
+};
+
+tmln::LoadAsync::BatchData::BatchData(State& state)
+	: Data("async"),
+	  _state(state),
+	  _span(Ts(), Ts()),
+	  _size(0),
+	  _batch(new Batch(state.raw_steps)),
+	  _batch_begin(0)
+{
+}
+
+tmln::LoadAsync::BatchData::~BatchData()
+{
+}
+
+/**
+ * Get event at idx, which must be in the current batch.
+ */
+const tmln::Event&
+tmln::LoadAsync::BatchData::operator[](size_t idx) const
+{
+	assert(idx >= _batch_begin && idx < _size);
+	return _batch->data[idx - _batch_begin];
+}
+
+bool
+tmln::LoadAsync::BatchData::add_event(const Event& event)
+{
+	EventBuilder builder = emplace_event(event.label_ref(),
+					     event.info_ref(),
+					     event.start(), event.end(),
+					     event.style());
+	if (! builder.valid()) {
+		return false;
+	}
+	Event::step_iterator it = event.cbegin();
+	for (; it != event.cend(); ++it) {
+		builder.add_step(it->label_ref(), it->info_ref(),
+				 it->start(), it->end(), it->style());
+	}
+	return true;
+}
+
+/**
+ * Add event to the current batch, the batch is handed off before the
+ * event is added every BATCH_MIN events. Events are discarded once
+ * loading is cancelled.
+ */
+tmln::EventBuilder
+tmln::LoadAsync::BatchData::emplace_event(StrRef label,
+					  StrRef info,
+					  const Ts& start, const Ts& end,
+					  const Style& style)
+{
+	if (_state.cancel) {
+		_builder = EventBuilder();
+		return _builder;
+	}
+	if (_batch->data.size() >= BATCH_MIN
+	    && _batch->data.size() % BATCH_MIN == 0) {
+		hand_off(false);
+	}
+
+	_builder = _batch->data.emplace_event(label, info, start, end,
+					      batch_style(style));
+	if (_size == 0) {
+		_span = TsSpan(start, end);
+	} else {
+		if (start < _span.start()) {
+			_span.set_start(start);
+		}
+		if (end > _span.end()) {
+			_span.set_end(end);
+		}
+	}
+	return EventBuilder(this, _size++);
+}
+
+bool
+tmln::LoadAsync::BatchData::set_event_source(size_t idx, size_t source)
+{
+	if (! _builder.valid() || idx + 1 != _size) {
+		return false;
+	}
+	return _batch->data.set_event_source(_builder.idx(), source);
+}
+
+/**
+ * Hand off the remaining events, the data is finalized once all
+ * batches are added to the data of the LoadAsync.
+ */
+void
+tmln::LoadAsync::BatchData::finalize()
+{
+	hand_off(true);
+}
+
+bool
+tmln::LoadAsync::BatchData::cancelled() const
+{
+	return _state.cancel;
+}
+
+void
+tmln::LoadAsync::BatchData::add_progress(size_t bytes)
+{
+	_state.num_bytes += bytes;
+}
+
+bool
+tmln::LoadAsync::BatchData::stores_raw_steps() const
+{
+	return _state.raw_steps;
+}
+
+bool
+tmln::LoadAsync::BatchData::emplace_step(size_t idx,
+					 StrRef label, StrRef info,
+					 const Ts& start, const Ts& end,
+					 const Style& style)
+{
+	if (idx + 1 != _size) {
+		return false;
+	}
+	return _builder.add_step(label, info, start, end, batch_style(style));
+}
+
+bool
+tmln::LoadAsync::BatchData::emplace_raw_steps(
+	size_t idx, const std::shared_ptr<const StepDecoder>& decoder,
+	const char* data, size_t size, const Ts& offset)
+{
+	if (idx + 1 != _size) {
+		return false;
+	}
+	return _builder.add_raw_steps(decoder, data, size, offset);
+}
+
+/**
+ * Get style of the current batch with the name of style, a style of
+ * the load function. Colors are set when the batch is handed off.
+ */
+const tmln::Style&
+tmln::LoadAsync::BatchData::batch_style(const Style& style)
+{
+	if (style.id() == 0) {
+		return _batch->styles.default_style();
+	}
+	if (_style_map.size() <= style.id()) {
+		_style_map.resize(style.id() + 1, nullptr);
+	}
+	const Style*& mapped = _style_map[style.id()];
+	if (mapped == nullptr) {
+		mapped = &_batch->styles.ref_style(style.name());
+	}
+	return *mapped;
+}
+
+/**
+ * Hand off the current batch if the previous has been taken, or always
+ * if force is set.
+ */
+bool
+tmln::LoadAsync::BatchData::hand_off(bool force)
+{
+	_state.num_loaded = _size;
+	if (_batch->data.size() == 0) {
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(_state.mutex);
+	if (! force && ! _state.ready.empty()) {
+		return false;
+	}
+	// define the styles referenced by the batch, the styles of the
+	// load function are not read outside of the thread
+	_batch->styles.add_styles(_state.styles);
+	_state.ready.push_back(std::move(_batch));
+	_batch.reset(new Batch(_state.raw_steps));
+	_batch_begin = _size;
+	_builder = EventBuilder();
+	_style_map.clear();
+	return true;
+}
+
+tmln::LoadAsync::LoadAsync(Data& data, Styles& styles)
+	: _data(data),
+	  _styles(styles),
+	  _done(false),
+	  _cancelled(false),
+	  _status(true),
+	  _batch_pos(0)
+{
+}
+
+tmln::LoadAsync::~LoadAsync()
+{
+	if (_thread.joinable()) {
+		_state->cancel = true;
+		_thread.join();
+	}
+}
+
+/**
+ * Start loading using load in a thread.
+ */
+bool
+tmln::LoadAsync::start(load_fun load)
+{
+	if (_state) {
+		return false;
+	}
+
+	_state = std::make_shared<State>(_data.stores_raw_steps());
+	std::shared_ptr<State> state = _state;
+	_thread = std::thread([state, load]() {
+		bool status = load(state->data, state->styles);
+		state->data.finalize();
+
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->loaded = true;
+		state->status = status;
+	});
+	return true;
+}
+
+/**
+ * Stop loading and wait for the load function to return, the data is
+ * finalized with the events added so far.
+ */
+void
+tmln::LoadAsync::cancel()
+{
+	if (! _state || _done) {
+		return;
+	}
+
+	_state->cancel = true;
+	_thread.join();
+	_cancelled = true;
+	_batches.clear();
+	_state->ready.clear();
+	_data.finalize();
+	_done = true;
+}
+
+/**
+ * Append at most POLL_MAX events handed off by the thread to the data,
+ * the rest are kept for the next call. Returns the number of events
+ * added, the data is finalized when the last events are added.
+ */
+size_t
+tmln::LoadAsync::poll()
+{
+	if (! _state || _done) {
+		return 0;
+	}
+
+	bool loaded = take_batches();
+	size_t num_events = _data.size();
+	size_t num = 0;
+	while (! _batches.empty() && num < POLL_MAX) {
+		Batch& batch = *_batches.front();
+		if (_batch_pos == 0) {
+			_styles.add_styles(batch.styles);
+			_map = IdMap();
+			batch.data.map_ids(_data, _styles, _map);
+		}
+		size_t end = std::min(batch.data.size(),
+				      _batch_pos + POLL_MAX - num);
+		size_t size = _data.size();
+		_data.append(batch.data, _batch_pos, end, _map);
+		// sources are only set when no event was rejected, the
+		// data index of events is not known otherwise
+		if (_data.size() - size == end - _batch_pos) {
+			for (size_t i = _batch_pos; i < end; i++, size++) {
+				size_t source = batch.data.event_source(i);
+				if (source != 0) {
+					_data.set_event_source(size, source);
+				}
+			}
+		}
+		num += end - _batch_pos;
+		_batch_pos = end;
+		if (_batch_pos == batch.data.size()) {
+			_batches.pop_front();
+			_batch_pos = 0;
+		}
+	}
+
+	if (loaded && _batches.empty()) {
+		finish();
+	}
+	return _data.size() - num_events;
+}
+
+/**
+ * Events parsed by the load function so far, updated as batches are
+ * handed off.
+ */
+size_t
+tmln::LoadAsync::num_loaded() const
+{
+	return _state ? _state->num_loaded.load() : 0;
+}
+
+/**
+ * Bytes of the input parsed by the load function so far, as reported
+ * by the loaders.
+ */
+size_t
+tmln::LoadAsync::num_bytes() const
+{
+	return _state ? _state->num_bytes.load() : 0;
+}
+
+/**
+ * Take batches handed off since the last call, returns true if the
+ * load function has returned and all batches are taken.
+ */
+bool
+tmln::LoadAsync::take_batches()
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	for (std::unique_ptr<Batch>& batch : _state->ready) {
+		_batches.push_back(std::move(batch));
+	}
+	_state->ready.clear();
+	_status = _state->status;
+	return _state->loaded;
+}
+
+/**
+ * Add the sources and remaining styles of the load function, called
+ * when the thread is done.
+ */
+void
+tmln::LoadAsync::finish()
+{
+	_thread.join();
+	_styles.add_styles(_state->styles);
+	const std::vector<std::string>& sources = _state->data.sources();
+	for (size_t i = 1; i < sources.size(); i++) {
+		_data.add_source(sources[i]);
+	}
+	_data.finalize();
+	_done = true;
+}
@@ -0,0 +1,107 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_LOAD_ASYNC_HH_
+#define _TMLN_LOAD_ASYNC_HH_
+
+#include "config.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "tmln_data.hh"
+#include "tmln_style.hh"
+
+namespace tmln {
+
+	/**
+	 * Load events in a background thread while the data is viewed.
+	 *
+	 * The load function is called in a thread with a data store
+	 * that collects events in batches, with their own data and
+	 * styles, handed off once the previous batch has been taken.
+	 * poll appends at most POLL_MAX events per call to the data,
+	 * with the strings and styles of a batch mapped to the data
+	 * once, giving the caller a prefix of the input to render while
+	 * loading. The data is finalized once all events have been
+	 * added.
+	 *
+	 * cancel sets the data store cancelled, checked by loaders
+	 * between events, and waits for the load function to return.
+	 */
+	class LoadAsync {
+	public:
+		typedef std::function<bool(Data& data, Styles& styles)>
+			load_fun;
+
+		/** Events added to a batch between hand-off attempts. */
+		static const size_t BATCH_MIN = 4096;
+		/** Maximum number of events added to the data per poll. */
+		static const size_t POLL_MAX = 32 * 1024;
+
+		LoadAsync(Data& data, Styles& styles);
+		LoadAsync(const LoadAsync&) = delete;
+		LoadAsync& operator=(const LoadAsync&) = delete;
+		~LoadAsync();
+
+		bool start(load_fun load);
+		void cancel();
+		size_t poll();
+
+		/** Set when all events are added, or loading cancelled. */
+		bool done() const { return _done; }
+		bool cancelled() const { return _cancelled; }
+		/** false if the load function failed. */
+		bool status() const { return _status; }
+		size_t num_loaded() const;
+		size_t num_bytes() const;
+
+	private:
+		class BatchData;
+		struct Batch;
+		struct State;
+
+		bool take_batches();
+		void finish();
+
+	private:
+		Data& _data;
+		Styles& _styles;
+		bool _done;
+		bool _cancelled;
+		bool _status;
+
+		std::shared_ptr<State> _state;
+		std::thread _thread;
+		/** batches taken from the thread, being added to the data. */
+		std::deque<std::unique_ptr<Batch>> _batches;
+		/** next event of the first batch to add. */
+		size_t _batch_pos;
+		/** strings and styles of the first batch in the data. */
+		IdMap _map;
+	};
+}
+
+#endif // _TMLN_LOAD_ASYNC_HH_
@@ -0,0 +1,388 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+
+#include "tmln_file_input.hh"
+#include "tmln_load_chrome.hh"
+
+/** Microseconds, the unit of ts and dur. */
+static const int64_t UNIT_NS = 1000;
+
+void
+tmln::LoadChrome::TraceEvent::clear()
+{
+	name.clear();
+	cat.clear();
+	ph.clear();
+	ts.clear();
+	dur.clear();
+	pid.clear();
+	tid.clear();
+	arg_name.clear();
+}
+
+tmln::LoadChrome::Thread::Thread(const std::string& _pid,
+				 const std::string& _tid)
+	: pid(_pid),
+	  tid(_tid),
+	  name(0)
+{
+}
+
+tmln::LoadChrome::LoadChrome(Data& data, Styles& styles)
+	: _data(data),
+	  _styles(styles)
+{
+}
+
+tmln::LoadChrome::~LoadChrome()
+{
+}
+
+/**
+ * Check if the object the reader is positioned in has key at the top
+ * level, values of other keys are skipped.
+ */
+static bool
+has_key(tmln::JsonReader& reader, const char* key)
+{
+	tmln::JsonReader::Token token;
+	while ((token = reader.next()) == tmln::JsonReader::TOKEN_KEY) {
+		if (reader.value() == key) {
+			return true;
+		} else if (! reader.skip(reader.next())) {
+			return false;
+		}
+	}
+	return false;
+}
+
+/**
+ * Check if data looks like a trace event file, an object with a
+ * top level traceEvents key or an array starting with an object with
+ * a ph key. Only the first 64 KiB of data is looked at.
+ */
+bool
+tmln::LoadChrome::is_chrome_trace(const char* data, size_t size)
+{
+	JsonReader reader(data, std::min(size, size_t(64 * 1024)));
+	JsonReader::Token token = reader.next();
+	if (token == JsonReader::TOKEN_OBJECT_BEGIN) {
+		return has_key(reader, "traceEvents");
+	} else if (token == JsonReader::TOKEN_ARRAY_BEGIN) {
+		return reader.next() == JsonReader::TOKEN_OBJECT_BEGIN
+			&& has_key(reader, "ph");
+	}
+	return false;
+}
+
+bool
+tmln::LoadChrome::load_file(const std::string& path)
+{
+	FileInput input;
+	if (! input.open(path)) {
+		return false;
+	}
+	return load(input.data(), input.size());
+}
+
+bool
+tmln::LoadChrome::load(const std::string& in)
+{
+	return load(in.data(), in.size());
+}
+
+bool
+tmln::LoadChrome::load(const char* data, size_t size)
+{
+	JsonReader reader(data, size);
+	return load(reader);
+}
+
+/**
+ * Load trace events from reader, threads are added to the data once
+ * all of the input has been read.
+ */
+bool
+tmln::LoadChrome::load(JsonReader& reader)
+{
+	bool status = load_root(reader);
+	add_threads();
+	_data.finalize();
+	return status && ! _data.cancelled();
+}
+
+bool
+tmln::LoadChrome::load_root(JsonReader& reader)
+{
+	JsonReader::Token token = reader.next();
+	if (token == JsonReader::TOKEN_ARRAY_BEGIN) {
+		return load_events(reader)
+			&& reader.next() == JsonReader::TOKEN_END;
+	} else if (token != JsonReader::TOKEN_OBJECT_BEGIN) {
+		return false;
+	}
+
+	bool has_events = false;
+	while ((token = reader.next()) == JsonReader::TOKEN_KEY) {
+		bool is_events = reader.value() == "traceEvents";
+		token = reader.next();
+		if (is_events) {
+			if (token != JsonReader::TOKEN_ARRAY_BEGIN
+			    || ! load_events(reader)) {
+				return false;
+			}
+			has_events = true;
+		} else if (! reader.skip(token)) {
+			return false;
+		}
+	}
+
+	return token == JsonReader::TOKEN_OBJECT_END
+		&& reader.next() == JsonReader::TOKEN_END
+		&& has_events;
+}
+
+bool
+tmln::LoadChrome::load_events(JsonReader& reader)
+{
+	JsonReader::Token token;
+	size_t offset = reader.offset();
+	while ((token = reader.next()) != JsonReader::TOKEN_ARRAY_END) {
+		if (_data.cancelled()) {
+			return false;
+		} else if (token == JsonReader::TOKEN_OBJECT_BEGIN) {
+			if (! read_event(reader)) {
+				return false;
+			}
+			load_event();
+		} else if (! reader.skip(token)) {
+			return false;
+		}
+		_data.add_progress(reader.offset() - offset);
+		offset = reader.offset();
+	}
+	return true;
+}
+
+bool
+tmln::LoadChrome::read_event(JsonReader& reader)
+{
+	_event.clear();
+
+	JsonReader::Token token;
+	while ((token = reader.next()) == JsonReader::TOKEN_KEY) {
+		const std::string& key = reader.value();
+		std::string* field = nullptr;
+		if (key == "name") {
+			field = &_event.name;
+		} else if (key == "cat") {
+			field = &_event.cat;
+		} else if (key == "ph") {
+			field = &_event.ph;
+		} else if (key == "ts") {
+			field = &_event.ts;
+		} else if (key == "dur") {
+			field = &_event.dur;
+		} else if (key == "pid") {
+			field = &_event.pid;
+		} else if (key == "tid") {
+			field = &_event.tid;
+		}
+		bool is_args = key == "args";
+
+		token = reader.next();
+		if (is_args && token == JsonReader::TOKEN_OBJECT_BEGIN) {
+			if (! read_args(reader)) {
+				return false;
+			}
+		} else if (field != nullptr
+			   && (token == JsonReader::TOKEN_STRING
+			       || token == JsonReader::TOKEN_NUMBER)) {
+			*field = reader.value();
+		} else if (! reader.skip(token)) {
+			return false;
+		}
+	}
+	return token == JsonReader::TOKEN_OBJECT_END;
+}
+
+bool
+tmln::LoadChrome::read_args(JsonReader& reader)
+{
+	JsonReader::Token token;
+	while ((token = reader.next()) == JsonReader::TOKEN_KEY) {
+		bool is_name = reader.value() == "name";
+		token = reader.next();
+		if (is_name && token == JsonReader::TOKEN_STRING) {
+			_event.arg_name = reader.value();
+		} else if (! reader.skip(token)) {
+			return false;
+		}
+	}
+	return token == JsonReader::TOKEN_OBJECT_END;
+}
+
+void
+tmln::LoadChrome::load_event()
+{
+	if (_event.ph.size() != 1) {
+		return;
+	}
+
+	StringPool& strings = _data.strings();
+	char ph = _event.ph[0];
+	if (ph == 'M') {
+		if (_event.name == "thread_name") {
+			thread(_event.pid, _event.tid).name =
+				strings.intern_id(_event.arg_name);
+		} else if (_event.name == "process_name") {
+			_process_names[_event.pid] =
+				strings.intern_id(_event.arg_name);
+		}
+		return;
+	} else if (ph != 'X' && ph != 'B' && ph != 'E') {
+		return;
+	}
+
+	Slice slice;
+	if (! Ts::parse_number(_event.ts.c_str(), UNIT_NS, slice.start)) {
+		return;
+	}
+	if (_end < slice.start) {
+		_end = slice.start;
+	}
+
+	Thread& t = thread(_event.pid, _event.tid);
+	if (ph == 'X') {
+		Ts dur;
+		if (! Ts::parse_number(_event.dur.c_str(), UNIT_NS, dur)) {
+			return;
+		}
+		slice.end = slice.start + dur;
+		slice.name = strings.intern_id(_event.name);
+		slice.cat = strings.intern_id(_event.cat);
+		add_slice(t, slice);
+	} else if (ph == 'B') {
+		slice.end = slice.start;
+		slice.name = strings.intern_id(_event.name);
+		slice.cat = strings.intern_id(_event.cat);
+		t.stack.push_back(slice);
+	} else if (! t.stack.empty()) {
+		Slice begin = t.stack.back();
+		t.stack.pop_back();
+		begin.end = slice.start;
+		add_slice(t, begin);
+	}
+}
+
+void
+tmln::LoadChrome::add_slice(Thread& thread, const Slice& slice)
+{
+	thread.slices.push_back(slice);
+	if (_end < slice.end) {
+		_end = slice.end;
+	}
+}
+
+/**
+ * Add one event per thread with the slices as steps, ordered by start.
+ */
+void
+tmln::LoadChrome::add_threads()
+{
+	StringPool& strings = _data.strings();
+	for (Thread& thread : _threads) {
+		if (_data.cancelled()) {
+			break;
+		}
+		while (! thread.stack.empty()) {
+			thread.stack.back().end = _end;
+			thread.slices.push_back(thread.stack.back());
+			thread.stack.pop_back();
+		}
+		if (thread.slices.empty()) {
+			continue;
+		}
+
+		std::stable_sort(thread.slices.begin(), thread.slices.end(),
+				 [](const Slice& lhs, const Slice& rhs) {
+					 return lhs.start < rhs.start;
+				 });
+		Ts end = thread.slices[0].end;
+		for (const Slice& slice : thread.slices) {
+			if (end < slice.end) {
+				end = slice.end;
+			}
+		}
+
+		std::string label = thread.name
+			? strings.str(thread.name) : thread.pid + "/" + thread.tid;
+		std::map<std::string, StrId>::iterator process =
+			_process_names.find(thread.pid);
+		std::string info = process != _process_names.end()
+			? strings.str(process->second) : "pid " + thread.pid;
+
+		EventBuilder event =
+			_data.emplace_event(strings.intern(label),
+					    strings.intern(info),
+					    thread.slices[0].start, end,
+					    _styles.default_style());
+		for (const Slice& slice : thread.slices) {
+			event.add_step(strings.ref(slice.name),
+				       strings.ref(slice.cat),
+				       slice.start, slice.end,
+				       slice_style(slice.name));
+		}
+		std::vector<Slice>().swap(thread.slices);
+	}
+	_threads.clear();
+	_thread_idx.clear();
+}
+
+tmln::LoadChrome::Thread&
+tmln::LoadChrome::thread(const std::string& pid, const std::string& tid)
+{
+	_key = pid;
+	_key += '/';
+	_key += tid;
+	std::unordered_map<std::string, size_t>::iterator it =
+		_thread_idx.find(_key);
+	if (it != _thread_idx.end()) {
+		return _threads[it->second];
+	}
+	_thread_idx.emplace(_key, _threads.size());
+	_threads.emplace_back(pid, tid);
+	return _threads.back();
+}
+
+/**
+ * Style of slices with name, picked from the palette by name so that
+ * slices with the same name get the same color.
+ */
+const tmln::Style&
+tmln::LoadChrome::slice_style(StrId name)
+{
+	return _styles.palette_style(name);
+}
@@ -0,0 +1,132 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_LOAD_CHROME_HH_
+#define _TMLN_LOAD_CHROME_HH_
+
+#include "config.h"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tmln_data.hh"
+#include "tmln_json_reader.hh"
+#include "tmln_string_pool.hh"
+#include "tmln_style.hh"
+
+namespace tmln {
+
+	/**
+	 * Load events from Chrome trace event format JSON, either an
+	 * array of trace events or {"traceEvents": [trace_event]}.
+	 *
+	 * trace_event: {"name": string,
+	 *               "cat": string,
+	 *               "ph": "X" | "B" | "E" | "M",
+	 *               "ts": number (us),
+	 *               "dur": number (us),
+	 *               "pid": number | string,
+	 *               "tid": number | string,
+	 *               "args": {"name": string}}
+	 *
+	 * Each pid/tid pair becomes one event with the slices, complete
+	 * events and B/E pairs, as steps. thread_name and process_name
+	 * metadata events name the event. Other phases are ignored.
+	 *
+	 * The input is read in a single pass, B/E pairs are matched
+	 * using one stack per thread and slices still open at the end
+	 * of the input end at the last timestamp in the trace.
+	 */
+	class LoadChrome {
+	public:
+		LoadChrome(Data& data, Styles& styles);
+		~LoadChrome();
+
+		static bool is_chrome_trace(const char* data, size_t size);
+
+		bool load_file(const std::string& path);
+		bool load(const std::string& in);
+		bool load(const char* data, size_t size);
+		bool load(JsonReader& reader);
+
+	private:
+		/** Fields of the current trace event. */
+		struct TraceEvent {
+			void clear();
+
+			std::string name;
+			std::string cat;
+			std::string ph;
+			std::string ts;
+			std::string dur;
+			std::string pid;
+			std::string tid;
+			std::string arg_name;
+		};
+
+		struct Slice {
+			Ts start;
+			Ts end;
+			StrId name;
+			StrId cat;
+		};
+
+		struct Thread {
+			Thread(const std::string& pid, const std::string& tid);
+
+			std::string pid;
+			std::string tid;
+			StrId name;
+			std::vector<Slice> slices;
+			/** open B events, end is not set. */
+			std::vector<Slice> stack;
+		};
+
+		bool load_root(JsonReader& reader);
+		bool load_events(JsonReader& reader);
+		bool read_event(JsonReader& reader);
+		bool read_args(JsonReader& reader);
+		void load_event();
+		void add_slice(Thread& thread, const Slice& slice);
+		void add_threads();
+
+		Thread& thread(const std::string& pid, const std::string& tid);
+		const Style& slice_style(StrId name);
+
+	private:
+		Data& _data;
+		Styles& _styles;
+
+		TraceEvent _event;
+		std::string _key;
+		std::unordered_map<std::string, size_t> _thread_idx;
+		std::vector<Thread> _threads;
+		std::map<std::string, StrId> _process_names;
+		/** latest timestamp in the trace. */
+		Ts _end;
+	};
+}
+
+#endif // _TMLN_LOAD_CHROME_HH_
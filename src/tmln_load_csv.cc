@@ -0,0 +1,580 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <thread>
+
+#include "tmln_file_input.hh"
+#include "tmln_line_reader.hh"
+#include "tmln_load_csv.hh"
+
+const size_t tmln::LoadCsv::PARALLEL_MIN;
+const size_t tmln::LoadCsv::READ_SIZE;
+
+/**
+ * Rows of a line aligned part of the input, parsed into one array per
+ * column with strings in a chunk local pool.
+ */
+struct tmln::LoadCsv::Chunk {
+	Chunk(const char* begin, const char* end)
+		: _begin(begin),
+		  _end(end),
+		  _status(true)
+	{
+	}
+
+	size_t size() const { return _start.size(); }
+
+	const char* _begin;
+	const char* _end;
+	StringPool _strings;
+	std::vector<StrId> _id;
+	std::vector<StrId> _label;
+	std::vector<StrId> _info;
+	std::vector<StrId> _step_label;
+	std::vector<StrId> _style;
+	std::vector<Ts> _start;
+	std::vector<Ts> _end_ts;
+	bool _status;
+
+	/**
+	 * chunk string id to data string id, filled when merging. 0 is
+	 * the empty string in both pools and marks ids not yet merged.
+	 */
+	std::vector<StrId> _merged;
+	std::vector<const Style*> _merged_styles;
+};
+
+/**
+ * Split the row at pos into fields, returns the start of the next row
+ * or nullptr if a quoted field is not terminated.
+ */
+static const char*
+parse_row(const char* pos, const char* end, char delimiter,
+	  std::vector<std::string>& fields, size_t& num_fields)
+{
+	num_fields = 0;
+	for (;;) {
+		if (num_fields == fields.size()) {
+			fields.emplace_back();
+		}
+		std::string& field = fields[num_fields++];
+		field.clear();
+
+		if (pos < end && *pos == '"') {
+			for (pos++; ; pos++) {
+				const char* quote = static_cast<const char*>(
+					memchr(pos, '"', end - pos));
+				if (quote == nullptr) {
+					return nullptr;
+				}
+				field.append(pos, quote - pos);
+				pos = quote + 1;
+				if (pos == end || *pos != '"') {
+					break;
+				}
+				field.push_back('"');
+			}
+		}
+
+		const char* start = pos;
+		while (pos < end && *pos != delimiter && *pos != '\n') {
+			pos++;
+		}
+		field.append(start, pos - start);
+		if (pos < end && *pos == delimiter) {
+			pos++;
+			continue;
+		}
+
+		if (pos != start && pos[-1] == '\r') {
+			field.pop_back();
+		}
+		return pos < end ? pos + 1 : end;
+	}
+}
+
+/**
+ * Count " in [begin, end).
+ */
+static size_t
+count_quotes(const char* begin, const char* end)
+{
+	size_t num = 0;
+	while ((begin = static_cast<const char*>(
+			memchr(begin, '"', end - begin))) != nullptr) {
+		num++;
+		begin++;
+	}
+	return num;
+}
+
+tmln::LoadCsv::LoadCsv(Data& data, Styles& styles, unsigned int num_threads)
+	: _data(data),
+	  _styles(styles),
+	  _num_threads(num_threads),
+	  _delimiter(0),
+	  _header(true),
+	  _unit_ns(NSEC_PER_SEC)
+{
+	if (_num_threads == 0) {
+		_num_threads = std::thread::hardware_concurrency();
+	}
+	_names[COLUMN_LABEL] = "label";
+	_names[COLUMN_START] = "start";
+	_names[COLUMN_END] = "end";
+	std::fill(_columns, _columns + NUM_COLUMNS, -1);
+}
+
+tmln::LoadCsv::~LoadCsv()
+{
+}
+
+/**
+ * Map column to the field with header name, or index, name. An empty
+ * name unmaps the column.
+ */
+void
+tmln::LoadCsv::set_column(Column column, const std::string& name)
+{
+	_names[column] = name;
+}
+
+bool
+tmln::LoadCsv::load_file(const std::string& path)
+{
+	FileInput input;
+	if (! input.open(path)) {
+		return false;
+	}
+	return load(input.data(), input.size());
+}
+
+bool
+tmln::LoadCsv::load(const std::string& in)
+{
+	return load(in.data(), in.size());
+}
+
+bool
+tmln::LoadCsv::load(const char* data, size_t size)
+{
+	const char* pos = data;
+	const char* end = data + size;
+	char delimiter;
+	if (! load_header(pos, end, delimiter)) {
+		return false;
+	}
+
+	chunk_vector chunks;
+	bool status = parse_rows(pos, end, delimiter, chunks);
+	if (_columns[COLUMN_EVENT_ID] == -1) {
+		add_events(chunks);
+	} else {
+		add_grouped_events(chunks);
+	}
+	_data.finalize();
+	return status && ! _data.cancelled();
+}
+
+/**
+ * Load rows from is READ_SIZE bytes at a time. Without an event id
+ * column rows are added as they are read, otherwise only the parsed
+ * rows are kept until the end of input.
+ */
+bool
+tmln::LoadCsv::load(std::istream& is)
+{
+	LineReader reader(is, READ_SIZE, true);
+	const char* data;
+	size_t size;
+	if (! reader.next(data, size)) {
+		return false;
+	}
+	const char* pos = data;
+	char delimiter;
+	if (! load_header(pos, data + size, delimiter)) {
+		return false;
+	}
+
+	bool grouped = _columns[COLUMN_EVENT_ID] != -1;
+	bool status = true;
+	chunk_vector chunks;
+	for (;;) {
+		chunk_vector block;
+		status = parse_rows(pos, data + size, delimiter, block)
+			&& status;
+		if (grouped) {
+			std::move(block.begin(), block.end(),
+				  std::back_inserter(chunks));
+		} else {
+			add_events(block);
+		}
+		if (_data.cancelled() || ! reader.next(data, size)) {
+			break;
+		}
+		pos = data;
+	}
+
+	if (grouped) {
+		add_grouped_events(chunks);
+	}
+	_data.finalize();
+	return status && ! _data.cancelled();
+}
+
+/**
+ * Detect the delimiter and map columns from the header row at pos,
+ * pos is moved past the header.
+ */
+bool
+tmln::LoadCsv::load_header(const char*& pos, const char* end,
+			   char& delimiter)
+{
+	delimiter = _delimiter;
+	if (delimiter == 0) {
+		const char* eol =
+			static_cast<const char*>(memchr(pos, '\n', end - pos));
+		const char* line_end = eol ? eol : end;
+		delimiter = memchr(pos, '\t', line_end - pos) ? '\t' : ',';
+	}
+
+	std::vector<std::string> header;
+	if (_header) {
+		size_t num_fields;
+		pos = parse_row(pos, end, delimiter, header, num_fields);
+		if (pos == nullptr) {
+			return false;
+		}
+		header.resize(num_fields);
+	}
+	return map_columns(header);
+}
+
+/**
+ * Parse rows in [pos, end) into chunks, in parallel for large input.
+ * Returns false if any chunk had an unterminated quoted field.
+ */
+bool
+tmln::LoadCsv::parse_rows(const char* pos, const char* end,
+			  char delimiter, chunk_vector& chunks)
+{
+	split_chunks(pos, end, chunks);
+	if (chunks.size() == 1) {
+		parse_chunk(*chunks[0], delimiter);
+	} else {
+		std::vector<std::thread> threads;
+		for (std::unique_ptr<Chunk>& chunk : chunks) {
+			Chunk* chunk_ptr = chunk.get();
+			threads.emplace_back([this, chunk_ptr, delimiter]() {
+				parse_chunk(*chunk_ptr, delimiter);
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	bool status = true;
+	for (std::unique_ptr<Chunk>& chunk : chunks) {
+		status = status && chunk->_status;
+	}
+	return status;
+}
+
+bool
+tmln::LoadCsv::map_columns(const std::vector<std::string>& header)
+{
+	for (int i = 0; i < NUM_COLUMNS; i++) {
+		const std::string& name = _names[i];
+		std::vector<std::string>::const_iterator it =
+			std::find(header.begin(), header.end(), name);
+		if (name.empty()) {
+			_columns[i] = -1;
+		} else if (it != header.end()) {
+			_columns[i] = it - header.begin();
+		} else if (name.find_first_not_of("0123456789")
+			   == std::string::npos) {
+			_columns[i] = atoi(name.c_str());
+		} else {
+			_columns[i] = -1;
+		}
+	}
+	return _columns[COLUMN_START] != -1 && _columns[COLUMN_END] != -1
+		&& (_columns[COLUMN_LABEL] != -1
+		    || _columns[COLUMN_EVENT_ID] != -1);
+}
+
+/**
+ * Split [pos, end) into one chunk per thread at row boundaries, rows
+ * may contain newlines inside quotes so " are counted to only split
+ * at newlines outside of quotes.
+ */
+void
+tmln::LoadCsv::split_chunks(const char* pos, const char* end,
+			    chunk_vector& chunks)
+{
+	size_t size = end - pos;
+	if (_num_threads < 2 || size < PARALLEL_MIN) {
+		chunks.emplace_back(new Chunk(pos, end));
+		return;
+	}
+
+	bool has_quotes = memchr(pos, '"', size) != nullptr;
+	size_t chunk_size = size / _num_threads;
+	size_t num_quotes = 0;
+	const char* chunk_start = pos;
+	const char* scan = pos;
+	for (unsigned int i = 1; i < _num_threads; i++) {
+		const char* split = pos + i * chunk_size;
+		if (split <= scan) {
+			continue;
+		}
+		if (has_quotes) {
+			num_quotes += count_quotes(scan, split);
+		}
+		scan = split;
+
+		const char* eol;
+		while ((eol = static_cast<const char*>(
+				memchr(scan, '\n', end - scan))) != nullptr) {
+			if (has_quotes) {
+				num_quotes += count_quotes(scan, eol);
+			}
+			scan = eol + 1;
+			if (num_quotes % 2 == 0) {
+				break;
+			}
+		}
+		if (eol == nullptr) {
+			break;
+		}
+		chunks.emplace_back(new Chunk(chunk_start, scan));
+		chunk_start = scan;
+	}
+	chunks.emplace_back(new Chunk(chunk_start, end));
+}
+
+void
+tmln::LoadCsv::parse_chunk(Chunk& chunk, char delimiter) const
+{
+	std::vector<std::string> fields;
+	size_t num_fields;
+	const int* columns = _columns;
+	const char* pos = chunk._begin;
+	while (pos < chunk._end) {
+		const char* row = pos;
+		pos = parse_row(pos, chunk._end, delimiter, fields, num_fields);
+		if (pos == nullptr) {
+			chunk._status = false;
+			return;
+		}
+		_data.add_progress(pos - row);
+
+		const std::string* values[NUM_COLUMNS];
+		for (int i = 0; i < NUM_COLUMNS; i++) {
+			values[i] = columns[i] >= 0
+				&& static_cast<size_t>(columns[i]) < num_fields
+				? &fields[columns[i]] : nullptr;
+		}
+
+		Ts start, end;
+		if (values[COLUMN_START] == nullptr
+		    || values[COLUMN_END] == nullptr
+		    || ! parse_ts(*values[COLUMN_START], start)
+		    || ! parse_ts(*values[COLUMN_END], end)
+		    || (columns[COLUMN_EVENT_ID] != -1
+			? values[COLUMN_EVENT_ID] == nullptr
+			: values[COLUMN_LABEL] == nullptr)) {
+			// empty or incomplete row
+			continue;
+		}
+
+		StringPool& strings = chunk._strings;
+		StrId ids[NUM_COLUMNS];
+		for (int i = 0; i < NUM_COLUMNS; i++) {
+			ids[i] = values[i] ? strings.intern_id(*values[i]) : 0;
+		}
+		chunk._id.push_back(ids[COLUMN_EVENT_ID]);
+		chunk._label.push_back(ids[COLUMN_LABEL]);
+		chunk._info.push_back(ids[COLUMN_INFO]);
+		chunk._step_label.push_back(ids[COLUMN_STEP_LABEL]);
+		chunk._style.push_back(ids[COLUMN_STYLE]);
+		chunk._start.push_back(start);
+		chunk._end_ts.push_back(end);
+	}
+}
+
+bool
+tmln::LoadCsv::parse_ts(const std::string& str, Ts& ts) const
+{
+	if (Ts::parse_iso8601(str.data(), str.size(), ts)) {
+		return true;
+	}
+	return Ts::parse_number(str.c_str(), _unit_ns, ts);
+}
+
+/**
+ * Add one event per row, in input order.
+ */
+void
+tmln::LoadCsv::add_events(chunk_vector& chunks)
+{
+	for (std::unique_ptr<Chunk>& chunk : chunks) {
+		if (_data.cancelled()) {
+			break;
+		}
+		for (size_t i = 0; i < chunk->size(); i++) {
+			_data.emplace_event(merge_str(*chunk, chunk->_label[i]),
+					    merge_str(*chunk, chunk->_info[i]),
+					    chunk->_start[i], chunk->_end_ts[i],
+					    merge_style(*chunk,
+							chunk->_style[i]));
+		}
+	}
+}
+
+/**
+ * Add one event per event id, in order of first appearance, with the
+ * rows as steps ordered by start.
+ */
+void
+tmln::LoadCsv::add_grouped_events(chunk_vector& chunks)
+{
+	struct RowRef {
+		uint32_t chunk;
+		uint32_t row;
+	};
+
+	// number events by first appearance of their id
+	StringPool ids;
+	std::vector<uint32_t> id_event;
+	std::vector<uint32_t> row_event;
+	std::vector<size_t> offset(1, 0);
+	for (std::unique_ptr<Chunk>& chunk : chunks) {
+		for (size_t i = 0; i < chunk->size(); i++) {
+			StrId id = ids.intern_id(
+				chunk->_strings.str(chunk->_id[i]));
+			if (id >= id_event.size()) {
+				id_event.resize(id + 1, 0);
+			}
+			if (id_event[id] == 0) {
+				offset.push_back(0);
+				id_event[id] = offset.size() - 1;
+			}
+			row_event.push_back(id_event[id] - 1);
+			offset[id_event[id]]++;
+		}
+	}
+	for (size_t i = 1; i < offset.size(); i++) {
+		offset[i] += offset[i - 1];
+	}
+
+	// group rows by event, keeping input order
+	std::vector<RowRef> rows(row_event.size());
+	std::vector<size_t> fill(offset.begin(), offset.end() - 1);
+	size_t row = 0;
+	for (uint32_t c = 0; c < chunks.size(); c++) {
+		for (uint32_t i = 0; i < chunks[c]->size(); i++, row++) {
+			RowRef& ref = rows[fill[row_event[row]]++];
+			ref.chunk = c;
+			ref.row = i;
+		}
+	}
+
+	for (size_t e = 0; e + 1 < offset.size() && ! _data.cancelled();
+	     e++) {
+		std::vector<RowRef>::iterator begin = rows.begin() + offset[e];
+		std::vector<RowRef>::iterator end = rows.begin() + offset[e + 1];
+		Chunk& first = *chunks[begin->chunk];
+		uint32_t first_row = begin->row;
+
+		Ts start = first._start[first_row];
+		Ts stop = first._end_ts[first_row];
+		for (std::vector<RowRef>::iterator it = begin; it != end; ++it) {
+			const Chunk& chunk = *chunks[it->chunk];
+			start = std::min(start, chunk._start[it->row]);
+			stop = std::max(stop, chunk._end_ts[it->row]);
+		}
+
+		StrId label = _columns[COLUMN_LABEL] != -1
+			? first._label[first_row] : first._id[first_row];
+		EventBuilder event =
+			_data.emplace_event(merge_str(first, label),
+					    merge_str(first,
+						      first._info[first_row]),
+					    start, stop,
+					    merge_style(first,
+							first._style[first_row]));
+
+		std::stable_sort(begin, end,
+				 [&chunks](const RowRef& lhs, const RowRef& rhs) {
+					 return chunks[lhs.chunk]->_start[lhs.row]
+						 < chunks[rhs.chunk]->_start[rhs.row];
+				 });
+		for (std::vector<RowRef>::iterator it = begin; it != end; ++it) {
+			Chunk& chunk = *chunks[it->chunk];
+			StrId step_label = _columns[COLUMN_STEP_LABEL] != -1
+				? chunk._step_label[it->row]
+				: chunk._label[it->row];
+			event.add_step(merge_str(chunk, step_label),
+				       merge_str(chunk, 0),
+				       chunk._start[it->row],
+				       chunk._end_ts[it->row],
+				       merge_style(chunk, chunk._style[it->row]));
+		}
+	}
+}
+
+/**
+ * Get string id of chunk interned in the data string pool.
+ */
+tmln::StrRef
+tmln::LoadCsv::merge_str(Chunk& chunk, StrId id)
+{
+	if (chunk._merged.size() < chunk._strings.size()) {
+		chunk._merged.resize(chunk._strings.size(), 0);
+	}
+	StringPool& strings = _data.strings();
+	if (id != 0 && chunk._merged[id] == 0) {
+		chunk._merged[id] = strings.intern_id(chunk._strings.str(id));
+	}
+	return strings.ref(chunk._merged[id]);
+}
+
+const tmln::Style&
+tmln::LoadCsv::merge_style(Chunk& chunk, StrId id)
+{
+	if (chunk._merged_styles.size() < chunk._strings.size()) {
+		chunk._merged_styles.resize(chunk._strings.size(), nullptr);
+	}
+	if (chunk._merged_styles[id] == nullptr) {
+		const std::string& name = chunk._strings.str(id);
+		chunk._merged_styles[id] = name.empty()
+			? &_styles.default_style() : &_styles.ref_style(name);
+	}
+	return *chunk._merged_styles[id];
+}
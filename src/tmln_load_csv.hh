@@ -0,0 +1,127 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_LOAD_CSV_HH_
+#define _TMLN_LOAD_CSV_HH_
+
+#include "config.h"
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tmln_data.hh"
+#include "tmln_string_pool.hh"
+#include "tmln_style.hh"
+
+namespace tmln {
+
+	/**
+	 * Load events from delimited text, CSV or TSV, with one event
+	 * or step per row.
+	 *
+	 * Columns are mapped by header name, or by index if there is no
+	 * header or the name is a number. Default mapping is label,
+	 * start, end with the other columns unmapped.
+	 *
+	 * Without an event id column every row is an event. With an
+	 * event id column rows with the same id are steps of one event,
+	 * using the step label column (or label) for the step and
+	 * label, info and style of the first row for the event.
+	 *
+	 * Timestamps are ISO-8601 or numbers in unit since the epoch.
+	 * Fields may be quoted with ", "" is a quote in quoted fields.
+	 *
+	 * Rows are parsed into per column arrays in num_threads line
+	 * aligned chunks in parallel, 0 uses one thread per hardware
+	 * thread, and added to the data in input order. Streams are
+	 * parsed READ_SIZE bytes of whole rows at a time.
+	 */
+	class LoadCsv {
+	public:
+		enum Column {
+			COLUMN_EVENT_ID,
+			COLUMN_LABEL,
+			COLUMN_INFO,
+			COLUMN_STEP_LABEL,
+			COLUMN_START,
+			COLUMN_END,
+			COLUMN_STYLE,
+			NUM_COLUMNS
+		};
+
+		/** inputs smaller than this are parsed in one chunk. */
+		static const size_t PARALLEL_MIN = 1024 * 1024;
+		/** size of the blocks streams are parsed in. */
+		static const size_t READ_SIZE = 4 * 1024 * 1024;
+
+		LoadCsv(Data& data, Styles& styles,
+			unsigned int num_threads = 0);
+		~LoadCsv();
+
+		void set_column(Column column, const std::string& name);
+		/** field delimiter, 0 uses tab if found in the first line. */
+		void set_delimiter(char delimiter) { _delimiter = delimiter; }
+		void set_header(bool header) { _header = header; }
+		void set_unit(int64_t unit_ns) { _unit_ns = unit_ns; }
+
+		bool load_file(const std::string& path);
+		bool load(const std::string& in);
+		bool load(const char* data, size_t size);
+		bool load(std::istream& is);
+
+	private:
+		struct Chunk;
+		typedef std::vector<std::unique_ptr<Chunk>> chunk_vector;
+
+		bool load_header(const char*& pos, const char* end,
+				 char& delimiter);
+		bool map_columns(const std::vector<std::string>& header);
+		bool parse_rows(const char* pos, const char* end,
+				char delimiter, chunk_vector& chunks);
+		void split_chunks(const char* pos, const char* end,
+				  chunk_vector& chunks);
+		void parse_chunk(Chunk& chunk, char delimiter) const;
+		bool parse_ts(const std::string& str, Ts& ts) const;
+
+		void add_events(chunk_vector& chunks);
+		void add_grouped_events(chunk_vector& chunks);
+		StrRef merge_str(Chunk& chunk, StrId id);
+		const Style& merge_style(Chunk& chunk, StrId id);
+
+	private:
+		Data& _data;
+		Styles& _styles;
+		unsigned int _num_threads;
+
+		std::string _names[NUM_COLUMNS];
+		/** field index of each column, -1 if unmapped. */
+		int _columns[NUM_COLUMNS];
+		char _delimiter;
+		bool _header;
+		int64_t _unit_ns;
+	};
+}
+
+#endif // _TMLN_LOAD_CSV_HH_
@@ -0,0 +1,312 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <thread>
+
+#include "tmln_data_columnar.hh"
+#include "tmln_load_files.hh"
+
+/**
+ * Data of a single file, cancelled when loading into the merged data
+ * is. Progress is reported to the merged data, raw steps are kept if
+ * the merged data keeps them.
+ */
+class tmln::LoadFiles::FileData : public ColumnarData {
+public:
+	FileData(const std::string& path, Data& merged, Styles& styles)
+		: ColumnarData(path, ColumnarData::STEP_COMPACT,
+			       merged.stores_raw_steps() ? &styles : nullptr),
+		  _merged(merged)
+	{
+	}
+
+	virtual bool cancelled() const override
+	{
+		return _merged.cancelled();
+	}
+
+	virtual void add_progress(size_t bytes) override
+	{
+		_merged.add_progress(bytes);
+	}
+
+private:
+	Data& _merged;
+};
+
+/**
+ * Data and styles of a single file, loaded by one of the threads.
+ */
+struct tmln::LoadFiles::File {
+	File(const std::string& path, Data& merged)
+		: data(path, merged, styles),
+		  status(false),
+		  source(0)
+	{
+	}
+
+	FileData data;
+	Styles styles;
+	bool status;
+	/** added to all timestamps of the file when merged. */
+	Ts offset;
+	/** source of the file in the merged data. */
+	size_t source;
+	/** strings and styles of the file in the merged data. */
+	IdMap map;
+};
+
+tmln::LoadFiles::LoadFiles(Data& data, Styles& styles, load_fun load,
+			   unsigned int num_threads)
+	: _data(data),
+	  _styles(styles),
+	  _load(load),
+	  _num_threads(num_threads)
+{
+	if (_num_threads == 0) {
+		_num_threads = std::thread::hardware_concurrency();
+	}
+	if (_num_threads == 0) {
+		_num_threads = 1;
+	}
+}
+
+tmln::LoadFiles::~LoadFiles()
+{
+}
+
+/**
+ * Set offset of the file at path, overrides estimated offsets.
+ */
+void
+tmln::LoadFiles::set_offset(const std::string& path, const Ts& offset)
+{
+	_offset[path] = offset;
+}
+
+/**
+ * Estimate offsets of files from events with label, empty label
+ * disables estimation.
+ */
+void
+tmln::LoadFiles::set_align_marker(const std::string& label)
+{
+	_align_marker = label;
+}
+
+/**
+ * Load paths into the data, returns false if any of the files failed
+ * to load or loading was cancelled. Events of the files that loaded,
+ * fully or partly, are merged regardless.
+ */
+bool
+tmln::LoadFiles::load(const std::vector<std::string>& paths)
+{
+	_failed.clear();
+	_offsets.clear();
+
+	std::vector<std::unique_ptr<File>> files;
+	for (const std::string& path : paths) {
+		files.emplace_back(new File(path, _data));
+	}
+	load_files(files);
+
+	for (std::unique_ptr<File>& file : files) {
+		if (! file->status) {
+			_failed.push_back(file->data.source());
+		}
+	}
+
+	align(files);
+	for (std::unique_ptr<File>& file : files) {
+		_offsets.push_back(file->offset);
+	}
+
+	merge(files);
+	_data.finalize();
+	return _failed.empty();
+}
+
+/**
+ * Load files in parallel, threads take the next file not yet loaded
+ * until all are loaded. Loaders finalize the data of the file, sorting
+ * it by start, the interval index of the file is never built as it is
+ * only built on use.
+ */
+void
+tmln::LoadFiles::load_files(std::vector<std::unique_ptr<File>>& files)
+{
+	std::atomic<size_t> next(0);
+	std::function<void()> worker = [this, &files, &next]() {
+		size_t idx;
+		while ((idx = next++) < files.size()
+		       && ! _data.cancelled()) {
+			File& file = *files[idx];
+			file.status = _load(file.data.source(), file.data,
+					    file.styles);
+		}
+	};
+
+	size_t num_threads = std::min(static_cast<size_t>(_num_threads),
+				      files.size());
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < num_threads; i++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+/**
+ * Set offset of files, explicit offsets are used as is and the others
+ * are estimated from markers relative to the first file with markers.
+ */
+void
+tmln::LoadFiles::align(std::vector<std::unique_ptr<File>>& files)
+{
+	std::vector<bool> is_set(files.size(), false);
+	for (size_t i = 0; i < files.size(); i++) {
+		auto it = _offset.find(files[i]->data.source());
+		if (it != _offset.end()) {
+			files[i]->offset = it->second;
+			is_set[i] = true;
+		}
+	}
+	if (_align_marker.empty()) {
+		return;
+	}
+
+	File* ref = nullptr;
+	std::vector<Ts> ref_markers;
+	for (size_t i = 0; i < files.size(); i++) {
+		std::vector<Ts> file_markers = markers(*files[i]);
+		if (file_markers.empty()) {
+			continue;
+		} else if (ref == nullptr) {
+			ref = files[i].get();
+			ref_markers.swap(file_markers);
+			continue;
+		} else if (is_set[i]) {
+			continue;
+		}
+
+		std::vector<int64_t> diffs;
+		for (size_t j = 0;
+		     j < file_markers.size() && j < ref_markers.size(); j++) {
+			diffs.push_back((ref_markers[j] - file_markers[j]).ns());
+		}
+		auto median = diffs.begin() + diffs.size() / 2;
+		std::nth_element(diffs.begin(), median, diffs.end());
+		files[i]->offset = ref->offset + Ts::from_ns(*median);
+	}
+}
+
+/**
+ * Start of the marker events of file, in start order.
+ */
+std::vector<tmln::Ts>
+tmln::LoadFiles::markers(File& file) const
+{
+	std::vector<Ts> starts;
+	StrId marker = file.data.strings().intern_id(_align_marker);
+	for (size_t i = 0; i < file.data.size(); i++) {
+		if (file.data.label_id(i) == marker) {
+			starts.push_back(file.data.event_span(i).start());
+		}
+	}
+	return starts;
+}
+
+/**
+ * Merge events of the sorted files into the data in start order,
+ * with the offset of the file applied, events with equal start are
+ * added in file order. Runs of events from the same file are appended
+ * in one call with the ids of the file remapped, the data of a file is
+ * freed once all of its events are merged. Files with events or steps
+ * rejected by the data are added to the failed files.
+ */
+void
+tmln::LoadFiles::merge(std::vector<std::unique_ptr<File>>& files)
+{
+	typedef std::pair<Ts, std::pair<size_t, size_t>> head;
+	std::priority_queue<head, std::vector<head>, std::greater<head>> heads;
+
+	for (size_t i = 0; i < files.size(); i++) {
+		File& file = *files[i];
+		file.source = _data.add_source(file.data.source());
+
+		// Styles of the file are added up front, mapping styles
+		// by name only finds defined styles.
+		_styles.add_styles(file.styles);
+		file.data.map_ids(_data, _styles, file.map);
+
+		if (file.data.size() > 0) {
+			heads.emplace(file.data.event_span(0).start()
+				      + file.offset,
+				      std::make_pair(i, 0));
+		}
+	}
+
+	while (! heads.empty() && ! _data.cancelled()) {
+		size_t file_idx = heads.top().second.first;
+		size_t begin = heads.top().second.second;
+		heads.pop();
+
+		// extend the run while the next event of the file is
+		// before the next event of any other file.
+		File& file = *files[file_idx];
+		size_t end = begin + 1;
+		for (; end < file.data.size(); end++) {
+			head next(file.data.event_span(end).start()
+				  + file.offset,
+				  std::make_pair(file_idx, end));
+			if (! heads.empty() && heads.top() < next) {
+				break;
+			}
+		}
+
+		size_t size = _data.size();
+		if (! _data.append(file.data, begin, end, file.map,
+				   file.offset)
+		    && file.status) {
+			file.status = false;
+			_failed.push_back(file.data.source());
+		}
+		for (; size < _data.size(); size++) {
+			_data.set_event_source(size, file.source);
+		}
+		if (end < file.data.size()) {
+			heads.emplace(file.data.event_span(end).start()
+				      + file.offset,
+				      std::make_pair(file_idx, end));
+		} else {
+			files[file_idx].reset();
+		}
+	}
+}
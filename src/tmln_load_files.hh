@@ -0,0 +1,109 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_LOAD_FILES_HH_
+#define _TMLN_LOAD_FILES_HH_
+
+#include "config.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tmln_data.hh"
+#include "tmln_style.hh"
+
+namespace tmln {
+
+	/**
+	 * Load events from many files into one data store.
+	 *
+	 * Files are loaded with the load function, one file at a time
+	 * per thread using num_threads threads, 0 uses one thread per
+	 * hardware thread. Each file is loaded into its own data and
+	 * styles, finalized by the load function as loaders do, and then
+	 * k-way merged into the data in start order.
+	 *
+	 * Each file is added as a source of the data and its events are
+	 * tagged with the source, for data stores supporting it.
+	 *
+	 * Files from hosts with skewed clocks are aligned with a per file
+	 * offset added to all timestamps as events are merged. Offsets
+	 * are set explicitly with set_offset or estimated from marker
+	 * events with the label set with set_align_marker, expected to
+	 * happen at the same time in all files. The n:th marker of each
+	 * file is paired with the n:th marker of the first file with
+	 * markers and the median difference is used.
+	 */
+	class LoadFiles {
+	public:
+		typedef std::function<bool(const std::string& path,
+					   Data& data, Styles& styles)>
+			load_fun;
+
+		LoadFiles(Data& data, Styles& styles, load_fun load,
+			  unsigned int num_threads = 0);
+		~LoadFiles();
+
+		void set_offset(const std::string& path, const Ts& offset);
+		void set_align_marker(const std::string& label);
+
+		bool load(const std::vector<std::string>& paths);
+
+		/** Offset applied to each file, in the order of paths. */
+		const std::vector<Ts>& offsets() const { return _offsets; }
+
+		/**
+		 * Paths of files that failed to load, fully or partly,
+		 * or had events rejected by the data when merged.
+		 */
+		const std::vector<std::string>& failed() const
+		{
+			return _failed;
+		}
+
+	private:
+		class FileData;
+		struct File;
+
+		void load_files(std::vector<std::unique_ptr<File>>& files);
+		void align(std::vector<std::unique_ptr<File>>& files);
+		std::vector<Ts> markers(File& file) const;
+		void merge(std::vector<std::unique_ptr<File>>& files);
+
+	private:
+		Data& _data;
+		Styles& _styles;
+		load_fun _load;
+		unsigned int _num_threads;
+		/** explicit offsets by path. */
+		std::map<std::string, Ts> _offset;
+		std::string _align_marker;
+		std::vector<Ts> _offsets;
+		std::vector<std::string> _failed;
+	};
+}
+
+#endif // _TMLN_LOAD_FILES_HH_
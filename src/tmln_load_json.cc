@@ -20,67 +20,199 @@
 // IN THE SOFTWARE.
 // 
 
-#include <cstdarg>
-#include <iostream>
-#include <fstream>
-#include <sstream>
-
-#include "json11.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <thread>
 
+#include "tmln_data_columnar.hh"
+#include "tmln_file_input.hh"
+#include "tmln_line_reader.hh"
 #include "tmln_load_json.hh"
 
-namespace tmln {
-	static const int STRING = (1 << 0);
-	static const int OBJ = (1 << 1);
-	static const int ARRAY = (1 << 2);
-	static const int REQUIRED = (1 << 3);
-}
+static const char* OBJ_FIELDS[] = {
+	"label", "info", "start", "end", "style", "dur", "name", "fg", "bg",
+	"type"
+};
 
-static bool
-validate_obj(const json11::Json *obj, ...)
+void
+tmln::LoadJson::Obj::clear()
 {
-	if (obj == nullptr || ! obj->is_object()) {
-		return false;
+	for (int i = 0; i < NUM_FIELDS; i++) {
+		_values[i].clear();
+		_set[i] = false;
+		_number[i] = false;
 	}
+	_valid = true;
+}
 
-	bool status = true;
+/**
+ * Part of an events array, or NDJSON lines, loaded in a separate
+ * thread into its own data and styles. Chunks use the unit and base
+ * in effect where the events array starts, these can not change within
+ * the array and only apply to events after them.
+ */
+struct tmln::LoadJson::Chunk {
+	Chunk(const LoadJson& parent, const char* begin, const char* end,
+	      bool lines = false)
+		: _parent(parent),
+		  _begin(begin),
+		  _end(end),
+		  _lines(lines),
+		  _data("chunk",
+			parent._raw_steps ? ColumnarData::STEP_COMPACT
+					  : ColumnarData::STEP_COLUMNS,
+			&_styles),
+		  _status(false)
+	{
+	}
 
-	va_list ap;
-	va_start(ap, obj);
-	const char* field = va_arg(ap, const char*);
-	while (status && field != nullptr) {
-		void* res = va_arg(ap, void*);
-		int flags = va_arg(ap, int);
-
-		const json11::Json& obj_field = (*obj)[field];
-		if (obj_field == nullptr || obj_field.is_null()) {
-			status = !(flags & tmln::REQUIRED);
-		} else if ((flags & tmln::STRING) && obj_field.is_string()) {
-			std::string* str_res = static_cast<std::string*>(res);
-			*str_res = obj_field.string_value();
-		} else if ((flags & tmln::OBJ) && obj_field.is_object()) {
-			const json11::Json** json_res =
-				static_cast<const json11::Json**>(res);
-			*json_res = &obj_field;
-		} else if ((flags & tmln::ARRAY) && obj_field.is_array()) {
-			const json11::Json::array** json_res =
-				static_cast<const json11::Json::array**>(res);
-			*json_res = &(obj_field.array_items());
+	void load()
+	{
+		JsonReader reader(_begin, _end - _begin, true);
+		LoadJson load(_data, _styles, 1);
+		load._unit_ns = _parent._unit_ns;
+		load._base = _parent._base;
+		load._step_decoder = _parent._step_decoder;
+		if (_lines) {
+			_status = load.load_lines(_begin, _end - _begin);
 		} else {
-			status = false;
+			_status = load.load_events(reader)
+				&& reader.next() == JsonReader::TOKEN_END;
 		}
+	}
 
-		field = va_arg(ap, const char*);
+	const LoadJson& _parent;
+	const char* _begin;
+	const char* _end;
+	bool _lines;
+	ColumnarData _data;
+	Styles _styles;
+	bool _status;
+};
+
+/**
+ * Parser of "steps" arrays added to events as text, with the unit and
+ * base in effect where the array was read.
+ */
+class tmln::LoadJson::RawSteps : public StepDecoder {
+public:
+	RawSteps(int64_t unit_ns, const Ts& base)
+		: _unit_ns(unit_ns),
+		  _base(base)
+	{
 	}
-	va_end(ap);
 
-	return status;
+	virtual void decode(const char* data, size_t size,
+			    const Ts& offset, StringPool& strings,
+			    Styles& styles, Event& event) const override;
+
+private:
+	int64_t _unit_ns;
+	Ts _base;
 };
 
-tmln::LoadJson::LoadJson(Data& data, Styles& styles)
+/**
+ * Parse the elements of a steps array, steps are added as load_step
+ * adds them.
+ */
+void
+tmln::LoadJson::RawSteps::decode(const char* data, size_t size,
+				 const Ts& offset, StringPool& strings,
+				 Styles& styles, Event& event) const
+{
+	JsonReader reader(data, size, true);
+	Obj obj;
+	JsonReader::Token token;
+	while ((token = reader.next()) != JsonReader::TOKEN_ARRAY_END) {
+		if (token != JsonReader::TOKEN_OBJECT_BEGIN) {
+			if (! reader.skip(token)) {
+				return;
+			}
+			continue;
+		} else if (! read_obj(reader, obj, nullptr)) {
+			return;
+		}
+
+		Ts start, end;
+		if (! obj._valid || ! obj.has(Obj::LABEL)
+		    || ! obj_span(obj, _unit_ns, _base, start, end)) {
+			continue;
+		}
+		const std::string& style = obj.get(Obj::STYLE);
+		event.add_step(strings.intern(obj.get(Obj::LABEL)),
+			       strings.intern(obj.get(Obj::INFO)),
+			       start + offset, end + offset,
+			       style.empty() ? styles.default_style()
+					     : styles.ref_style(style));
+	}
+}
+
+/**
+ * Find the end of the array elements starting at pos, at the first top
+ * level ',' at least chunk_size bytes from pos or at the closing ']'.
+ * Returns nullptr if no end is found.
+ */
+static const char*
+scan_elements(const char* pos, const char* end, size_t chunk_size)
+{
+	const char* split = pos + std::min(chunk_size,
+					   static_cast<size_t>(end - pos));
+	int depth = 0;
+	bool in_string = false;
+	for (; pos < end; pos++) {
+		char c = *pos;
+		if (in_string) {
+			if (c == '\\') {
+				pos++;
+			} else if (c == '"') {
+				in_string = false;
+			}
+			continue;
+		}
+
+		switch (c) {
+		case '"':
+			in_string = true;
+			break;
+		case '{':
+		case '[':
+			depth++;
+			break;
+		case '}':
+		case ']':
+			if (depth == 0) {
+				return c == ']' ? pos : nullptr;
+			}
+			depth--;
+			break;
+		case ',':
+			if (depth == 0 && pos >= split) {
+				return pos;
+			}
+			break;
+		}
+	}
+	return nullptr;
+}
+
+tmln::LoadJson::LoadJson(Data& data, Styles& styles,
+			 unsigned int num_threads)
 	: _data(data),
-	  _styles(styles)
+	  _styles(styles),
+	  _num_threads(num_threads),
+	  _unit_ns(NSEC_PER_SEC),
+	  _last_style(nullptr),
+	  _num_steps(0),
+	  _raw_steps(data.stores_raw_steps()),
+	  _steps_text(nullptr),
+	  _steps_size(0)
 {
+	if (_num_threads == 0) {
+		_num_threads = std::thread::hardware_concurrency();
+	}
+	set_step_decoder();
 }
 
 tmln::LoadJson::~LoadJson(void)
@@ -90,119 +222,639 @@ tmln::LoadJson::~LoadJson(void)
 bool
 tmln::LoadJson::load_file(const std::string& path)
 {
-	std::ifstream ifs(path);
-	if (! ifs.is_open()) {
+	FileInput input;
+	if (! input.open(path)) {
 		return false;
 	}
+	return load(input.data(), input.size());
+}
+
+bool
+tmln::LoadJson::load(const std::string& in)
+{
+	return load(in.data(), in.size());
+}
+
+bool
+tmln::LoadJson::load(const char* data, size_t size)
+{
+	JsonReader reader(data, size);
+	return load(reader);
+}
+
+bool
+tmln::LoadJson::load(std::istream& is)
+{
+	JsonReader reader(is);
+	return load(reader);
+}
+
+/**
+ * Load events and styles from reader, events read before an error is
+ * found are kept in the data.
+ */
+bool
+tmln::LoadJson::load(JsonReader& reader)
+{
+	bool status = load_root(reader);
+	_data.finalize();
+	return status;
+}
+
+bool
+tmln::LoadJson::load_ndjson(const std::string& in)
+{
+	return load_ndjson(in.data(), in.size());
+}
 
-	std::string line;
-	std::ostringstream buf;
-	while (std::getline(ifs, line)) {
-		buf << line;
+/**
+ * Load NDJSON data and finalize the data, returns false if any line
+ * was invalid.
+ */
+bool
+tmln::LoadJson::load_ndjson(const char* data, size_t size)
+{
+	bool status;
+	if (_num_threads > 1 && size >= PARALLEL_LOAD_MIN) {
+		status = load_lines_parallel(data, size);
+	} else {
+		status = load_lines(data, size);
 	}
+	_data.finalize();
+	return status;
+}
 
-	return load(buf.str());
+/**
+ * Load NDJSON from is in blocks of whole lines, only one block is held
+ * in memory, and finalize the data.
+ */
+bool
+tmln::LoadJson::load_ndjson(std::istream& is)
+{
+	LineReader reader(is, std::max(_num_threads, 1u) * PARALLEL_LOAD_CHUNK);
+	bool status = true;
+	const char* data;
+	size_t size;
+	while (! _data.cancelled() && reader.next(data, size)) {
+		if (_num_threads > 1 && size >= PARALLEL_LOAD_MIN) {
+			status = load_lines_parallel(data, size) && status;
+		} else {
+			status = load_lines(data, size) && status;
+		}
+	}
+	_data.finalize();
+	return status && ! _data.cancelled();
 }
 
+/**
+ * Load objects from data with one object per line, blank lines are
+ * skipped. The data is not finalized, for loading input that is
+ * appended to. Invalid lines are skipped, returns false if any line was
+ * invalid.
+ */
 bool
-tmln::LoadJson::load(const std::string& in)
+tmln::LoadJson::load_lines(const char* data, size_t size)
 {
-	std::string err;
-	json11::Json json = json11::Json::parse(in, err);
-	return load_obj(json);
+	bool status = true;
+	const char* end = data + size;
+	while (data < end) {
+		if (_data.cancelled()) {
+			return false;
+		}
+		const char* eol =
+			static_cast<const char*>(memchr(data, '\n', end - data));
+		if (eol == nullptr) {
+			eol = end;
+		}
+		if (! load_line(data, eol)) {
+			status = false;
+		}
+		const char* next = eol == end ? end : eol + 1;
+		_data.add_progress(next - data);
+		data = next;
+	}
+	return status;
 }
 
 bool
-tmln::LoadJson::load_obj(const json11::Json& json)
+tmln::LoadJson::load_line(const char* line, const char* end)
 {
-	const json11::Json::array* events, *styles = nullptr;
-	if (! validate_obj(&json,
-			   "events", &events, ARRAY|REQUIRED,
-			   "styles", &styles, ARRAY,
-			   nullptr)) {
+	while (line < end && isspace(*line)) {
+		line++;
+	}
+	if (line == end) {
+		return true;
+	}
+
+	JsonReader reader(line, end - line);
+	if (reader.next() != JsonReader::TOKEN_OBJECT_BEGIN
+	    || ! read_obj(reader, _obj, this)
+	    || reader.next() != JsonReader::TOKEN_END) {
 		return false;
 	}
 
-	json11::Json::array::const_iterator it = events->begin();
-	for (; it != events->end(); ++it) {
-		load_event(*it);
+	const std::string& type = _obj.get(Obj::TYPE);
+	if (type == "style") {
+		load_style();
+	} else if (type.empty() || type == "event") {
+		load_event();
+	}
+	return true;
+}
+
+bool
+tmln::LoadJson::load_root(JsonReader& reader)
+{
+	if (reader.next() != JsonReader::TOKEN_OBJECT_BEGIN) {
+		return false;
 	}
 
-	if (styles) {
-		it = styles->begin();
-		for (; it != styles->end(); ++it) {
-			load_style(*it);
+	bool has_events = false;
+	JsonReader::Token token;
+	while ((token = reader.next()) == JsonReader::TOKEN_KEY) {
+		bool is_events = reader.value() == "events";
+		bool is_styles = reader.value() == "styles";
+		bool is_unit = reader.value() == "unit";
+		bool is_base = reader.value() == "base";
+		token = reader.next();
+		if (is_unit) {
+			if (token != JsonReader::TOKEN_STRING
+			    || ! load_unit(reader.value())) {
+				return false;
+			}
+			set_step_decoder();
+		} else if (is_base) {
+			if (! load_base(token, reader.value())) {
+				return false;
+			}
+			set_step_decoder();
+		} else if (is_events) {
+			if (token != JsonReader::TOKEN_ARRAY_BEGIN
+			    || ! load_events(reader)) {
+				return false;
+			}
+			has_events = true;
+		} else if (is_styles && token != JsonReader::TOKEN_NULL) {
+			if (token != JsonReader::TOKEN_ARRAY_BEGIN
+			    || ! load_styles(reader)) {
+				return false;
+			}
+		} else if (! reader.skip(token)) {
+			return false;
 		}
 	}
 
+	return token == JsonReader::TOKEN_OBJECT_END
+		&& reader.next() == JsonReader::TOKEN_END
+		&& has_events;
+}
+
+bool
+tmln::LoadJson::load_unit(const std::string& unit)
+{
+	if (unit == "s") {
+		_unit_ns = NSEC_PER_SEC;
+	} else if (unit == "ms") {
+		_unit_ns = NSEC_PER_SEC / 1000;
+	} else if (unit == "us") {
+		_unit_ns = NSEC_PER_SEC / 1000000;
+	} else if (unit == "ns") {
+		_unit_ns = 1;
+	} else {
+		return false;
+	}
 	return true;
 }
 
+bool
+tmln::LoadJson::load_base(JsonReader::Token token, const std::string& base)
+{
+	if (token == JsonReader::TOKEN_STRING) {
+		_base = Ts(base);
+		return true;
+	} else if (token == JsonReader::TOKEN_NUMBER) {
+		return Ts::parse_number(base.c_str(), _unit_ns, _base);
+	}
+	return false;
+}
+
+/**
+ * Set the parser of steps added as text to one with the current unit
+ * and base, loaders using the defaults share one.
+ */
 void
-tmln::LoadJson::load_event(const json11::Json& obj)
-{
-	std::string label, info, start, end, style;
-	const json11::Json::array *steps = nullptr;
-	if (! validate_obj(&obj,
-			   "label", &label, STRING|REQUIRED,
-			   "info", &info, STRING,
-			   "start", &start, STRING|REQUIRED,
-			   "end", &end, STRING|REQUIRED,
-			   "steps", &steps, ARRAY,
-			   "style", &style, STRING,
-			   nullptr)) {
-		return;
+tmln::LoadJson::set_step_decoder()
+{
+	static const std::shared_ptr<const StepDecoder> default_decoder(
+		new RawSteps(NSEC_PER_SEC, Ts()));
+	if (_unit_ns == NSEC_PER_SEC && _base == Ts()) {
+		_step_decoder = default_decoder;
+	} else {
+		_step_decoder = std::make_shared<RawSteps>(_unit_ns, _base);
+	}
+}
+
+/**
+ * Read string fields of the current object into obj, with steps set
+ * the "steps" array is read into the steps of that loader. Fields of
+ * the wrong type makes obj invalid, returns false on JSON errors.
+ */
+bool
+tmln::LoadJson::read_obj(JsonReader& reader, Obj& obj, LoadJson* steps)
+{
+	obj.clear();
+	if (steps) {
+		steps->_num_steps = 0;
+		steps->_steps_text = nullptr;
+		steps->_steps_size = 0;
+	}
+
+	JsonReader::Token token;
+	while ((token = reader.next()) == JsonReader::TOKEN_KEY) {
+		int field = 0;
+		while (field < Obj::NUM_FIELDS
+		       && reader.value() != OBJ_FIELDS[field]) {
+			field++;
+		}
+		bool is_steps = steps && reader.value() == "steps";
+
+		token = reader.next();
+		if (token == JsonReader::TOKEN_NULL) {
+			// null fields are treated as missing
+		} else if (is_steps && token == JsonReader::TOKEN_ARRAY_BEGIN) {
+			if (! steps->read_steps(reader)) {
+				return false;
+			}
+		} else if (field < Obj::NUM_FIELDS
+			   && (token == JsonReader::TOKEN_STRING
+			       || (token == JsonReader::TOKEN_NUMBER
+				   && (field == Obj::START
+				       || field == Obj::END
+				       || field == Obj::DUR)))) {
+			obj._values[field] = reader.value();
+			obj._set[field] = true;
+			obj._number[field] = token == JsonReader::TOKEN_NUMBER;
+		} else {
+			if (is_steps || field < Obj::NUM_FIELDS) {
+				obj._valid = false;
+			}
+			if (! reader.skip(token)) {
+				return false;
+			}
+		}
+	}
+	return token == JsonReader::TOKEN_OBJECT_END;
+}
+
+/**
+ * Read the steps array the reader is at into _steps, or only locate
+ * its end and keep its text for data storing raw steps.
+ */
+bool
+tmln::LoadJson::read_steps(JsonReader& reader)
+{
+	if (_raw_steps && reader.is_buffer()) {
+		const char* begin = reader.buffer_pos();
+		const char* end = scan_elements(
+			begin, reader.buffer_end(),
+			std::numeric_limits<size_t>::max());
+		if (end != nullptr) {
+			_steps_text = begin;
+			_steps_size = end - begin;
+			reader.set_buffer_pos(end);
+			return reader.next() == JsonReader::TOKEN_ARRAY_END;
+		}
+	}
+
+	JsonReader::Token token;
+	while ((token = reader.next()) != JsonReader::TOKEN_ARRAY_END) {
+		if (token == JsonReader::TOKEN_OBJECT_BEGIN) {
+			if (_num_steps == _steps.size()) {
+				_steps.emplace_back();
+			}
+			if (! read_obj(reader, _steps[_num_steps], nullptr)) {
+				return false;
+			}
+			_num_steps++;
+		} else if (! reader.skip(token)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+tmln::LoadJson::load_events(JsonReader& reader)
+{
+	if (_num_threads > 1 && reader.is_buffer()
+	    && static_cast<size_t>(reader.buffer_end() - reader.buffer_pos())
+	       >= PARALLEL_LOAD_MIN
+	    && ! load_events_parallel(reader)) {
+		return false;
+	}
+
+	JsonReader::Token token;
+	size_t offset = reader.offset();
+	while ((token = reader.next()) != JsonReader::TOKEN_ARRAY_END) {
+		if (_data.cancelled()) {
+			return false;
+		} else if (token == JsonReader::TOKEN_OBJECT_BEGIN) {
+			if (! read_obj(reader, _obj, this)) {
+				return false;
+			}
+			load_event();
+		} else if (! reader.skip(token)) {
+			return false;
+		}
+		_data.add_progress(reader.offset() - offset);
+		offset = reader.offset();
+	}
+	return true;
+}
+
+/**
+ * Load the events array in chunks, one batch of chunks is parsed in
+ * parallel while the previous batch is merged and the next batch is
+ * located. The reader is left at the end of the array, or where
+ * splitting the array failed for the remaining elements to be read in
+ * the calling thread.
+ */
+bool
+tmln::LoadJson::load_events_parallel(JsonReader& reader)
+{
+	const char* pos = reader.buffer_pos();
+	chunk_vector batch, done, next;
+	bool scan_status = scan_chunks(reader, pos, batch);
+	while (! batch.empty()) {
+		std::vector<std::thread> threads;
+		for (std::unique_ptr<Chunk>& chunk : batch) {
+			Chunk* chunk_ptr = chunk.get();
+			threads.emplace_back([chunk_ptr]() {
+				chunk_ptr->load();
+			});
+		}
+
+		bool merge_status = merge_chunks(done);
+		done.clear();
+		if (merge_status && scan_status) {
+			scan_status = scan_chunks(reader, pos, next);
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		if (! merge_status) {
+			return false;
+		}
+
+		done.swap(batch);
+		batch.swap(next);
+		next.clear();
+	}
+
+	if (! merge_chunks(done)) {
+		return false;
+	}
+	reader.set_buffer_pos(pos);
+	return true;
+}
+
+/**
+ * Split up to _num_threads chunks from the events array at pos, pos is
+ * updated to the start of the next chunk or the end of the array.
+ */
+bool
+tmln::LoadJson::scan_chunks(JsonReader& reader, const char*& pos,
+			    chunk_vector& chunks)
+{
+	while (chunks.size() < _num_threads
+	       && pos != reader.buffer_end() && *pos != ']') {
+		const char* end = scan_elements(pos, reader.buffer_end(),
+						PARALLEL_LOAD_CHUNK);
+		if (end == nullptr) {
+			return false;
+		}
+
+		if (*end == ']' && pos[-1] == ',') {
+			// elements after the last , are required
+			const char* it = pos;
+			while (it != end && isspace(*it)) {
+				it++;
+			}
+			if (it == end) {
+				pos--;
+				return false;
+			}
+		}
+		chunks.emplace_back(new Chunk(*this, pos, end));
+		pos = *end == ']' ? end : end + 1;
+	}
+	return true;
+}
+
+/**
+ * Load NDJSON lines in chunks, one batch of chunks is parsed in
+ * parallel while the previous batch is merged and the next batch is
+ * located.
+ */
+bool
+tmln::LoadJson::load_lines_parallel(const char* data, size_t size)
+{
+	const char* pos = data;
+	const char* end = data + size;
+	bool status = true;
+	chunk_vector batch, done, next;
+	scan_lines(pos, end, batch);
+	while (! batch.empty() && ! _data.cancelled()) {
+		std::vector<std::thread> threads;
+		for (std::unique_ptr<Chunk>& chunk : batch) {
+			Chunk* chunk_ptr = chunk.get();
+			threads.emplace_back([chunk_ptr]() {
+				chunk_ptr->load();
+			});
+		}
+
+		status = merge_chunks(done) && status;
+		done.clear();
+		scan_lines(pos, end, next);
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		done.swap(batch);
+		batch.swap(next);
+		next.clear();
 	}
+	return merge_chunks(done) && status;
+}
 
-	const Style& style_ref = style.size() == 0
-		? _styles.default_style() : _styles.get_style(style);
+/**
+ * Split up to _num_threads chunks of whole lines from pos, pos is
+ * updated to the start of the next chunk.
+ */
+void
+tmln::LoadJson::scan_lines(const char*& pos, const char* end,
+			   chunk_vector& chunks)
+{
+	while (chunks.size() < _num_threads && pos != end) {
+		const char* split = pos + std::min(PARALLEL_LOAD_CHUNK,
+						   static_cast<size_t>(end - pos));
+		const char* eol = static_cast<const char*>(
+			memchr(split, '\n', end - split));
+		const char* chunk_end = eol == nullptr ? end : eol + 1;
+		chunks.emplace_back(new Chunk(*this, pos, chunk_end, true));
+		pos = chunk_end;
+	}
+}
+
+/**
+ * Add events and style definitions from chunks to the data, in order.
+ * Stops at the first events array chunk that failed to load, after
+ * adding the events loaded before the error, or when loading is
+ * cancelled. Invalid lines in NDJSON chunks are skipped.
+ *
+ * Strings and styles of a chunk are mapped to the data once, events
+ * are appended with their ids remapped.
+ */
+bool
+tmln::LoadJson::merge_chunks(chunk_vector& chunks)
+{
+	bool status = true;
+	for (std::unique_ptr<Chunk>& chunk : chunks) {
+		if (_data.cancelled()) {
+			return false;
+		}
+		IdMap map;
+		chunk->_data.map_ids(_data, _styles, map);
+		_data.append(chunk->_data, 0, chunk->_data.size(), map);
+		_styles.add_styles(chunk->_styles);
+		_data.add_progress(chunk->_end - chunk->_begin);
+		if (! chunk->_status && ! chunk->_lines) {
+			return false;
+		}
+		status = status && chunk->_status;
+	}
+	return status;
+}
 
-	Event event(label, info, start, end, style_ref);
-	if (steps != nullptr) {
-		load_steps(event, *steps);
+bool
+tmln::LoadJson::load_styles(JsonReader& reader)
+{
+	JsonReader::Token token;
+	while ((token = reader.next()) != JsonReader::TOKEN_ARRAY_END) {
+		if (token == JsonReader::TOKEN_OBJECT_BEGIN) {
+			if (! read_obj(reader, _obj, nullptr)) {
+				return false;
+			}
+			load_style();
+		} else if (! reader.skip(token)) {
+			return false;
+		}
 	}
-	_data.add_event(event);
+	return true;
 }
 
 void
-tmln::LoadJson::load_steps(Event& event, const json11::Json::array& steps)
+tmln::LoadJson::load_event()
 {
-	json11::Json::array::const_iterator it = steps.begin();
-	for (; it != steps.end(); ++it) {
-		load_step(event, *it);
+	Ts start, end;
+	if (! _obj._valid || ! _obj.has(Obj::LABEL)
+	    || ! obj_span(_obj, _unit_ns, _base, start, end)) {
+		return;
+	}
+
+	StringPool& strings = _data.strings();
+	EventBuilder event =
+		_data.emplace_event(strings.intern(_obj.get(Obj::LABEL)),
+				    strings.intern(_obj.get(Obj::INFO)),
+				    start, end, style_ref(_obj));
+	if (_steps_size > 0) {
+		event.add_raw_steps(_step_decoder, _steps_text, _steps_size);
+	}
+	for (size_t i = 0; i < _num_steps; i++) {
+		load_step(event, _steps[i]);
 	}
 }
 
 void
-tmln::LoadJson::load_step(Event& event, const json11::Json& obj)
-{
-	std::string label, info, start, end, style;
-	if (! validate_obj(&obj,
-			   "label", &label, STRING|REQUIRED,
-			   "info", &info, STRING,
-			   "start", &start, STRING|REQUIRED,
-			   "end", &end, STRING|REQUIRED,
-			   "style", &style, STRING,
-			   nullptr)) {
+tmln::LoadJson::load_step(EventBuilder& event, const Obj& obj)
+{
+	Ts start, end;
+	if (! obj._valid || ! obj.has(Obj::LABEL)
+	    || ! obj_span(obj, _unit_ns, _base, start, end)) {
 		return;
 	}
 
-	const Style& style_ref = style.size() == 0
-		? _styles.default_style() : _styles.get_style(style);
-	event.add_step(label, info, start, end, style_ref);
+	StringPool& strings = _data.strings();
+	event.add_step(strings.intern(obj.get(Obj::LABEL)),
+		       strings.intern(obj.get(Obj::INFO)),
+		       start, end, style_ref(obj));
 }
 
 void
-tmln::LoadJson::load_style(const json11::Json& obj)
-{
-	std::string name, fg, bg;
-	if (! validate_obj(&obj,
-			   "name", &name, STRING|REQUIRED,
-			   "fg", &fg, STRING|REQUIRED,
-			   "bg", &bg, STRING,
-			   nullptr)) {
+tmln::LoadJson::load_style()
+{
+	if (! _obj._valid || ! _obj.has(Obj::NAME) || ! _obj.has(Obj::FG)) {
 		return;
 	}
 
-	_styles.add_style(Style(name, Color(fg), Color(bg)));
+	_styles.add_style(Style(_obj.get(Obj::NAME),
+				Color(_obj.get(Obj::FG)),
+				Color(_obj.get(Obj::BG))));
+}
+
+/**
+ * Style referenced by obj, styles not yet defined are bound to a
+ * placeholder updated when the style definition is read.
+ */
+const tmln::Style&
+tmln::LoadJson::style_ref(const Obj& obj)
+{
+	const std::string& name = obj.get(Obj::STYLE);
+	if (name.empty()) {
+		return _styles.default_style();
+	} else if (_last_style == nullptr || _last_style->name() != name) {
+		_last_style = &_styles.ref_style(name);
+	}
+	return *_last_style;
+}
+
+/**
+ * Get start and end of obj, from "start" and "end" or "dur". Numeric
+ * timestamps are in unit_ns since base.
+ */
+bool
+tmln::LoadJson::obj_span(const Obj& obj, int64_t unit_ns, const Ts& base,
+			 Ts& start, Ts& end)
+{
+	Ts ts;
+	if (! obj.has(Obj::START)) {
+		return false;
+	} else if (obj.is_number(Obj::START)) {
+		if (! Ts::parse_number(obj.get(Obj::START).c_str(), unit_ns,
+				       ts)) {
+			return false;
+		}
+		start = base + ts;
+	} else {
+		start = Ts(obj.get(Obj::START));
+	}
+
+	if (obj.has(Obj::END) && obj.is_number(Obj::END)) {
+		if (! Ts::parse_number(obj.get(Obj::END).c_str(), unit_ns,
+				       ts)) {
+			return false;
+		}
+		end = base + ts;
+	} else if (obj.has(Obj::END)) {
+		end = Ts(obj.get(Obj::END));
+	} else if (obj.has(Obj::DUR) && obj.is_number(Obj::DUR)) {
+		if (! Ts::parse_number(obj.get(Obj::DUR).c_str(), unit_ns,
+				       ts)) {
+			return false;
+		}
+		end = start + ts;
+	} else {
+		return false;
+	}
+	return true;
 }
@@ -25,24 +25,40 @@
 
 #include "config.h"
 
+#include <istream>
+#include <memory>
 #include <string>
-
-#include "json11.hpp"
+#include <vector>
 
 #include "tmln_data.hh"
+#include "tmln_json_reader.hh"
 #include "tmln_style.hh"
 
 namespace tmln {
 
+	/**
+	 * events arrays smaller than this are loaded in the calling
+	 * thread.
+	 */
+	static const size_t PARALLEL_LOAD_MIN = 1024 * 1024;
+	/**
+	 * Size of the chunks an events array is split in for loading in
+	 * parallel.
+	 */
+	static const size_t PARALLEL_LOAD_CHUNK = 1024 * 1024;
+
 	/**
 	 * Load events from JSON data in the format:
 	 *
-	 * {"events": [event],
+	 * {"unit": "s" | "ms" | "us" | "ns",
+	 *  "base": timestamp,
+	 *  "events": [event],
 	 *  "styles": [style]}
 	 *
 	 * event: {"label": string,
 	 *         "start": timestamp,
 	 *         "end": timestamp,
+	 *         "dur": number,
 	 *         "style": style_ref}
 	 *
 	 * style: {"name": string,
@@ -51,29 +67,150 @@ namespace tmln {
 	 *
 	 * color: "#rrggbb" (#00fafa)
 	 * timestamp: "YYYY-MM-DDTHH:mm:ss.f" (2022-01-24T15:40:50.332)
+	 *            | number
 	 * style_ref: "style-name" | color
 	 *
+	 * Numeric timestamps and "dur" are in unit (default "s") since
+	 * the epoch, or since base if set. "dur" can be used instead of
+	 * "end". unit and base apply to events after them in the input.
+	 *
+	 * The input is read as a stream, events are added to the data
+	 * as they are read. Styles may be defined after the events
+	 * referencing them.
+	 *
+	 * Large events arrays in in memory input are split in chunks at
+	 * element boundaries that are parsed using num_threads threads,
+	 * 0 uses one thread per hardware thread. Chunks are parsed into
+	 * columnar data of their own and merged into the data in order,
+	 * with the string and style ids remapped. All chunks use the unit
+	 * and base set before the events array.
+	 *
+	 * NDJSON input, loaded with load_ndjson, has one object per
+	 * line. Objects with "type": "style" are style definitions and
+	 * other objects are events:
+	 *
+	 * {"label": "a", "start": 1, "end": 2, "style": "s"}
+	 * {"type": "style", "name": "s", "fg": "#00fafa"}
+	 *
+	 * Large NDJSON input is split in chunks at newlines, loaded in
+	 * parallel as for events arrays. Invalid lines are skipped.
+	 * NDJSON streams are read in blocks of whole lines, one chunk
+	 * per thread at a time.
+	 * load_lines loads lines without finalizing the data, for input
+	 * that is appended to while loaded.
+	 *
+	 * For data that stores raw steps, see Data::stores_raw_steps,
+	 * "steps" arrays of in memory input are not parsed. Only the end
+	 * of the array is located and the text of the array is added to
+	 * the event, to be parsed when the event is accessed. Errors in
+	 * steps, other than unbalanced brackets, are then not found when
+	 * loading and invalid steps are skipped when parsed.
 	 */
 	class LoadJson {
 	public:
-		LoadJson(Data& data, Styles& styles);
+		LoadJson(Data& data, Styles& styles,
+			 unsigned int num_threads = 0);
 		~LoadJson(void);
 
 		bool load_file(const std::string& path);
 		bool load(const std::string& in);
-		bool load_obj(const json11::Json& obj);
+		bool load(const char* data, size_t size);
+		bool load(std::istream& is);
+		bool load(JsonReader& reader);
+		bool load_ndjson(const std::string& in);
+		bool load_ndjson(const char* data, size_t size);
+		bool load_ndjson(std::istream& is);
+		bool load_lines(const char* data, size_t size);
 
 	private:
-		void load_event(const json11::Json& obj);
-		void load_steps(Event& event,
-				const json11::Json::array& steps);
-		void load_step(Event& event, const json11::Json& obj);
+		/** String fields of an event, step or style object. */
+		struct Obj {
+			enum Field {
+				LABEL,
+				INFO,
+				START,
+				END,
+				STYLE,
+				DUR,
+				NAME,
+				FG,
+				BG,
+				TYPE,
+				NUM_FIELDS
+			};
+
+			void clear();
+			bool has(Field field) const { return _set[field]; }
+			bool is_number(Field field) const
+			{
+				return _number[field];
+			}
+			const std::string& get(Field field) const
+			{
+				return _values[field];
+			}
+
+			std::string _values[NUM_FIELDS];
+			bool _set[NUM_FIELDS];
+			bool _number[NUM_FIELDS];
+			bool _valid;
+		};
+
+		bool load_root(JsonReader& reader);
+		bool load_line(const char* line, const char* end);
+		bool load_unit(const std::string& unit);
+		bool load_base(JsonReader::Token token, const std::string& base);
+		static bool read_obj(JsonReader& reader, Obj& obj,
+				     LoadJson* steps);
+		bool read_steps(JsonReader& reader);
+		void set_step_decoder();
 
-		void load_style(const json11::Json& obj);
+		struct Chunk;
+		class RawSteps;
+		typedef std::vector<std::unique_ptr<Chunk>> chunk_vector;
+
+		bool load_events(JsonReader& reader);
+		bool load_events_parallel(JsonReader& reader);
+		bool scan_chunks(JsonReader& reader, const char*& pos,
+				 chunk_vector& chunks);
+		bool load_lines_parallel(const char* data, size_t size);
+		void scan_lines(const char*& pos, const char* end,
+				chunk_vector& chunks);
+		bool merge_chunks(chunk_vector& chunks);
+		bool load_styles(JsonReader& reader);
+		void load_event();
+		void load_step(EventBuilder& event, const Obj& obj);
+		void load_style();
+
+		const Style& style_ref(const Obj& obj);
+		static bool obj_span(const Obj& obj,
+				     int64_t unit_ns, const Ts& base,
+				     Ts& start, Ts& end);
 
 	private:
 		Data& _data;
 		Styles& _styles;
+		unsigned int _num_threads;
+		/** nanoseconds per unit of numeric timestamps. */
+		int64_t _unit_ns;
+		/** base of numeric timestamps. */
+		Ts _base;
+
+		/** current object, reused to avoid allocations. */
+		Obj _obj;
+		/** last style referenced, events often share styles. */
+		const Style* _last_style;
+		/** steps of the current event, _num_steps are valid. */
+		std::vector<Obj> _steps;
+		size_t _num_steps;
+
+		/** set if steps are added as text, not parsed. */
+		bool _raw_steps;
+		/** parser of steps added as text, with the unit and base. */
+		std::shared_ptr<const StepDecoder> _step_decoder;
+		/** text of the steps of the current event, if not parsed. */
+		const char* _steps_text;
+		size_t _steps_size;
 	};
 
 }
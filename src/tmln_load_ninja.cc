@@ -0,0 +1,304 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+
+#include "tmln_file_input.hh"
+#include "tmln_line_reader.hh"
+#include "tmln_load_ninja.hh"
+
+static const char HEADER[] = "# ninja log v";
+static const int64_t NSEC_PER_MSEC = 1000000;
+
+const size_t tmln::LoadNinja::READ_SIZE;
+
+/**
+ * Parse tab terminated field, pos is moved past the tab.
+ */
+static bool
+next_field(const char*& pos, const char* end, const char*& field,
+	   size_t& len)
+{
+	const char* tab = static_cast<const char*>(memchr(pos, '\t', end - pos));
+	field = pos;
+	if (tab == nullptr) {
+		len = end - pos;
+		pos = end;
+		return len > 0;
+	}
+	len = tab - pos;
+	pos = tab + 1;
+	return true;
+}
+
+static bool
+parse_int(const char* str, size_t len, int64_t& val)
+{
+	val = 0;
+	if (len == 0 || len > 18) {
+		return false;
+	}
+	for (size_t i = 0; i < len; i++) {
+		if (str[i] < '0' || str[i] > '9') {
+			return false;
+		}
+		val = val * 10 + (str[i] - '0');
+	}
+	return true;
+}
+
+/**
+ * Check that the log starts with a header of version 5 or later.
+ */
+static bool
+is_supported(const char* data, size_t size)
+{
+	if (! tmln::LoadNinja::is_ninja_log(data, size)) {
+		return false;
+	}
+	int version = 0;
+	for (size_t i = sizeof(HEADER) - 1;
+	     i < size && data[i] >= '0' && data[i] <= '9' && version < 1000;
+	     i++) {
+		version = version * 10 + (data[i] - '0');
+	}
+	return version >= 5;
+}
+
+tmln::LoadNinja::LoadNinja(Data& data, Styles& styles)
+	: _data(data),
+	  _styles(styles)
+{
+}
+
+tmln::LoadNinja::~LoadNinja()
+{
+}
+
+bool
+tmln::LoadNinja::is_ninja_log(const char* data, size_t size)
+{
+	size_t len = sizeof(HEADER) - 1;
+	return size > len && memcmp(data, HEADER, len) == 0;
+}
+
+
+bool
+tmln::LoadNinja::load_file(const std::string& path)
+{
+	FileInput input;
+	if (! input.open(path)) {
+		return false;
+	}
+	return load(input.data(), input.size());
+}
+
+bool
+tmln::LoadNinja::load(const std::string& in)
+{
+	return load(in.data(), in.size());
+}
+
+/**
+ * Load the log, lines are parsed as they are read and edges added to
+ * the data once the log has been read.
+ */
+bool
+tmln::LoadNinja::load(const char* data, size_t size)
+{
+	if (! is_supported(data, size)) {
+		return false;
+	}
+
+	bool status = load_lines(data, size);
+	add_slots();
+	_data.finalize();
+	return status && ! _data.cancelled();
+}
+
+/**
+ * Load the log from is, READ_SIZE bytes of whole lines at a time.
+ */
+bool
+tmln::LoadNinja::load(std::istream& is)
+{
+	LineReader reader(is, READ_SIZE);
+	const char* data;
+	size_t size;
+	if (! reader.next(data, size) || ! is_supported(data, size)) {
+		return false;
+	}
+
+	bool status = true;
+	do {
+		status = load_lines(data, size) && status;
+	} while (! _data.cancelled() && reader.next(data, size));
+	add_slots();
+	_data.finalize();
+	return status && ! _data.cancelled();
+}
+
+/**
+ * Parse whole lines of the log into edges, comments are skipped.
+ */
+bool
+tmln::LoadNinja::load_lines(const char* data, size_t size)
+{
+	bool status = true;
+	const char* end = data + size;
+	const char* pos = data;
+	while (pos < end && ! _data.cancelled()) {
+		const char* eol =
+			static_cast<const char*>(memchr(pos, '\n', end - pos));
+		if (eol == nullptr) {
+			eol = end;
+		}
+		const char* line_end = eol;
+		if (line_end != pos && line_end[-1] == '\r') {
+			line_end--;
+		}
+		if (line_end != pos && *pos != '#'
+		    && ! load_line(pos, line_end)) {
+			status = false;
+		}
+		const char* next = eol == end ? end : eol + 1;
+		_data.add_progress(next - pos);
+		pos = next;
+	}
+	return status;
+}
+
+bool
+tmln::LoadNinja::load_line(const char* line, const char* end)
+{
+	const char* fields[5];
+	size_t lens[5];
+	for (int i = 0; i < 5; i++) {
+		if (! next_field(line, end, fields[i], lens[i])) {
+			return false;
+		}
+	}
+
+	int64_t start, stop;
+	if (! parse_int(fields[0], lens[0], start)
+	    || ! parse_int(fields[1], lens[1], stop)) {
+		return false;
+	}
+
+	if (! _edges.empty()) {
+		Edge& last = _edges.back();
+		if (stop < last.end) {
+			// log restarted, a new build
+			_edges.clear();
+		} else if (start == last.start && stop == last.end
+			   && last.hash.compare(0, std::string::npos,
+						fields[4], lens[4]) == 0) {
+			last.outputs += ' ';
+			last.outputs.append(fields[3], lens[3]);
+			return true;
+		}
+	}
+
+	_edges.emplace_back();
+	Edge& edge = _edges.back();
+	edge.start = start;
+	edge.end = stop;
+	edge.outputs.assign(fields[3], lens[3]);
+	edge.hash.assign(fields[4], lens[4]);
+	return true;
+}
+
+/**
+ * Assign edges, in start order, to the first free job slot and add one
+ * event per slot.
+ */
+void
+tmln::LoadNinja::add_slots()
+{
+	std::stable_sort(_edges.begin(), _edges.end(),
+			 [](const Edge& lhs, const Edge& rhs) {
+				 return lhs.start < rhs.start;
+			 });
+
+	// (end of last edge, slot) of busy slots, earliest end first
+	typedef std::pair<int64_t, size_t> slot_end;
+	std::priority_queue<slot_end, std::vector<slot_end>,
+			    std::greater<slot_end>> busy;
+	std::vector<std::vector<size_t>> slots;
+	for (size_t i = 0; i < _edges.size(); i++) {
+		size_t slot;
+		if (! busy.empty() && busy.top().first <= _edges[i].start) {
+			slot = busy.top().second;
+			busy.pop();
+		} else {
+			slot = slots.size();
+			slots.emplace_back();
+		}
+		slots[slot].push_back(i);
+		busy.push(slot_end(_edges[i].end, slot));
+	}
+
+	StringPool& strings = _data.strings();
+	for (size_t slot = 0; slot < slots.size(); slot++) {
+		if (_data.cancelled()) {
+			break;
+		}
+		const std::vector<size_t>& edges = slots[slot];
+		int64_t end = 0;
+		for (size_t idx : edges) {
+			end = std::max(end, _edges[idx].end);
+		}
+
+		std::string label("job " + std::to_string(slot));
+		Ts start = Ts::from_ns(_edges[edges[0]].start * NSEC_PER_MSEC);
+		EventBuilder event =
+			_data.emplace_event(strings.intern(label),
+					    strings.intern(""), start,
+					    Ts::from_ns(end * NSEC_PER_MSEC),
+					    _styles.default_style());
+		for (size_t idx : edges) {
+			const Edge& edge = _edges[idx];
+			event.add_step(strings.intern(edge.outputs),
+				       strings.intern(edge.hash),
+				       Ts::from_ns(edge.start * NSEC_PER_MSEC),
+				       Ts::from_ns(edge.end * NSEC_PER_MSEC),
+				       edge_style(edge.outputs));
+		}
+	}
+	_edges.clear();
+}
+
+/**
+ * Style by output file extension.
+ */
+const tmln::Style&
+tmln::LoadNinja::edge_style(const std::string& output)
+{
+	size_t dot = output.find_last_of("./ ");
+	std::string ext = dot == std::string::npos || output[dot] != '.'
+		? std::string() : output.substr(dot);
+	return _styles.palette_style(std::hash<std::string>()(ext));
+}
@@ -0,0 +1,91 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_LOAD_NINJA_HH_
+#define _TMLN_LOAD_NINJA_HH_
+
+#include "config.h"
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "tmln_data.hh"
+#include "tmln_string_pool.hh"
+#include "tmln_style.hh"
+
+namespace tmln {
+
+	/**
+	 * Load build edges from a ninja build log, version 5 or later:
+	 *
+	 * # ninja log v5
+	 * start_ms<TAB>end_ms<TAB>mtime<TAB>output<TAB>command_hash
+	 *
+	 * Only the last build in the log is loaded, edges are logged as
+	 * they finish so a new build starts when the end time goes
+	 * backwards. Outputs of the same edge, consecutive lines with
+	 * equal times and hash, are merged.
+	 *
+	 * Edges are packed into job slots, each slot becomes one event
+	 * with its edges as steps. Timestamps are relative to the epoch.
+	 *
+	 * Streams are read READ_SIZE bytes of whole lines at a time, only
+	 * the parsed edges of the log are kept.
+	 */
+	class LoadNinja {
+	public:
+		static const size_t READ_SIZE = 1024 * 1024;
+
+		LoadNinja(Data& data, Styles& styles);
+		~LoadNinja();
+
+		static bool is_ninja_log(const char* data, size_t size);
+
+		bool load_file(const std::string& path);
+		bool load(const std::string& in);
+		bool load(const char* data, size_t size);
+		bool load(std::istream& is);
+
+	private:
+		struct Edge {
+			int64_t start;
+			int64_t end;
+			std::string outputs;
+			std::string hash;
+		};
+
+		bool load_lines(const char* data, size_t size);
+		bool load_line(const char* line, const char* end);
+		void add_slots();
+		const Style& edge_style(const std::string& output);
+
+	private:
+		Data& _data;
+		Styles& _styles;
+
+		std::vector<Edge> _edges;
+	};
+}
+
+#endif // _TMLN_LOAD_NINJA_HH_
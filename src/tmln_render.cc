@@ -20,6 +20,7 @@
 // IN THE SOFTWARE.
 // 
 
+#include <algorithm>
 #include <iostream>
 
 #include "tmln_render.hh"
@@ -27,7 +28,7 @@
 tmln::Render::Render(const Data& data, const Scale& scale, Styles& styles)
 	: _data(data),
 	  _scale(scale),
-	  _styles(styles)
+	  _line_style(styles.get_style("black"))
 {
 }
 
@@ -40,47 +41,58 @@ tmln::Render::find_event(int x, int y,
 			 Event const** event_ret,
 			 EventStep const** step_ret) const
 {
-	bool found = false;
 	*event_ret = nullptr;
 	*step_ret = nullptr;
 
-	int i = y / _scale.event_height();
-	if (i > -1 && i < _data.size()) {
-		const Event &event = _data[i];
-		Event::step_iterator it = event.cbegin();
-		for (; it != event.cend(); ++it) {
-			int step_x1 = _scale.time_x(it->start());
-			if (step_x1 > x) {
-				// will never match, all events are after
-				// this position
-				return found;
-			}
+	if (y < 0) {
+		return false;
+	}
+	// events are drawn one per row in data order, the row gives the
+	// event directly so the interval index, answering which events
+	// overlap a time span, is of no use here.
+	size_t i = _data.begin() + y / _scale.event_height();
+	if (i >= _data.end()) {
+		return false;
+	}
 
-			int step_x2 = _scale.time_x(it->end());
-			if (x >= step_x1 && x <= step_x2) {
-				*event_ret = &event;
-				*step_ret = &(*it);
-				found = true;
-			}
-		}
+	// reject positions outside of the event before looking at the
+	// steps, avoids constructing events for Data not storing them
+	TsSpan span = _data.event_span(i);
+	if (x < _scale.time_x(span.start()) || x > _scale.time_x(span.end())) {
+		return false;
 	}
 
-	return found;
+	// steps are sorted by start, find the last step starting at or
+	// before x and search backwards for the last one covering x.
+	const Event &event = _data[i];
+	const Event::step_vector& steps = event.steps();
+	Event::step_iterator it =
+		std::upper_bound(steps.begin(), steps.end(), x,
+				 [this](int pos, const EventStep& step) {
+					 return pos < _scale.time_x(step.start());
+				 });
+	while (it != steps.begin()) {
+		--it;
+		if (x <= _scale.time_x(it->end())) {
+			*event_ret = &event;
+			*step_ret = &(*it);
+			return true;
+		}
+	}
+	return false;
 }
 
 void
 tmln::Render::render(Draw& draw)
 {
-	Style line_style = _styles.get_style("black");
-
 	render_scale(draw);
 
 	int y = 0;
 	for (size_t i = _data.begin(); i < _data.end(); i++) {
 		render_event(draw, y, _data[i]);
-		draw.line(0, y, _scale.actual_width(), y, line_style);
+		draw.line(0, y, _scale.actual_width(), y, _line_style);
 		y += _scale.event_height();
-		draw.line(0, y, _scale.actual_width(), y, line_style);
+		draw.line(0, y, _scale.actual_width(), y, _line_style);
 	}
 }
 
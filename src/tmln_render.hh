@@ -53,7 +53,7 @@ namespace tmln {
 	private:
 		const Data& _data;
 		const Scale& _scale;
-		Styles _styles;
+		const Style& _line_style;
 	};
 }
 
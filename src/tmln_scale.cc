@@ -48,15 +48,32 @@ tmln::Scale::~Scale()
 int
 tmln::Scale::time_x(const Ts& ts) const
 {
-	Ts diff = ts - _span.start();
-	return _sec_to_pixel * diff.to_sec();
+	return _ns_to_pixel * (ts.ns() - _span.start().ns());
 }
 
 unsigned int
 tmln::Scale::span_width(const TsSpan& span) const
 {
-	double sec = span.to_sec();
-	return static_cast<unsigned int>(_sec_to_pixel * sec);
+	return static_cast<unsigned int>(_ns_to_pixel * span.ns());
+}
+
+/**
+ * Update span and number of events of the data, keeping scale and
+ * start. Start is moved to the start of the data when the data was
+ * empty, such as for live input.
+ */
+void
+tmln::Scale::set_actual(const TsSpan& actual_span,
+			unsigned int actual_num_events)
+{
+	if (_actual_num_events == 0) {
+		_start = actual_span.start();
+	}
+	_actual_span = actual_span;
+	_actual_num_events = actual_num_events;
+	calc_span();
+	update_ns_to_pixel_ratio();
+	calc_events();
 }
 
 void
@@ -65,7 +82,7 @@ tmln::Scale::set_actual_size(int width, int height)
 	_actual_width = width;
 	_actual_height = height;
 	calc_events();
-	update_sec_to_pixel_ratio();
+	update_ns_to_pixel_ratio();
 }
 
 void
@@ -73,7 +90,7 @@ tmln::Scale::set_scale(double scale)
 {
 	_scale = scale;
 	calc_span();
-	update_sec_to_pixel_ratio();
+	update_ns_to_pixel_ratio();
 	calc_events();
 }
 
@@ -88,7 +105,8 @@ tmln::Scale::set_start(const Ts& start)
 void
 tmln::Scale::calc_span()
 {
-	Ts end = _actual_span.start()  + Ts(_actual_span.to_sec() * _scale);
+	Ts end = _actual_span.start()
+		+ Ts::from_ns(static_cast<int64_t>(_actual_span.ns() * _scale));
 	_span = TsSpan(_start, end);
 }
 
@@ -98,7 +116,7 @@ tmln::Scale::calc_events()
 	if (_actual_width == 0 || _actual_num_events == 0) {
 		_event_height = EVENT_HEIGHT;
 		_num_events = 0;
-		_sec_to_pixel = 0;
+		_ns_to_pixel = 0;
 		return;
 	}
 
@@ -121,16 +139,16 @@ void
 tmln::Scale::set_span(const TsSpan& span)
 {
 	_span = span;
-	update_sec_to_pixel_ratio();
+	update_ns_to_pixel_ratio();
 }
 
 void
-tmln::Scale::update_sec_to_pixel_ratio()
+tmln::Scale::update_ns_to_pixel_ratio()
 {
-	double sec = _span.to_sec();
-	if (sec == 0) {
-		_sec_to_pixel = 0.0;
+	int64_t ns = _span.ns();
+	if (ns == 0) {
+		_ns_to_pixel = 0.0;
 	} else {
-		_sec_to_pixel = static_cast<double>(_actual_width) / sec;
+		_ns_to_pixel = static_cast<double>(_actual_width) / ns;
 	}
 }
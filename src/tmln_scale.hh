@@ -48,6 +48,8 @@ namespace tmln {
 		int actual_width() const { return _actual_width; }
 		int actual_height() const { return _actual_height; }
 
+		void set_actual(const TsSpan& actual_span,
+				unsigned int actual_num_events);
 		void set_actual_size(int width, int height);
 		void set_scale(double scale);
 		void set_start(const Ts& start);
@@ -57,13 +59,13 @@ namespace tmln {
 		void calc_events();
 
 		void set_span(const TsSpan& span);
-		void update_sec_to_pixel_ratio();
+		void update_ns_to_pixel_ratio();
 
 	private:
 		TsSpan _span;
 		unsigned int _num_events;
 		unsigned int _event_height;
-		double _sec_to_pixel;
+		double _ns_to_pixel;
 
 		double _scale;
 		Ts _start;
@@ -35,7 +35,7 @@ tmln::NumOffsetSelection::NumOffsetSelection(const tmln::Data &data,
 	  _offset(offset),
 	  _span(Ts(0, 0), Ts(0, 0))
 {
-	set_selection(max_num, offset);
+	select();
 }
 
 tmln::NumOffsetSelection::~NumOffsetSelection()
@@ -66,11 +66,26 @@ tmln::NumOffsetSelection::set_selection(unsigned int max_num, size_t offset)
 
 	_max_num = max_num;
 	_offset = offset;
-	_pos_begin = offset;
+	select();
+}
+
+/**
+ * Update selection after events were appended to the data.
+ */
+void
+tmln::NumOffsetSelection::update()
+{
+	select();
+}
+
+void
+tmln::NumOffsetSelection::select()
+{
+	_pos_begin = _offset;
 	if (_offset > _data.size()) {
 		_pos_begin = _data.size();
 	}
-	_pos_end = _offset + max_num;
+	_pos_end = _offset + _max_num;
 	if (_pos_end > _data.size()) {
 		_pos_end = _data.size();
 	}
@@ -78,8 +93,8 @@ tmln::NumOffsetSelection::set_selection(unsigned int max_num, size_t offset)
 	if (_pos_begin == _pos_end) {
 		_span = TsSpan(Ts(0, 0), Ts(0, 0));
 	} else {
-		_span = TsSpan(_data[_pos_begin].start(),
-			       _data[_pos_end - 1].end());
+		_span = TsSpan(_data.event_span(_pos_begin).start(),
+			       _data.event_span(_pos_end - 1).end());
 	}
 }
 
@@ -103,7 +118,13 @@ tmln::NumTimeSelection::~NumTimeSelection()
 const tmln::Event&
 tmln::NumTimeSelection::operator[](size_t idx) const
 {
-	return _data[idx];
+	return _data[_idx[idx]];
+}
+
+tmln::TsSpan
+tmln::NumTimeSelection::event_span(size_t idx) const
+{
+	return _data.event_span(_idx[idx]);
 }
 
 size_t
@@ -113,34 +134,12 @@ tmln::NumTimeSelection::data_size() const
 }
 
 /**
- * Update selection based on current max number and span. 
+ * Update selection based on current max number and span.
  */
 void
 tmln::NumTimeSelection::set_selection(unsigned int max_num, const TsSpan &span)
 {
 	_max_num = max_num;
 	_span = span;
-	_pos_begin = _data.end();
-	_pos_end = _data.end();
-
-	unsigned int found = 0;
-	for (size_t i = _data.begin(); i < _data.end(); i++) {
-		const Event &event = _data[i];
-
-		if (event.start() > _span.end()) {
-			// past the end of the span, no need to scan any
-			// further as nothing will match
-			break;
-		}
-
-		if (_span.inside(event.start())) {
-			if (_pos_begin == _data.end()) {
-				_pos_begin = i;
-			}
-			_pos_end = i + 1;
-			if (++found == _max_num) {
-				break;
-			}
-		}
-	}
+	_data.interval_index().query(_span, _max_num, _idx);
 }
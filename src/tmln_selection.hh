@@ -25,6 +25,8 @@
 
 #include "config.h"
 
+#include <vector>
+
 #include "tmln_data.hh"
 
 namespace tmln {
@@ -43,15 +45,27 @@ namespace tmln {
 		virtual size_t begin() const override { return _pos_begin; }
 		virtual size_t end() const override { return _pos_end; }
 		virtual const Event &operator[](size_t idx) const override;
-		virtual bool add_event(const Event& event) override
+		virtual bool add_event(const Event& /*event*/) override
 		{
 			return false;
 		}
+		using Data::add_event;
+		virtual EventBuilder emplace_event(StrRef, StrRef,
+						   const Ts&, const Ts&,
+						   const Style&) override
+		{
+			return EventBuilder();
+		}
+		virtual void finalize() override { }
 
 		size_t data_size() const { return _data.size(); }
 		const TsSpan& data_span() const { return _data.span(); }
 
 		void set_selection(unsigned int max_num, size_t offset);
+		void update();
+
+	private:
+		void select();
 
 	private:
 		const Data &_data;
@@ -65,7 +79,8 @@ namespace tmln {
 
 	/**
 	 * Data selection implementation limiting the events to the
-	 * given timespan and a maximum number of events.
+	 * ones overlapping the given timespan and a maximum number of
+	 * events. Selected events are indexed from 0 in start order.
 	 */
 	class NumTimeSelection : public Data {
 	public:
@@ -74,17 +89,23 @@ namespace tmln {
 		~NumTimeSelection();
 
 		virtual const TsSpan& span() const override { return _span; }
-		virtual size_t size() const override
-		{
-			return _pos_end - _pos_begin;
-		}
-		virtual size_t begin() const override { return _pos_begin; }
-		virtual size_t end() const override { return _pos_end; }
+		virtual size_t size() const override { return _idx.size(); }
+		virtual size_t begin() const override { return 0; }
+		virtual size_t end() const override { return _idx.size(); }
 		virtual const Event &operator[](size_t idx) const override;
-		virtual bool add_event(const Event& event) override
+		virtual TsSpan event_span(size_t idx) const override;
+		virtual bool add_event(const Event& /*event*/) override
 		{
 			return false;
 		}
+		using Data::add_event;
+		virtual EventBuilder emplace_event(StrRef, StrRef,
+						   const Ts&, const Ts&,
+						   const Style&) override
+		{
+			return EventBuilder();
+		}
+		virtual void finalize() override { }
 
 		size_t data_size() const;
 		void set_selection(unsigned int max_num, const TsSpan &span);
@@ -94,8 +115,8 @@ namespace tmln {
 		unsigned int _max_num;
 		TsSpan _span;
 
-		size_t _pos_begin;
-		size_t _pos_end;
+		/** index of selected events in data. */
+		std::vector<size_t> _idx;
 	};
 };
 
@@ -0,0 +1,389 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+
+#include "tmln_snapshot.hh"
+
+namespace tmln {
+	const char SNAPSHOT_MAGIC[8] = {'T', 'M', 'L', 'N', 'S', 'N', 'A', 'P'};
+	const uint32_t SNAPSHOT_VERSION = 1;
+
+	static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+}
+
+static size_t
+align8(size_t size)
+{
+	return (size + 7) & ~static_cast<size_t>(7);
+}
+
+template<typename T>
+static void
+write_section(std::ofstream& ofs, const T* data, size_t num)
+{
+	static const char padding[8] = {0};
+	size_t size = num * sizeof(T);
+	ofs.write(reinterpret_cast<const char*>(data), size);
+	ofs.write(padding, align8(size) - size);
+}
+
+template<typename T>
+static void
+write_section(std::ofstream& ofs, const std::vector<T>& data)
+{
+	write_section(ofs, data.data(), data.size());
+}
+
+/**
+ * Write data to path in the snapshot format, see SnapshotHeader.
+ */
+bool
+tmln::write_snapshot(const Data& data, const std::string& path)
+{
+	StringPool pool;
+	std::map<const Style*, uint16_t> style_ids;
+	std::vector<const Style*> styles;
+	auto style_id = [&style_ids, &styles](const Style& style) {
+		std::map<const Style*, uint16_t>::iterator it =
+			style_ids.find(&style);
+		if (it != style_ids.end()) {
+			return it->second;
+		}
+		uint16_t id = static_cast<uint16_t>(styles.size());
+		if (styles.size() > std::numeric_limits<uint16_t>::max()) {
+			id = 0;
+		} else {
+			styles.push_back(&style);
+		}
+		style_ids[&style] = id;
+		return id;
+	};
+
+	std::vector<int64_t> start, end, step_start, step_end;
+	std::vector<uint32_t> label, info, step_label, step_info;
+	std::vector<uint16_t> style, step_style;
+	std::vector<uint64_t> step_offset(1, 0);
+	for (size_t i = data.begin(); i < data.end(); i++) {
+		const Event& event = data[i];
+		start.push_back(event.start().ns());
+		end.push_back(event.end().ns());
+		label.push_back(pool.intern_id(event.label()));
+		info.push_back(pool.intern_id(event.info()));
+		style.push_back(style_id(event.style()));
+
+		Event::step_iterator it = event.cbegin();
+		for (; it != event.cend(); ++it) {
+			step_start.push_back(it->start().ns());
+			step_end.push_back(it->end().ns());
+			step_label.push_back(pool.intern_id(it->label()));
+			step_info.push_back(pool.intern_id(it->info()));
+			step_style.push_back(style_id(it->style()));
+		}
+		step_offset.push_back(step_start.size());
+	}
+
+	std::vector<SnapshotStyle> style_table;
+	std::vector<const Style*>::iterator it = styles.begin();
+	for (; it != styles.end(); ++it) {
+		SnapshotStyle snapshot_style;
+		snapshot_style.name = pool.intern_id((*it)->name());
+		(*it)->get_fg(snapshot_style.fg[0], snapshot_style.fg[1],
+			      snapshot_style.fg[2], snapshot_style.fg[3]);
+		(*it)->get_bg(snapshot_style.bg[0], snapshot_style.bg[1],
+			      snapshot_style.bg[2], snapshot_style.bg[3]);
+		style_table.push_back(snapshot_style);
+	}
+
+	std::vector<uint64_t> string_offset(1, 0);
+	std::string string_data;
+	for (StrId id = 0; id < pool.size(); id++) {
+		string_data += pool.str(id);
+		string_offset.push_back(string_data.size());
+	}
+
+	SnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+	header.num_events = start.size();
+	header.num_steps = step_start.size();
+	header.num_strings = pool.size();
+	header.num_styles = style_table.size();
+	header.span_start = data.span().start().ns();
+	header.span_end = data.span().end().ns();
+
+	size_t section_size[SnapshotHeader::NUM_SECTIONS] = {
+		start.size() * sizeof(int64_t),
+		end.size() * sizeof(int64_t),
+		label.size() * sizeof(uint32_t),
+		info.size() * sizeof(uint32_t),
+		style.size() * sizeof(uint16_t),
+		step_offset.size() * sizeof(uint64_t),
+		step_start.size() * sizeof(int64_t),
+		step_end.size() * sizeof(int64_t),
+		step_label.size() * sizeof(uint32_t),
+		step_info.size() * sizeof(uint32_t),
+		step_style.size() * sizeof(uint16_t),
+		string_offset.size() * sizeof(uint64_t),
+		string_data.size(),
+		style_table.size() * sizeof(SnapshotStyle)
+	};
+	size_t offset = align8(sizeof(header));
+	for (int i = 0; i < SnapshotHeader::NUM_SECTIONS; i++) {
+		header.section[i] = offset;
+		offset += align8(section_size[i]);
+	}
+
+	std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+	if (! ofs.is_open()) {
+		return false;
+	}
+	write_section(ofs, &header, 1);
+	write_section(ofs, start);
+	write_section(ofs, end);
+	write_section(ofs, label);
+	write_section(ofs, info);
+	write_section(ofs, style);
+	write_section(ofs, step_offset);
+	write_section(ofs, step_start);
+	write_section(ofs, step_end);
+	write_section(ofs, step_label);
+	write_section(ofs, step_info);
+	write_section(ofs, step_style);
+	write_section(ofs, string_offset);
+	write_section(ofs, string_data.data(), string_data.size());
+	write_section(ofs, style_table);
+	ofs.close();
+	return ! ofs.fail();
+}
+
+// MmapData
+
+const size_t tmln::MmapData::CACHE_SIZE;
+
+tmln::MmapData::MmapData(const std::string& source, Styles& styles)
+	: Data(source),
+	  _span(Ts(0, 0), Ts(0, 0)),
+	  _num_events(0),
+	  _header(nullptr),
+	  _start(nullptr),
+	  _end(nullptr),
+	  _label(nullptr),
+	  _info(nullptr),
+	  _style(nullptr),
+	  _step_offset(nullptr),
+	  _step_start(nullptr),
+	  _step_end(nullptr),
+	  _step_label(nullptr),
+	  _step_info(nullptr),
+	  _step_style(nullptr),
+	  _string_offset(nullptr),
+	  _string_data(nullptr),
+	  _cache_idx(CACHE_SIZE, std::numeric_limits<size_t>::max()),
+	  _cache(CACHE_SIZE)
+{
+	if (! open(styles)) {
+		close();
+	}
+}
+
+tmln::MmapData::~MmapData()
+{
+	close();
+}
+
+/**
+ * Construct Event at idx from the mapped data, the returned reference
+ * is valid until the next call to operator[].
+ */
+const tmln::Event&
+tmln::MmapData::operator[](size_t idx) const
+{
+	size_t slot = idx % CACHE_SIZE;
+	if (_cache_idx[slot] == idx) {
+		return *_cache[slot];
+	}
+
+	Event* event = new Event(str(_label[idx]), str(_info[idx]),
+				 Ts::from_ns(_start[idx]),
+				 Ts::from_ns(_end[idx]),
+				 style(_style[idx]));
+	uint64_t first = _step_offset[idx];
+	uint64_t last = std::min(_step_offset[idx + 1], _header->num_steps);
+	for (uint64_t i = first; i < last; i++) {
+		event->add_step(str(_step_label[i]), str(_step_info[i]),
+				Ts::from_ns(_step_start[i]),
+				Ts::from_ns(_step_end[i]),
+				style(_step_style[i]));
+	}
+	_cache[slot].reset(event);
+	_cache_idx[slot] = idx;
+	return *event;
+}
+
+tmln::TsSpan
+tmln::MmapData::event_span(size_t idx) const
+{
+	return TsSpan(Ts::from_ns(_start[idx]), Ts::from_ns(_end[idx]));
+}
+
+bool
+tmln::MmapData::open(Styles& styles)
+{
+	if (! _input.open(source())
+	    || _input.size() < sizeof(SnapshotHeader)) {
+		return false;
+	}
+
+	_header = reinterpret_cast<const SnapshotHeader*>(_input.data());
+	if (memcmp(_header->magic, SNAPSHOT_MAGIC, sizeof(_header->magic))
+	    || _header->version != SNAPSHOT_VERSION
+	    || _header->byte_order != BYTE_ORDER_MARK
+	    || _header->num_strings == 0) {
+		return false;
+	}
+
+	uint64_t num = _header->num_events;
+	uint64_t num_steps = _header->num_steps;
+	typedef SnapshotHeader H;
+	_start = static_cast<const int64_t*>(
+		section(H::EVENT_START, sizeof(int64_t), num));
+	_end = static_cast<const int64_t*>(
+		section(H::EVENT_END, sizeof(int64_t), num));
+	_label = static_cast<const uint32_t*>(
+		section(H::EVENT_LABEL, sizeof(uint32_t), num));
+	_info = static_cast<const uint32_t*>(
+		section(H::EVENT_INFO, sizeof(uint32_t), num));
+	_style = static_cast<const uint16_t*>(
+		section(H::EVENT_STYLE, sizeof(uint16_t), num));
+	_step_offset = static_cast<const uint64_t*>(
+		section(H::STEP_OFFSET, sizeof(uint64_t), num + 1));
+	_step_start = static_cast<const int64_t*>(
+		section(H::STEP_START, sizeof(int64_t), num_steps));
+	_step_end = static_cast<const int64_t*>(
+		section(H::STEP_END, sizeof(int64_t), num_steps));
+	_step_label = static_cast<const uint32_t*>(
+		section(H::STEP_LABEL, sizeof(uint32_t), num_steps));
+	_step_info = static_cast<const uint32_t*>(
+		section(H::STEP_INFO, sizeof(uint32_t), num_steps));
+	_step_style = static_cast<const uint16_t*>(
+		section(H::STEP_STYLE, sizeof(uint16_t), num_steps));
+	_string_offset = static_cast<const uint64_t*>(
+		section(H::STRING_OFFSET, sizeof(uint64_t),
+			_header->num_strings + 1));
+	if (! _start || ! _end || ! _label || ! _info || ! _style
+	    || ! _step_offset || ! _step_start || ! _step_end
+	    || ! _step_label || ! _step_info || ! _step_style
+	    || ! _string_offset) {
+		return false;
+	}
+	_string_data = static_cast<const char*>(
+		section(H::STRING_DATA, 1,
+			_string_offset[_header->num_strings]));
+	const SnapshotStyle* style_table = static_cast<const SnapshotStyle*>(
+		section(H::STYLES, sizeof(SnapshotStyle),
+			_header->num_styles));
+	if (! _string_data || ! style_table) {
+		return false;
+	}
+
+	_strs.resize(_header->num_strings, 0);
+	for (uint64_t i = 0; i < _header->num_styles; i++) {
+		const SnapshotStyle& s = style_table[i];
+		const std::string& name = str(s.name);
+		if (! styles.has_style(name)) {
+			Color fg(s.fg[0], s.fg[1], s.fg[2], s.fg[3]);
+			Color bg(s.bg[0], s.bg[1], s.bg[2], s.bg[3]);
+			styles.add_style(Style(name, fg, bg));
+		}
+		_styles.push_back(&styles.get_style(name));
+	}
+	// snapshots of empty data have no styles, style ids fall back to 0
+	if (_styles.empty()) {
+		_styles.push_back(&styles.default_style());
+	}
+
+	_num_events = num;
+	_span = TsSpan(Ts::from_ns(_header->span_start),
+		       Ts::from_ns(_header->span_end));
+	return true;
+}
+
+void
+tmln::MmapData::close()
+{
+	_input.close();
+	_header = nullptr;
+	_num_events = 0;
+}
+
+/**
+ * Get pointer to section, nullptr if it is not inside the mapping or not
+ * 8 byte aligned.
+ */
+const void*
+tmln::MmapData::section(SnapshotHeader::Section section,
+			size_t elem_size, size_t num) const
+{
+	uint64_t offset = _header->section[section];
+	if (offset % 8 != 0
+	    || offset > _input.size()
+	    || num > (_input.size() - offset) / elem_size) {
+		return nullptr;
+	}
+	return _input.data() + offset;
+}
+
+const tmln::Style&
+tmln::MmapData::style(uint16_t id) const
+{
+	return *_styles[id < _styles.size() ? id : 0];
+}
+
+/**
+ * Get string id interned in the Data string pool, strings are interned
+ * on first use which is why the pool is modified from const access.
+ */
+tmln::StrRef
+tmln::MmapData::str(uint32_t id) const
+{
+	if (id >= _strs.size()) {
+		return strings().ref(0);
+	}
+	if (id != 0 && _strs[id] == 0) {
+		uint64_t begin = _string_offset[id];
+		uint64_t end = _string_offset[id + 1];
+		if (begin > end || end > _string_offset[_strs.size()]) {
+			return strings().ref(0);
+		}
+		std::string value(_string_data + begin, end - begin);
+		StringPool& pool = const_cast<MmapData*>(this)->strings();
+		_strs[id] = pool.intern_id(value);
+	}
+	return strings().ref(_strs[id]);
+}
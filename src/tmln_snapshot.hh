@@ -0,0 +1,173 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_SNAPSHOT_HH_
+#define _TMLN_SNAPSHOT_HH_
+
+#include "config.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tmln_data.hh"
+#include "tmln_file_input.hh"
+#include "tmln_style.hh"
+
+namespace tmln {
+
+	/**
+	 * Binary snapshot of loaded timeline data, all integers are
+	 * stored in host byte order and all sections are 8 byte aligned.
+	 *
+	 * header
+	 * event start, end: int64[num_events] (ns since epoch)
+	 * event label, info: uint32[num_events] (string id)
+	 * event style: uint16[num_events] (style id)
+	 * step offset: uint64[num_events + 1]
+	 * step start, end: int64[num_steps]
+	 * step label, info: uint32[num_steps]
+	 * step style: uint16[num_steps]
+	 * string offset: uint64[num_strings + 1]
+	 * string data: char[string_bytes]
+	 * styles: SnapshotStyle[num_styles]
+	 */
+	struct SnapshotHeader {
+		enum Section {
+			EVENT_START,
+			EVENT_END,
+			EVENT_LABEL,
+			EVENT_INFO,
+			EVENT_STYLE,
+			STEP_OFFSET,
+			STEP_START,
+			STEP_END,
+			STEP_LABEL,
+			STEP_INFO,
+			STEP_STYLE,
+			STRING_OFFSET,
+			STRING_DATA,
+			STYLES,
+			NUM_SECTIONS
+		};
+
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint64_t num_events;
+		uint64_t num_steps;
+		uint64_t num_strings;
+		uint64_t num_styles;
+		int64_t span_start;
+		int64_t span_end;
+		uint64_t section[NUM_SECTIONS];
+	};
+
+	struct SnapshotStyle {
+		uint32_t name;
+		uint8_t fg[4];
+		uint8_t bg[4];
+	};
+
+	extern const char SNAPSHOT_MAGIC[8];
+	extern const uint32_t SNAPSHOT_VERSION;
+
+	bool write_snapshot(const Data& data, const std::string& path);
+
+	/**
+	 * Data implementation serving events from a memory mapped
+	 * snapshot file. Timestamps are read directly from the mapping,
+	 * strings are interned when first used.
+	 *
+	 * Events are constructed on access as for ColumnarData.
+	 */
+	class MmapData : public Data {
+	public:
+		static const size_t CACHE_SIZE = 1024;
+
+		MmapData(const std::string& source, Styles& styles);
+		virtual ~MmapData();
+
+		bool is_open() const { return _header != nullptr; }
+
+		virtual const TsSpan& span() const override { return _span; }
+		virtual size_t size() const override { return _num_events; }
+		virtual size_t begin() const override { return 0; }
+		virtual size_t end() const override { return _num_events; }
+		virtual const Event& operator[](size_t idx) const override;
+		virtual bool add_event(const Event& /*event*/) override
+		{
+			return false;
+		}
+		using Data::add_event;
+		virtual EventBuilder emplace_event(StrRef, StrRef,
+						   const Ts&, const Ts&,
+						   const Style&) override
+		{
+			return EventBuilder();
+		}
+		virtual TsSpan event_span(size_t idx) const override;
+
+	private:
+		bool open(Styles& styles);
+		void close();
+		const void* section(SnapshotHeader::Section section,
+				    size_t elem_size, size_t num) const;
+		const Style& style(uint16_t id) const;
+		StrRef str(uint32_t id) const;
+
+	private:
+		TsSpan _span;
+		size_t _num_events;
+
+		FileInput _input;
+		const SnapshotHeader* _header;
+
+		const int64_t* _start;
+		const int64_t* _end;
+		const uint32_t* _label;
+		const uint32_t* _info;
+		const uint16_t* _style;
+		const uint64_t* _step_offset;
+		const int64_t* _step_start;
+		const int64_t* _step_end;
+		const uint32_t* _step_label;
+		const uint32_t* _step_info;
+		const uint16_t* _step_style;
+		const uint64_t* _string_offset;
+		const char* _string_data;
+
+		std::vector<const Style*> _styles;
+
+		/**
+		 * snapshot string id to id in strings(), 0 until
+		 * interned. Snapshot string 0 is the empty string.
+		 */
+		mutable std::vector<StrId> _strs;
+		mutable std::vector<size_t> _cache_idx;
+		mutable std::vector<std::unique_ptr<Event>> _cache;
+	};
+}
+
+#endif // _TMLN_SNAPSHOT_HH_
@@ -0,0 +1,100 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_SORT_HH_
+#define _TMLN_SORT_HH_
+
+#include "config.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace tmln {
+
+	/**
+	 * Ranges smaller than this are sorted in the calling thread.
+	 */
+	static const size_t PARALLEL_SORT_MIN = 64 * 1024;
+
+	/**
+	 * Stable sort of [begin, end) splitting the range in one chunk per
+	 * thread, sorting the chunks in parallel and then merging them
+	 * pairwise in parallel.
+	 *
+	 * num_threads 0 uses one thread per hardware thread.
+	 */
+	template<typename It, typename Cmp>
+	void parallel_sort(It begin, It end, Cmp cmp,
+			   unsigned int num_threads = 0)
+	{
+		if (num_threads == 0) {
+			num_threads = std::thread::hardware_concurrency();
+		}
+		size_t size = end - begin;
+		if (num_threads < 2 || size < PARALLEL_SORT_MIN) {
+			std::stable_sort(begin, end, cmp);
+			return;
+		}
+
+		size_t chunks = num_threads;
+		size_t chunk_size = (size + chunks - 1) / chunks;
+		std::vector<It> bounds;
+		for (size_t i = 0; i < chunks; i++) {
+			bounds.push_back(begin + std::min(i * chunk_size, size));
+		}
+		bounds.push_back(end);
+
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < chunks; i++) {
+			It first = bounds[i];
+			It last = bounds[i + 1];
+			threads.emplace_back([first, last, cmp]() {
+				std::stable_sort(first, last, cmp);
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		for (size_t width = 1; width < chunks; width *= 2) {
+			threads.clear();
+			for (size_t i = 0; i + width < chunks; i += 2 * width) {
+				It first = bounds[i];
+				It middle = bounds[i + width];
+				It last = bounds[std::min(i + 2 * width,
+							  chunks)];
+				threads.emplace_back([first, middle, last,
+						      cmp]() {
+					std::inplace_merge(first, middle, last,
+							   cmp);
+				});
+			}
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+		}
+	}
+}
+
+#endif // _TMLN_SORT_HH_
@@ -0,0 +1,53 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#include "tmln_string_pool.hh"
+
+tmln::StringPool::StringPool(Arena* arena)
+	: _ids(0, id_map::hasher(), id_map::key_equal(),
+	       id_map::allocator_type(arena)),
+	  _strs(str_vector::allocator_type(arena))
+{
+	intern_id("");
+}
+
+tmln::StringPool::~StringPool()
+{
+}
+
+/**
+ * Get id of str, adding it to the pool if not already interned.
+ */
+tmln::StrId
+tmln::StringPool::intern_id(const std::string& str)
+{
+	id_map::iterator it = _ids.find(str);
+	if (it != _ids.end()) {
+		return it->second;
+	}
+
+	StrId id = static_cast<StrId>(_strs.size());
+	it = _ids.emplace(str, id).first;
+	_strs.push_back(&it->first);
+	return id;
+}
@@ -0,0 +1,134 @@
+//
+// Copyright (C) 2022 Claes Nästén <pekdon@gmail.com>
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+//
+
+
+#ifndef _TMLN_STRING_POOL_HH_
+#define _TMLN_STRING_POOL_HH_
+
+#include "config.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tmln_arena.hh"
+
+namespace tmln {
+
+	typedef uint32_t StrId;
+
+	class StringPool;
+
+	/**
+	 * Reference to a string interned in a StringPool, identified by
+	 * the pool and the id of the string in it. Only the pool creates
+	 * references so a StrRef always refers to an interned string.
+	 */
+	class StrRef {
+	public:
+		const StringPool* pool() const { return _pool; }
+		StrId id() const { return _id; }
+
+		const std::string& str() const;
+		operator const std::string&() const { return str(); }
+
+	private:
+		StrRef(const StringPool* pool, StrId id)
+			: _pool(pool),
+			  _id(id)
+		{
+		}
+
+	private:
+		const StringPool* _pool;
+		StrId _id;
+
+		friend class StringPool;
+	};
+
+	/**
+	 * Pool of interned strings, each distinct string is stored once
+	 * and identified by a StrId or a stable reference. Id 0 is
+	 * always the empty string.
+	 *
+	 * Hash table nodes and the id table are allocated from arena if
+	 * given, strings too long for the small string buffer of
+	 * std::string keep their characters on the heap.
+	 */
+	class StringPool {
+	public:
+		StringPool(Arena* arena = nullptr);
+		StringPool(const StringPool&) = delete;
+		~StringPool();
+
+		StringPool& operator=(const StringPool&) = delete;
+
+		size_t size() const { return _strs.size(); }
+
+		StrId intern_id(const std::string& str);
+		StrRef intern(const std::string& str)
+		{
+			return StrRef(this, intern_id(str));
+		}
+		StrRef ref(StrId id) const { return StrRef(this, id); }
+		const std::string& str(StrId id) const { return *_strs[id]; }
+
+	private:
+		typedef std::unordered_map<std::string, StrId,
+					   std::hash<std::string>,
+					   std::equal_to<std::string>,
+					   ArenaAllocator<std::pair<
+						   const std::string, StrId>>>
+			id_map;
+		typedef std::vector<const std::string*,
+				    ArenaAllocator<const std::string*>>
+			str_vector;
+
+		id_map _ids;
+		str_vector _strs;
+	};
+
+	inline const std::string& StrRef::str() const
+	{
+		return _pool->str(_id);
+	}
+
+	/**
+	 * References to the same pool compare ids, references to
+	 * different pools compare the strings.
+	 */
+	inline bool operator==(const StrRef& lhs, const StrRef& rhs)
+	{
+		if (lhs.pool() == rhs.pool()) {
+			return lhs.id() == rhs.id();
+		}
+		return lhs.str() == rhs.str();
+	}
+
+	inline bool operator!=(const StrRef& lhs, const StrRef& rhs)
+	{
+		return ! (lhs == rhs);
+	}
+}
+
+#endif // _TMLN_STRING_POOL_HH_
@@ -21,9 +21,16 @@
 // 
 
 #include <cstring>
+#include <limits>
 
 #include "tmln_style.hh"
 
+static const char* PALETTE[] = {
+	"#4e79a7", "#f28e2b", "#e15759", "#76b7b2", "#59a14f",
+	"#edc948", "#b07aa1", "#ff9da7", "#9c755f", "#bab0ac",
+	nullptr
+};
+
 // Color
 
 tmln::Color::Color(uint8_t _a, uint8_t _r, uint8_t _g, uint8_t _b)
@@ -34,14 +41,6 @@ tmln::Color::Color(uint8_t _a, uint8_t _r, uint8_t _g, uint8_t _b)
 {
 }
 
-tmln::Color::Color(const Color& color)
-	: a(color.a),
-	  r(color.r),
-	  g(color.g),
-	  b(color.b)
-{
-}
-
 tmln::Color::Color(const std::string& color)
 	: a(255),
 	  r(0),
@@ -80,6 +79,7 @@ tmln::operator==(const Color& lhs, const Color& rhs)
 tmln::Style::Style(const std::string& name,
 		   uint8_t a, uint8_t r, uint8_t g, uint8_t b) 
 	: _name(name),
+	  _id(0),
 	  _fg(a, r, g, b),
 	  _bg(255, 0, 0, 0)
 {
@@ -87,6 +87,7 @@ tmln::Style::Style(const std::string& name,
 
 tmln::Style::Style(const std::string& name, const Color& fg, const Color& bg)
 	: _name(name),
+	  _id(0),
 	  _fg(fg),
 	  _bg(bg)
 {
@@ -94,6 +95,15 @@ tmln::Style::Style(const std::string& name, const Color& fg, const Color& bg)
 
 tmln::Style::Style(const Style& style)
 	: _name(style._name),
+	  _id(style._id),
+	  _fg(style._fg),
+	  _bg(style._bg)
+{
+}
+
+tmln::Style::Style(Style&& style)
+	: _name(std::move(style._name)),
+	  _id(style._id),
 	  _fg(style._fg),
 	  _bg(style._bg)
 {
@@ -114,13 +124,15 @@ tmln::operator==(const tmln::Style& lhs, const tmln::Style& rhs)
 // Styles
 
 tmln::Styles::Styles()
-	: _default_style("default", 255, 0, 0, 0)
 {
+	_styles.emplace_back("default", 255, 0, 0, 0);
+	_undefined.push_back(false);
+
 	Color black(255, 0, 0, 0);
 	const char* colors[] =
 		{"white", "grey", "black", "red", "green", "blue", nullptr};
 	for (const char** color = colors; *color; color++) {
-		_styles.emplace(*color, Style(*color, Color(*color), black));
+		add_id(Style(*color, Color(*color), black), false);
 	}
 }
 
@@ -131,35 +143,109 @@ tmln::Styles::~Styles()
 bool
 tmln::Styles::has_style(const std::string& name)
 {
-	std::map<std::string, Style>::const_iterator it = _styles.find(name);
-	return it != _styles.end();
-
+	std::unordered_map<std::string, StyleId>::const_iterator it =
+		_ids.find(name);
+	return it != _ids.end() && ! _undefined[it->second];
 }
 
 const tmln::Style&
 tmln::Styles::get_style(const std::string &name)
 {
-	std::map<std::string, Style>::const_iterator it = _styles.find(name);
-	if (it != _styles.end()) {
-		return it->second;
+	std::unordered_map<std::string, StyleId>::const_iterator it =
+		_ids.find(name);
+	if (it != _ids.end()) {
+		return _styles[it->second];
 	}
 
 	// missing style, see if the style is an #rrggbb color
 	if (name.size() == 7 && name[0] == '#') {
 		int r, g, b;
 		if (sscanf(name.c_str(), "#%02x%02x%02x", &r, &g, &b) == 3) {
-			_styles.emplace(name,
-					Style(name, 255, r, g, b));
-			it = _styles.find(name);
-			return it->second;
+			return _styles[add_id(Style(name, 255, r, g, b),
+					      false)];
 		}
 	}
 
-	return _default_style;
+	return default_style();
+}
+
+/**
+ * Get id of style by name, unlike get_style a style not yet added is
+ * created using the default colors. The style is updated in place when
+ * it is added later, allowing styles to be defined after the events
+ * using them.
+ */
+tmln::StyleId
+tmln::Styles::ref_id(const std::string& name)
+{
+	const Style& style = get_style(name);
+	if (&style != &default_style()) {
+		return style.id();
+	}
+	return add_id(Style(name, default_style().fg(), default_style().bg()),
+		      true);
+}
+
+/**
+ * Get style idx, modulo the palette size, from a palette of distinct
+ * colors used for generated styles.
+ */
+const tmln::Style&
+tmln::Styles::palette_style(size_t idx)
+{
+	if (_palette.empty()) {
+		for (const char** color = PALETTE; *color; color++) {
+			_palette.push_back(&get_style(*color));
+		}
+	}
+	return *_palette[idx % _palette.size()];
 }
 
 void
 tmln::Styles::add_style(const Style& style)
 {
-	_styles.emplace(style.name(), style);
+	add_style(Style(style));
+}
+
+void
+tmln::Styles::add_style(Style&& style)
+{
+	std::unordered_map<std::string, StyleId>::const_iterator it =
+		_ids.find(style.name());
+	if (it == _ids.end()) {
+		add_id(std::move(style), false);
+	} else if (_undefined[it->second]) {
+		_styles[it->second].set_colors(style.fg(), style.bg());
+		_undefined[it->second] = false;
+	}
+}
+
+/**
+ * Add the styles added to styles, styles only referenced there are
+ * skipped.
+ */
+void
+tmln::Styles::add_styles(const Styles& styles)
+{
+	for (size_t id = 1; id < styles._styles.size(); id++) {
+		if (! styles._undefined[id]) {
+			add_style(styles._styles[id]);
+		}
+	}
+}
+
+tmln::StyleId
+tmln::Styles::add_id(Style&& style, bool undefined)
+{
+	if (_styles.size() > std::numeric_limits<StyleId>::max()) {
+		// out of style ids
+		return 0;
+	}
+
+	StyleId id = static_cast<StyleId>(_styles.size());
+	style._id = id;
+	_ids.emplace(style.name(), id);
+	_styles.push_back(std::move(style));
+	_undefined.push_back(undefined);
+	return id;
 }
@@ -26,19 +26,26 @@
 #include "config.h"
 
 #include <cstdint>
-#include <map>
+#include <deque>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace tmln {
 
+	/** Index of a style in the palette of its Styles. */
+	typedef uint16_t StyleId;
+
 	/**
 	 * Single ARGB color definition.
 	 */
 	struct Color {
 		Color(uint8_t _a, uint8_t _r, uint8_t _g, uint8_t _b);
-		Color(const Color& color);
+		Color(const Color& color) = default;
 		Color(const std::string& color);
 
+		Color& operator=(const Color& color) = default;
+
 		void get(uint8_t& a, uint8_t& r, uint8_t& g, uint8_t& b) const
 		{
 			a = this->a;
@@ -65,11 +72,19 @@ namespace tmln {
 		Style(const std::string& name,
 		      const Color& fg, const Color& bg);
 		Style(const Style& style);
+		Style(Style&& style);
 		~Style();
 
 		const std::string& name() const { return _name; }
+		/** id in the Styles the style was added to, 0 if none. */
+		StyleId id() const { return _id; }
 		const Color& fg() const { return _fg; }
 		const Color& bg() const { return _bg; }
+		void set_colors(const Color& fg, const Color& bg)
+		{
+			_fg = fg;
+			_bg = bg;
+		}
 
 		void get_fg(uint8_t& a,
 			    uint8_t& r, uint8_t& g, uint8_t& b) const
@@ -84,28 +99,58 @@ namespace tmln {
 
 	private:
 		std::string _name;
+		StyleId _id;
 		Color _fg;
 		Color _bg;
+
+		friend class Styles;
 	};
 
 	bool operator==(const Style& lhs, const Style& rhs);
 
 	/**
 	 * Default timline styles.
+	 *
+	 * Styles are kept in a palette indexed by StyleId, with the
+	 * default style at id 0. Names are resolved to an id once, style
+	 * references and ids stay valid for the lifetime of the Styles.
+	 * When more than 65536 styles are added the default style is
+	 * used for the rest.
 	 */
 	class Styles {
 	public:
 		Styles();
 		~Styles();
 
-		const Style& default_style() const { return _default_style; }
+		const Style& default_style() const { return _styles.front(); }
+		size_t size() const { return _styles.size(); }
+		const Style& style(StyleId id) const { return _styles[id]; }
+
 		bool has_style(const std::string& name);
 		const Style& get_style(const std::string& name);
+		StyleId ref_id(const std::string& name);
+		const Style& ref_style(const std::string& name)
+		{
+			return _styles[ref_id(name)];
+		}
+		const Style& palette_style(size_t idx);
 		void add_style(const Style& style);
+		void add_style(Style&& style);
+		void add_styles(const Styles& styles);
+
+	private:
+		StyleId add_id(Style&& style, bool undefined);
 
 	private:
-		Style _default_style;
-		std::map<std::string, Style> _styles;
+		/** palette, indexed by StyleId. */
+		std::deque<Style> _styles;
+		std::unordered_map<std::string, StyleId> _ids;
+		/**
+		 * set for styles referenced with ref_id before being
+		 * added, indexed by StyleId.
+		 */
+		std::vector<bool> _undefined;
+		std::vector<const Style*> _palette;
 	};
 };
 
@@ -21,147 +21,234 @@
 //
 
 #include <iostream>
+#include <cmath>
+#include <cstdlib>
 #include <ctime>
 #include <cstring>
+#include <limits>
 
 #include "tmln_time.hh"
 
-namespace tmln {
-	const int64_t NSEC_PER_SEC = 1000000000;
-}
-
 // Ts
 
-tmln::Ts::Ts(double sec)
-	: _sec(sec),
-	  _nsec((sec - _sec) * NSEC_PER_SEC)
+tmln::Ts::Ts(const std::string& time_str)
+	: _ns(0)
 {
+	parse(time_str.c_str(), time_str.size());
 }
 
-tmln::Ts::Ts(int64_t sec, int64_t nsec)
-	: _sec(sec),
-	  _nsec(nsec)
+tmln::Ts::Ts(const char* time_str)
+	: _ns(0)
 {
+	parse(time_str, strlen(time_str));
 }
 
-tmln::Ts::Ts(const std::string& time_str)
+/**
+ * Parse n digits at str into val.
+ */
+static inline bool
+parse_digits(const char* str, int n, int& val)
 {
-	parse(time_str.c_str());
+	val = 0;
+	for (int i = 0; i < n; i++) {
+		unsigned int digit = static_cast<unsigned char>(str[i]) - '0';
+		if (digit > 9) {
+			return false;
+		}
+		val = val * 10 + digit;
+	}
+	return true;
 }
 
-tmln::Ts::Ts(const char* time_str)
+/**
+ * Days since 1970-01-01 for the proleptic Gregorian calendar date.
+ */
+static inline int64_t
+days_from_civil(int64_t y, int m, int d)
 {
-	parse(time_str);
+	y -= m <= 2;
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	int64_t yoe = y - era * 400;
+	int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
 }
 
-tmln::Ts::~Ts()
-{
+/**
+ * Parse YYYY-MM-DDTHH:MM:SS[.fffffffff][Z|+hh:mm|-hh:mm] using integer
+ * arithmetic only. Digits after the 9th fraction digit are ignored,
+ * timestamps without zone are UTC. Returns false if str does not
+ * match the format.
+ */
+bool
+tmln::Ts::parse_iso8601(const char* str, size_t len, Ts& ts)
+{
+	int year, month, day, hour, min, sec;
+	if (len < 19
+	    || ! parse_digits(str, 4, year) || str[4] != '-'
+	    || ! parse_digits(str + 5, 2, month) || str[7] != '-'
+	    || ! parse_digits(str + 8, 2, day)
+	    || (str[10] != 'T' && str[10] != 't' && str[10] != ' ')
+	    || ! parse_digits(str + 11, 2, hour) || str[13] != ':'
+	    || ! parse_digits(str + 14, 2, min) || str[16] != ':'
+	    || ! parse_digits(str + 17, 2, sec)) {
+		return false;
+	}
+	if (month < 1 || month > 12 || day < 1 || day > 31
+	    || hour > 23 || min > 59 || sec > 60) {
+		return false;
+	}
+
+	size_t pos = 19;
+	int64_t nsec = 0;
+	if (pos < len && (str[pos] == '.' || str[pos] == ',')) {
+		pos++;
+		size_t num_digits = 0;
+		for (; pos < len; pos++, num_digits++) {
+			unsigned int digit =
+				static_cast<unsigned char>(str[pos]) - '0';
+			if (digit > 9) {
+				break;
+			} else if (num_digits < 9) {
+				nsec = nsec * 10 + digit;
+			}
+		}
+		if (num_digits == 0) {
+			return false;
+		}
+		for (; num_digits < 9; num_digits++) {
+			nsec *= 10;
+		}
+	}
+
+	int64_t offset = 0;
+	if (pos < len && (str[pos] == 'Z' || str[pos] == 'z')) {
+		pos++;
+	} else if (pos < len && (str[pos] == '+' || str[pos] == '-')) {
+		int sign = str[pos] == '-' ? -1 : 1;
+		int off_hour, off_min = 0;
+		if (len - pos < 3 || ! parse_digits(str + pos + 1, 2, off_hour)) {
+			return false;
+		}
+		pos += 3;
+		if (pos < len && str[pos] == ':') {
+			pos++;
+		}
+		if (pos < len) {
+			if (len - pos < 2
+			    || ! parse_digits(str + pos, 2, off_min)) {
+				return false;
+			}
+			pos += 2;
+		}
+		offset = sign * (off_hour * 3600 + off_min * 60);
+	}
+	if (pos != len) {
+		return false;
+	}
+
+	int64_t days = days_from_civil(year, month, day);
+	int64_t secs = days * 86400 + hour * 3600 + min * 60 + sec - offset;
+	ts._ns = secs * NSEC_PER_SEC + nsec;
+	return true;
 }
 
-void
-tmln::Ts::parse(const char* time_str)
+/**
+ * Parse timestamp using strptime, accepts all input strptime accepts
+ * for %Y-%m-%dT%H:%M:%S followed by an optional fraction.
+ */
+tmln::Ts
+tmln::Ts::parse_strptime(const char* time_str)
 {
 	struct tm tm = {0};
 	strptime(time_str, "%Y-%m-%dT%H:%M:%S", &tm);
 	time_t sec = timegm(&tm);
-	_sec = sec;
+	int64_t ns = static_cast<int64_t>(sec) * NSEC_PER_SEC;
 	const char* dot = strrchr(time_str, '.');
-	if (dot == nullptr) {
-		_nsec = 0;
-	} else {
+	if (dot != nullptr) {
 		std::string dec_str("0.");
 		dec_str += (dot + 1);
-		_nsec = std::stod(dec_str) * NSEC_PER_SEC;
+		ns += static_cast<int64_t>(std::stod(dec_str) * NSEC_PER_SEC);
 	}
+	return from_ns(ns);
 }
 
+/**
+ * Parse JSON number in unit_ns units, the integer part is converted
+ * exactly and fractions down to nanoseconds. end is set to the first
+ * character after the number, returns false if there are no digits.
+ */
 bool
-tmln::operator==(const Ts& lhs, const Ts& rhs)
-{
-	return (lhs.sec() == rhs.sec()) && (lhs.nsec() == rhs.nsec());
-}
-
-bool
-tmln::operator<(const Ts& lhs, const Ts& rhs)
+tmln::Ts::parse_number(const char* str, int64_t unit_ns, Ts& ts,
+		       const char*& end)
 {
-	if (lhs.sec() < rhs.sec()) {
-		return true;
+	const char* pos = str;
+	bool negative = *pos == '-';
+	if (negative) {
+		pos++;
 	}
-	return (lhs.sec() == rhs.sec()) && (lhs.nsec() < rhs.nsec());
-}
-
-bool
-tmln::operator<=(const Ts& lhs, const Ts& rhs)
-{
-	return (lhs == rhs) || (lhs < rhs);
-}
 
-bool
-tmln::operator>(const Ts& lhs, const Ts& rhs)
-{
-	if (lhs.sec() > rhs.sec()) {
+	const char* digits = pos;
+	int64_t value = 0;
+	for (; *pos >= '0' && *pos <= '9'; pos++) {
+		if (value > (std::numeric_limits<int64_t>::max() - 9) / 10) {
+			return false;
+		}
+		value = value * 10 + (*pos - '0');
+	}
+	if (value > std::numeric_limits<int64_t>::max() / unit_ns) {
+		return false;
+	}
+	int64_t ns = value * unit_ns;
+	bool has_digits = pos != digits;
+
+	if (*pos == '.') {
+		int64_t frac = 0, scale = 1;
+		for (pos++; *pos >= '0' && *pos <= '9'; pos++) {
+			if (scale < NSEC_PER_SEC) {
+				frac = frac * 10 + (*pos - '0');
+				scale *= 10;
+			}
+			has_digits = true;
+		}
+		ns += frac * unit_ns / scale;
+	}
+	if (! has_digits) {
+		return false;
+	}
+	if (*pos == 'e' || *pos == 'E') {
+		char* exp_end;
+		double scaled = strtod(str, &exp_end) * unit_ns;
+		if (std::abs(scaled) >= std::numeric_limits<int64_t>::max()) {
+			return false;
+		}
+		ts._ns = static_cast<int64_t>(scaled);
+		end = exp_end;
 		return true;
 	}
-	return (lhs.sec() == rhs.sec()) && (lhs.nsec() > rhs.nsec());
-}
 
-bool
-tmln::operator>=(const Ts& lhs, const Ts& rhs)
-{
-	return (lhs == rhs) || (lhs > rhs);
+	ts._ns = negative ? -ns : ns;
+	end = pos;
+	return true;
 }
 
-tmln::Ts
-tmln::operator+(const Ts& lhs, const Ts& rhs)
-{
-	int64_t sec = lhs.sec() + rhs.sec();
-	int64_t nsec = lhs.nsec() + rhs.nsec();
-	if (nsec > NSEC_PER_SEC) {
-		sec += 1;
-		nsec -= NSEC_PER_SEC;
-	}
-	return Ts(sec, nsec);
-}
-
-tmln::Ts
-tmln::operator-(const Ts& lhs, const Ts& rhs)
+void
+tmln::Ts::parse(const char* time_str, size_t len)
 {
-	int64_t sec = lhs.sec() - rhs.sec();
-	int64_t nsec = lhs.nsec() - rhs.nsec();
-	if (nsec < 0) {
-		sec -= 1;
-		nsec += NSEC_PER_SEC;
+	if (! parse_iso8601(time_str, len, *this)) {
+		*this = parse_strptime(time_str);
 	}
-	return Ts(sec, nsec);
 }
 
 // TsSpan
 
-tmln::TsSpan::TsSpan(const Ts& start, const Ts& end)
-	: _start(start),
-	  _end(end)
-{
-}
-
-tmln::TsSpan::~TsSpan()
-{
-}
-
-double
-tmln::TsSpan::to_sec() const
-{
-	Ts diff = _end - _start;
-	return diff.to_sec();
-}
-
-bool
-tmln::TsSpan::inside(const Ts& ts) const
-{
-	return ts >= _start && ts < _end;
-}
-
+/**
+ * Check if span starts inside this span or starts before and extends
+ * into it.
+ */
 bool
-tmln::operator==(const tmln::TsSpan& lhs, const tmln::TsSpan& rhs)
+tmln::TsSpan::overlaps(const TsSpan& span) const
 {
-	return lhs.start() == rhs.start() && lhs.end() == rhs.end();
+	return inside(span.start())
+		|| (span.start() < _start && span.end() > _start);
 }
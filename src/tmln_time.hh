@@ -30,43 +30,102 @@
 
 namespace tmln {
 
-	extern const int64_t NSEC_PER_SEC;
+	constexpr int64_t NSEC_PER_SEC = 1000000000;
 
 	/**
-	 * Timestamp type used in Event
+	 * Timestamp type used in Event, nanoseconds since the epoch.
 	 */
 	class Ts {
 	public:
-		Ts(double sec);
-		Ts(int64_t sec, int64_t nsec);
+		constexpr Ts()
+			: _ns(0)
+		{
+		}
+		constexpr Ts(double sec)
+			: _ns(static_cast<int64_t>(sec) * NSEC_PER_SEC
+			      + static_cast<int64_t>(
+				      (sec - static_cast<int64_t>(sec))
+				      * NSEC_PER_SEC))
+		{
+		}
+		constexpr Ts(int64_t sec, int64_t nsec)
+			: _ns(sec * NSEC_PER_SEC + nsec)
+		{
+		}
 		Ts(const std::string& time_str);
 		Ts(const char* time_str);
-		~Ts(void);
 
-		int64_t sec() const { return _sec; }
-		int64_t nsec() const { return _nsec; }
+		static constexpr Ts from_ns(int64_t ns) { return Ts(0, ns); }
+		static bool parse_iso8601(const char* str, size_t len, Ts& ts);
+		static Ts parse_strptime(const char* str);
+		static bool parse_number(const char* str, int64_t unit_ns,
+					 Ts& ts, const char*& end);
+		/** parse_number requiring all of str to be a number. */
+		static bool parse_number(const char* str, int64_t unit_ns,
+					 Ts& ts)
+		{
+			const char* end;
+			return parse_number(str, unit_ns, ts, end)
+				&& *end == '\0';
+		}
+
+		constexpr int64_t ns() const { return _ns; }
+		constexpr int64_t sec() const
+		{
+			return _ns / NSEC_PER_SEC
+				- (_ns % NSEC_PER_SEC < 0 ? 1 : 0);
+		}
+		constexpr int64_t nsec() const
+		{
+			return _ns % NSEC_PER_SEC
+				+ (_ns % NSEC_PER_SEC < 0 ? NSEC_PER_SEC : 0);
+		}
 
-		double to_sec() const
+		constexpr double to_sec() const
 		{
-			return _sec + (_nsec / static_cast<double>(NSEC_PER_SEC));
+			return _ns / static_cast<double>(NSEC_PER_SEC);
 		}
 
 	private:
-		void parse(const char *time_str);
+		void parse(const char *time_str, size_t len);
 
 	private:
-		int64_t _sec;
-		int64_t _nsec;
+		int64_t _ns;
 	};
 
-	bool operator==(const Ts& lhs, const Ts& rhs);
-	bool operator<(const Ts& lhs, const Ts& rhs);
-	bool operator<=(const Ts& lhs, const Ts& rhs);
-	bool operator>(const Ts& lhs, const Ts& rhs);
-	bool operator>=(const Ts& lhs, const Ts& rhs);
-
-	Ts operator+(const Ts& lhs, const Ts& rhs);
-	Ts operator-(const Ts& lhs, const Ts& rhs);
+	constexpr bool operator==(const Ts& lhs, const Ts& rhs)
+	{
+		return lhs.ns() == rhs.ns();
+	}
+	constexpr bool operator!=(const Ts& lhs, const Ts& rhs)
+	{
+		return lhs.ns() != rhs.ns();
+	}
+	constexpr bool operator<(const Ts& lhs, const Ts& rhs)
+	{
+		return lhs.ns() < rhs.ns();
+	}
+	constexpr bool operator<=(const Ts& lhs, const Ts& rhs)
+	{
+		return lhs.ns() <= rhs.ns();
+	}
+	constexpr bool operator>(const Ts& lhs, const Ts& rhs)
+	{
+		return lhs.ns() > rhs.ns();
+	}
+	constexpr bool operator>=(const Ts& lhs, const Ts& rhs)
+	{
+		return lhs.ns() >= rhs.ns();
+	}
+
+	constexpr Ts operator+(const Ts& lhs, const Ts& rhs)
+	{
+		return Ts::from_ns(lhs.ns() + rhs.ns());
+	}
+	constexpr Ts operator-(const Ts& lhs, const Ts& rhs)
+	{
+		return Ts::from_ns(lhs.ns() - rhs.ns());
+	}
 
 
 	/**
@@ -74,14 +133,28 @@ namespace tmln {
 	 */
 	class TsSpan {
 	public:
-		TsSpan(const Ts& start, const Ts& end);
-		~TsSpan();
+		constexpr TsSpan(const Ts& start, const Ts& end)
+			: _start(start),
+			  _end(end)
+		{
+		}
 
-		double to_sec() const;
+		constexpr int64_t ns() const
+		{
+			return _end.ns() - _start.ns();
+		}
+		constexpr double to_sec() const
+		{
+			return (_end - _start).to_sec();
+		}
 
-		const Ts& start() const { return _start; }
-		const Ts& end() const { return _end; }
-		bool inside(const Ts& ts) const;
+		constexpr const Ts& start() const { return _start; }
+		constexpr const Ts& end() const { return _end; }
+		constexpr bool inside(const Ts& ts) const
+		{
+			return ts >= _start && ts < _end;
+		}
+		bool overlaps(const TsSpan& span) const;
 
 		void set_start(const Ts& start) { _start = start; }
 		void set_end(const Ts& end) { _end = end; }
@@ -91,7 +164,10 @@ namespace tmln {
 		Ts _end;
 	};
 
-	bool operator==(const TsSpan& lhs, const TsSpan& rhs);
+	constexpr bool operator==(const TsSpan& lhs, const TsSpan& rhs)
+	{
+		return lhs.start() == rhs.start() && lhs.end() == rhs.end();
+	}
 }
 
 #endif // _TMLN_TIME_HH_
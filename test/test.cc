@@ -24,9 +24,1666 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "config.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif // HAVE_ZLIB
+
+#include "tmln_arena.hh"
+#include "tmln_data_columnar.hh"
+#include "tmln_decompress.hh"
+#include "tmln_file_input.hh"
+#include "tmln_follow_file.hh"
+#include "tmln_interval_index.hh"
+#include "tmln_json_reader.hh"
+#include "tmln_line_reader.hh"
+#include "tmln_live_input.hh"
+#include "tmln_load_async.hh"
+#include "tmln_load_chrome.hh"
+#include "tmln_load_csv.hh"
+#include "tmln_load_files.hh"
 #include "tmln_load_json.hh"
+#include "tmln_load_ninja.hh"
+#include "tmln_selection.hh"
+#include "tmln_snapshot.hh"
+#include "tmln_sort.hh"
 #include "tmln_time.hh"
 
+// tmln_arena
+
+TEST_CASE("test Arena alloc")
+{
+	tmln::Arena arena(1024);
+	CHECK(arena.size() == 0);
+	char* c = static_cast<char*>(arena.alloc(1, 1));
+	int64_t* i = static_cast<int64_t*>(arena.alloc(sizeof(int64_t),
+						       alignof(int64_t)));
+	CHECK(reinterpret_cast<uintptr_t>(i) % alignof(int64_t) == 0);
+	CHECK(reinterpret_cast<char*>(i) > c);
+	CHECK(arena.size() == 1024);
+
+	// large allocations get a block of their own
+	void* large = arena.alloc(4096);
+	CHECK(arena.size() > 1024 + 4096);
+	arena.free(large, 4096);
+	CHECK(arena.size() == 1024);
+}
+
+TEST_CASE("test Arena free")
+{
+	tmln::Arena arena(1024);
+	void* ptr = arena.alloc(64);
+	void* other = arena.alloc(32);
+	arena.free(ptr, 64);
+	CHECK(arena.alloc(32) != ptr);
+	CHECK(arena.alloc(64) == ptr);
+	arena.free(other, 32);
+	CHECK(arena.alloc(32) == other);
+	CHECK(arena.size() == 1024);
+
+	// sizes in the same class share a free list
+	void* small = arena.alloc(20);
+	arena.free(small, 20);
+	CHECK(arena.alloc(24) == small);
+	void* large = arena.alloc(4000);
+	arena.free(large, 4000);
+	CHECK(arena.size() == 1024);
+}
+
+TEST_CASE("test ArenaAllocator")
+{
+	tmln::Arena arena;
+	std::vector<int, tmln::ArenaAllocator<int>>
+		vec{tmln::ArenaAllocator<int>(&arena)};
+	for (int i = 0; i < 1000; i++) {
+		vec.push_back(i);
+	}
+	CHECK(vec[999] == 999);
+	CHECK(arena.size() == tmln::Arena::BLOCK_SIZE);
+}
+
+// tmln_data_columnar
+
+TEST_CASE("test ColumnarData add_event")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::StringPool& strings = data.strings();
+	tmln::Event event(strings.intern("label"), strings.intern("info"),
+			  tmln::Ts(1, 0), tmln::Ts(62, 3000000),
+			  styles.get_style("red"));
+	event.add_step(strings.intern("step1"), strings.intern(""),
+		       tmln::Ts(1, 0), tmln::Ts(2, 500),
+		       styles.get_style("blue"));
+	event.add_step(strings.intern("step2"), strings.intern("info"),
+		       tmln::Ts(2, 500), tmln::Ts(62, 0),
+		       styles.default_style());
+	CHECK(data.add_event(event) == true);
+	CHECK(data.add_event(tmln::Event(strings.intern("other"),
+					 strings.intern(""),
+					 tmln::Ts(10, 0), tmln::Ts(70, 0),
+					 styles.get_style("red"))) == true);
+
+	CHECK(data.size() == 2);
+	CHECK(data.num_steps() == 2);
+	CHECK(data[0] == event);
+	CHECK(data[1].label() == "other");
+	CHECK(data[0].steps()[1].info() == "info");
+	CHECK(data[1].steps().size() == 0);
+	CHECK(&data[1].style() == &styles.get_style("red"));
+	CHECK(data.event_span(1) == tmln::TsSpan(tmln::Ts(10, 0),
+						 tmln::Ts(70, 0)));
+	CHECK(data.span() == tmln::TsSpan(tmln::Ts(1, 0), tmln::Ts(70, 0)));
+}
+
+TEST_CASE("test ColumnarData emplace_event")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::StringPool& strings = data.strings();
+	tmln::StrRef label = strings.intern("label");
+	tmln::EventBuilder first =
+		data.emplace_event(label, label, tmln::Ts(1, 0),
+				   tmln::Ts(3, 0), styles.default_style());
+	CHECK(first.add_step(label, label, tmln::Ts(1, 0), tmln::Ts(2, 0),
+			     styles.default_style()) == true);
+	CHECK(data[0].steps().size() == 1);
+	CHECK(first.add_step(label, label, tmln::Ts(2, 0), tmln::Ts(3, 0),
+			     styles.default_style()) == true);
+	CHECK(data[0].steps().size() == 2);
+
+	tmln::EventBuilder second =
+		data.emplace_event(label, label, tmln::Ts(2, 0),
+				   tmln::Ts(4, 0), styles.default_style());
+	CHECK(second.idx() == 1);
+	CHECK(first.add_step(label, label, tmln::Ts(3, 0), tmln::Ts(4, 0),
+			     styles.default_style()) == false);
+	CHECK(data[0].steps().size() == 2);
+	CHECK(data[1].steps().size() == 0);
+	CHECK(data.span() == tmln::TsSpan(tmln::Ts(1, 0), tmln::Ts(4, 0)));
+}
+
+TEST_CASE("test ColumnarData emplace_event foreign pool")
+{
+	tmln::Styles styles;
+	tmln::StringPool other;
+	other.intern_id("padding");
+	tmln::ColumnarData data("memory");
+	data.emplace_event(other.intern("label"), other.intern("info"),
+			   tmln::Ts(1, 0), tmln::Ts(2, 0),
+			   styles.default_style());
+	CHECK(data[0].label() == "label");
+	CHECK(data[0].info() == "info");
+	CHECK(data[0].label_ref().pool() == &data.strings());
+}
+
+TEST_CASE("test ColumnarData finalize")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::StringPool& strings = data.strings();
+	const char* labels[] = {"c", "a", "b"};
+	int starts[] = {30, 10, 20};
+	for (int i = 0; i < 3; i++) {
+		tmln::EventBuilder builder =
+			data.emplace_event(strings.intern(labels[i]),
+					   strings.intern(""),
+					   tmln::Ts(starts[i], 0),
+					   tmln::Ts(starts[i] + 5, 0),
+					   styles.default_style());
+		for (int j = 0; j <= i; j++) {
+			builder.add_step(strings.intern(labels[i]),
+					 strings.intern(""),
+					 tmln::Ts(starts[i] + j, 0),
+					 tmln::Ts(starts[i] + j + 1, 0),
+					 styles.default_style());
+		}
+	}
+	CHECK(data[0].label() == "c");
+	CHECK(data.span() == tmln::TsSpan(tmln::Ts(10, 0), tmln::Ts(35, 0)));
+
+	data.finalize();
+	CHECK(data[0].label() == "a");
+	CHECK(data[0].steps().size() == 2);
+	CHECK(data[0].steps()[1].start() == tmln::Ts(11, 0));
+	CHECK(data[1].label() == "b");
+	CHECK(data[1].steps().size() == 3);
+	CHECK(data[2].label() == "c");
+	CHECK(data[2].steps().size() == 1);
+	CHECK(data[2].steps()[0].label() == "c");
+}
+
+TEST_CASE("test ColumnarData cache")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	size_t num = tmln::ColumnarData::CACHE_SIZE + 1;
+	for (size_t i = 0; i < num; i++) {
+		tmln::StringPool& strings = data.strings();
+		data.add_event(tmln::Event(strings.intern(std::to_string(i)),
+					   strings.intern(""),
+					   tmln::Ts(i, 0), tmln::Ts(i + 1, 0),
+					   styles.default_style()));
+	}
+	CHECK(data[0].label() == "0");
+	CHECK(data[num - 1].label() == std::to_string(num - 1));
+	CHECK(data[0].label() == "0");
+	CHECK(data[0].start() == tmln::Ts(0, 0));
+}
+
+TEST_CASE("test ColumnarData compact steps")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory", tmln::ColumnarData::STEP_COMPACT);
+	tmln::StringPool& strings = data.strings();
+	tmln::Event event(strings.intern("late"), strings.intern(""),
+			  tmln::Ts(100, 0), tmln::Ts(200, 0),
+			  styles.get_style("red"));
+	// overlapping and out of order steps encode negative deltas
+	event.add_step(strings.intern("s1"), strings.intern("i1"),
+		       tmln::Ts(150, 250), tmln::Ts(180, 0),
+		       styles.get_style("blue"));
+	event.add_step(strings.intern("s2"), strings.intern(""),
+		       tmln::Ts(100, 1), tmln::Ts(199, 999999999),
+		       styles.default_style());
+	CHECK(data.add_event(event) == true);
+	tmln::EventBuilder builder =
+		data.emplace_event(strings.intern("early"), strings.intern(""),
+				   tmln::Ts(10, 0), tmln::Ts(20, 0),
+				   styles.default_style());
+	CHECK(builder.add_step(strings.intern("s3"), strings.intern(""),
+			       tmln::Ts(10, 0), tmln::Ts(20, 0),
+			       styles.get_style("red")) == true);
+	CHECK(data.num_steps() == 3);
+	CHECK(data[0] == event);
+
+	data.finalize();
+	CHECK(data[0].label() == "early");
+	CHECK(data[0].steps().size() == 1);
+	CHECK(&data[0].steps()[0].style() == &styles.get_style("red"));
+	CHECK(data[1] == event);
+	CHECK(data[1].steps()[0].start() == tmln::Ts(150, 250));
+	CHECK(data[1].steps()[1].end() == tmln::Ts(199, 999999999));
+}
+
+TEST_CASE("test ColumnarData event sources")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::StringPool& strings = data.strings();
+	size_t other = data.add_source("other");
+	CHECK(other == 1);
+	REQUIRE(data.sources().size() == 2);
+	CHECK(data.sources()[0] == "memory");
+
+	data.emplace_event(strings.intern("b"), strings.intern(""),
+			   tmln::Ts(2, 0), tmln::Ts(3, 0),
+			   styles.default_style());
+	data.emplace_event(strings.intern("a"), strings.intern(""),
+			   tmln::Ts(1, 0), tmln::Ts(2, 0),
+			   styles.default_style());
+	CHECK(data.event_source(0) == 0);
+	CHECK(data.set_event_source(0, other) == true);
+	data.finalize();
+	CHECK(data[0].label() == "a");
+	CHECK(data.event_source(0) == 0);
+	CHECK(data.event_source(1) == other);
+}
+
+TEST_CASE("test ColumnarData append")
+{
+	tmln::Styles src_styles;
+	tmln::ColumnarData src("src", tmln::ColumnarData::STEP_COMPACT);
+	tmln::StringPool& strings = src.strings();
+	const tmln::Style& style = src_styles.ref_style("s");
+	tmln::EventBuilder event =
+		src.emplace_event(strings.intern("a"), strings.intern("i"),
+				  tmln::Ts(1, 0), tmln::Ts(3, 0), style);
+	event.add_step(strings.intern("x"), strings.intern(""),
+		       tmln::Ts(1, 0), tmln::Ts(2, 0), style);
+	event.add_step(strings.intern("y"), strings.intern(""),
+		       tmln::Ts(2, 0), tmln::Ts(3, 0),
+		       src_styles.default_style());
+	src.emplace_event(strings.intern("b"), strings.intern(""),
+			  tmln::Ts(4, 0), tmln::Ts(5, 0),
+			  src_styles.default_style());
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::VectorData vector_data("memory");
+	data.strings().intern("other");
+	tmln::IdMap map, vector_map;
+	src.map_ids(data, styles, map);
+	src.map_ids(vector_data, styles, vector_map);
+	CHECK(data.append(src, 0, 2, map, tmln::Ts(10, 0)) == true);
+	CHECK(vector_data.append(src, 0, 2, vector_map, tmln::Ts(10, 0))
+	      == true);
+
+	for (tmln::Data* copy : {static_cast<tmln::Data*>(&data),
+				 static_cast<tmln::Data*>(&vector_data)}) {
+		REQUIRE(copy->size() == 2);
+		const tmln::Event& first = (*copy)[0];
+		CHECK(first.label() == "a");
+		CHECK(first.info() == "i");
+		CHECK(first.span() == tmln::TsSpan(tmln::Ts(11, 0),
+						   tmln::Ts(13, 0)));
+		CHECK(&first.style() == &styles.ref_style("s"));
+		REQUIRE(first.steps().size() == 2);
+		CHECK(first.steps()[0].label() == "x");
+		CHECK(first.steps()[1].start() == tmln::Ts(12, 0));
+		CHECK(&first.steps()[1].style() == &styles.default_style());
+		CHECK((*copy)[1].label() == "b");
+	}
+	CHECK(data.num_steps() == 2);
+}
+
+TEST_CASE("test ColumnarData raw steps")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory", tmln::ColumnarData::STEP_COMPACT,
+				&styles);
+	CHECK(data.stores_raw_steps() == true);
+	tmln::LoadJson load(data, styles);
+	CHECK(load.load("{\"unit\": \"ms\", \"events\": ["
+			"{\"label\": \"b\", \"start\": 2000, \"end\": 4000,"
+			" \"steps\": [{\"label\": \"s1\", \"info\": \"i\","
+			" \"start\": 2000, \"dur\": 500, \"style\": \"s\"},"
+			" {\"label\": \"invalid\"},"
+			" {\"label\": \"s2 ]}\", \"start\": 3000,"
+			" \"end\": 4000}]},"
+			"{\"label\": \"a\", \"start\": 0, \"end\": 1000}],"
+			" \"styles\": [{\"name\": \"s\","
+			" \"fg\": \"#112233\"}]}")
+	      == true);
+	// steps are kept as text until their event is accessed
+	CHECK(data.num_steps() == 0);
+	REQUIRE(data.size() == 2);
+	CHECK(data[0].steps().empty());
+	const tmln::Event& event = data[1];
+	CHECK(&data[1] == &event);
+	REQUIRE(event.steps().size() == 2);
+	CHECK(event.steps()[0].label() == "s1");
+	CHECK(event.steps()[0].info() == "i");
+	CHECK(event.steps()[0].span()
+	      == tmln::TsSpan(tmln::Ts(2, 0), tmln::Ts(2, 500000000)));
+	CHECK(event.steps()[0].style().fg() == tmln::Color(255, 17, 34, 51));
+	CHECK(event.steps()[1].label() == "s2 ]}");
+	CHECK(&event.steps()[1].style() == &styles.default_style());
+
+	// more events with steps than the decoded events cache holds
+	std::string ndjson;
+	size_t num_events = tmln::ColumnarData::DECODED_CACHE_SIZE + 10;
+	for (size_t i = 0; i < num_events; i++) {
+		std::string num = std::to_string(i);
+		ndjson += "{\"label\": \"e\", \"start\": " + num
+			+ ", \"dur\": 1, \"steps\": [{\"label\": \"s" + num
+			+ "\", \"start\": " + num + ", \"dur\": 1}]}\n";
+	}
+	tmln::ColumnarData lines("memory", tmln::ColumnarData::STEP_COMPACT,
+				 &styles);
+	tmln::LoadJson lines_load(lines, styles);
+	CHECK(lines_load.load_ndjson(ndjson) == true);
+	REQUIRE(lines.size() == num_events);
+	bool equal = true;
+	for (size_t i = 0; i < 2 * num_events; i++) {
+		size_t idx = i % num_events;
+		const tmln::Event& line_event = lines[idx];
+		equal = equal && line_event.steps().size() == 1
+			&& line_event.steps()[0].label()
+			   == "s" + std::to_string(idx);
+	}
+	CHECK(equal);
+}
+
+TEST_CASE("test ColumnarData append raw steps")
+{
+	tmln::Styles src_styles;
+	tmln::ColumnarData src("src", tmln::ColumnarData::STEP_COMPACT,
+			       &src_styles);
+	tmln::LoadJson load(src, src_styles);
+	CHECK(load.load_ndjson("{\"label\": \"a\", \"start\": 1, "
+			       "\"end\": 3, \"steps\": [{\"label\": \"x\", "
+			       "\"start\": 1, \"end\": 2, "
+			       "\"style\": \"s\"}]}\n")
+	      == true);
+
+	tmln::Styles styles;
+	styles.add_style(tmln::Style("s", tmln::Color("#112233"),
+				     tmln::Color("#445566")));
+	tmln::ColumnarData data("memory", tmln::ColumnarData::STEP_COMPACT,
+				&styles);
+	tmln::ColumnarData columns("memory");
+	tmln::VectorData vector_data("memory");
+	for (tmln::Data* copy : {static_cast<tmln::Data*>(&data),
+				 static_cast<tmln::Data*>(&columns),
+				 static_cast<tmln::Data*>(&vector_data)}) {
+		tmln::IdMap map;
+		src.map_ids(*copy, styles, map);
+		CHECK(copy->append(src, 0, 1, map, tmln::Ts(10, 0)) == true);
+		REQUIRE(copy->size() == 1);
+		const tmln::Event& event = (*copy)[0];
+		REQUIRE(event.steps().size() == 1);
+		CHECK(event.steps()[0].label() == "x");
+		CHECK(event.steps()[0].start() == tmln::Ts(11, 0));
+		CHECK(&event.steps()[0].style() == &styles.ref_style("s"));
+	}
+	// steps are parsed only for data not storing raw steps
+	CHECK(data.num_steps() == 0);
+	CHECK(columns.num_steps() == 1);
+
+	// offsets add up when raw steps are appended again
+	tmln::ColumnarData again("again", tmln::ColumnarData::STEP_COMPACT,
+				 &styles);
+	tmln::IdMap map;
+	data.map_ids(again, styles, map);
+	CHECK(again.append(data, 0, 1, map, tmln::Ts(5, 0)) == true);
+	REQUIRE(again[0].steps().size() == 1);
+	CHECK(again[0].steps()[0].start() == tmln::Ts(16, 0));
+}
+
+// tmln_data
+
+TEST_CASE("test Data strings use arena")
+{
+	// the empty string is interned when the pool is constructed
+	tmln::VectorData data("memory");
+	CHECK(data.strings().size() == 1);
+	CHECK(data.arena().size() == tmln::Arena::BLOCK_SIZE);
+}
+
+TEST_CASE("test Event copy outlives data")
+{
+	tmln::Styles styles;
+	tmln::StringPool pool;
+	tmln::Event* copy;
+	{
+		tmln::VectorData data("memory");
+		tmln::EventBuilder builder =
+			data.emplace_event(pool.intern("label"),
+					   pool.intern(""),
+					   tmln::Ts(1, 0), tmln::Ts(3, 0),
+					   styles.default_style());
+		builder.add_step(pool.intern("step"), pool.intern(""),
+				 tmln::Ts(1, 0), tmln::Ts(2, 0),
+				 styles.default_style());
+		copy = new tmln::Event(data[0]);
+	}
+	CHECK(copy->steps().size() == 1);
+	CHECK(copy->steps()[0].end() == tmln::Ts(2, 0));
+	copy->add_step(pool.intern("more"), pool.intern(""),
+		       tmln::Ts(2, 0), tmln::Ts(3, 0),
+		       styles.default_style());
+	CHECK(copy->steps().size() == 2);
+	delete copy;
+}
+
+TEST_CASE("test VectorData emplace_event")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	tmln::StringPool& strings = data.strings();
+	tmln::EventBuilder builder =
+		data.emplace_event(strings.intern("event"), strings.intern(""),
+				   tmln::Ts(1, 0), tmln::Ts(3, 0),
+				   styles.default_style());
+	CHECK(builder.valid() == true);
+	CHECK(builder.add_step(strings.intern("step"), strings.intern(""),
+			       tmln::Ts(1, 0), tmln::Ts(2, 0),
+			       styles.get_style("red")) == true);
+	CHECK(data.size() == 1);
+	CHECK(data[0].steps().size() == 1);
+	CHECK(data[0].steps()[0].label() == "step");
+	CHECK(data[0].steps().get_allocator().arena() == &data.arena());
+
+	tmln::Event event(strings.intern("moved"), strings.intern(""),
+			  tmln::Ts(2, 0), tmln::Ts(4, 0),
+			  styles.default_style(), &data.arena());
+	CHECK(data.add_event(std::move(event)) == true);
+	CHECK(data[1].label() == "moved");
+	CHECK(data.span() == tmln::TsSpan(tmln::Ts(1, 0), tmln::Ts(4, 0)));
+}
+
+TEST_CASE("test Event compare across pools")
+{
+	tmln::Styles styles;
+	tmln::StringPool pool, other_pool;
+	tmln::Event event(pool.intern("label"), pool.intern("info"),
+			  tmln::Ts(1, 0), tmln::Ts(2, 0),
+			  styles.default_style());
+	tmln::Event other(other_pool.intern("label"),
+			  other_pool.intern("info"),
+			  tmln::Ts(1, 0), tmln::Ts(2, 0),
+			  styles.default_style());
+	CHECK(event == other);
+	other.add_step(other_pool.intern("step"), other_pool.intern(""),
+		       tmln::Ts(1, 0), tmln::Ts(2, 0),
+		       styles.default_style());
+	CHECK(! (event == other));
+	event.add_step(pool.intern("step"), pool.intern(""),
+		       tmln::Ts(1, 0), tmln::Ts(2, 0),
+		       styles.default_style());
+	CHECK(event == other);
+}
+
+TEST_CASE("test VectorData finalize")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	tmln::StringPool& strings = data.strings();
+	const char* labels[] = {"c", "a", "d", "b"};
+	int starts[] = {30, 10, 40, 20};
+	for (int i = 0; i < 4; i++) {
+		data.emplace_event(strings.intern(labels[i]),
+				   strings.intern(""),
+				   tmln::Ts(starts[i], 0),
+				   tmln::Ts(starts[i] + 5, 0),
+				   styles.default_style());
+	}
+	CHECK(data.span() == tmln::TsSpan(tmln::Ts(10, 0), tmln::Ts(45, 0)));
+
+	data.finalize();
+	CHECK(data[0].label() == "a");
+	CHECK(data[1].label() == "b");
+	CHECK(data[2].label() == "c");
+	CHECK(data[3].label() == "d");
+	CHECK(data.interval_index().size() == 4);
+}
+
+// tmln_decompress
+
+#ifdef HAVE_ZLIB
+static std::string
+gzip(const std::string& str)
+{
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16,
+		     8, Z_DEFAULT_STRATEGY);
+	std::string out(deflateBound(&zs, str.size()), '\0');
+	zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(str.data()));
+	zs.avail_in = str.size();
+	zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+	zs.avail_out = out.size();
+	deflate(&zs, Z_FINISH);
+	out.resize(zs.total_out);
+	deflateEnd(&zs);
+	return out;
+}
+
+TEST_CASE("test DecompressInput gzip")
+{
+	std::string str;
+	for (int i = 0; str.size() < 6 * tmln::DecompressInput::BLOCK_SIZE;
+	     i++) {
+		str += std::to_string(i) + "\n";
+	}
+	// concatenated members
+	std::string gz = gzip(str) + gzip("end");
+	CHECK(tmln::DecompressInput::detect(gz.data(), gz.size())
+	      == tmln::DecompressInput::FORMAT_GZIP);
+	CHECK(tmln::DecompressInput::detect("[]", 2)
+	      == tmln::DecompressInput::FORMAT_NONE);
+
+	tmln::DecompressInput decompress(gz.data(), gz.size(),
+					 tmln::DecompressInput::FORMAT_GZIP);
+	const char* head;
+	size_t head_size;
+	REQUIRE(decompress.peek(head, head_size));
+	CHECK(std::string(head, 2) == "0\n");
+
+	std::istream is(&decompress);
+	std::string line;
+	std::getline(is, line);
+	CHECK(line == "0");
+	std::vector<char> buf;
+	CHECK(decompress.read_all(buf));
+	CHECK(std::string(buf.data(), buf.size()) == str.substr(2) + "end");
+}
+
+TEST_CASE("test DecompressInput truncated")
+{
+	std::string gz = gzip("[{\"label\": \"a\"}]");
+	gz.resize(gz.size() - 4);
+	tmln::DecompressInput decompress(gz.data(), gz.size(),
+					 tmln::DecompressInput::FORMAT_GZIP);
+	std::vector<char> buf;
+	CHECK(! decompress.read_all(buf));
+
+	// reader stopping early does not block the decompression thread
+	std::string str(8 * tmln::DecompressInput::BLOCK_SIZE, 'x');
+	gz = gzip(str);
+	tmln::DecompressInput partial(gz.data(), gz.size(),
+				      tmln::DecompressInput::FORMAT_GZIP);
+	const char* head;
+	size_t head_size;
+	REQUIRE(partial.peek(head, head_size));
+	CHECK(head[0] == 'x');
+}
+#endif // HAVE_ZLIB
+
+// tmln_file_input
+
+TEST_CASE("test FileInput regular file")
+{
+	const char* path = "test_file_input.json";
+	std::ofstream ofs(path);
+	ofs << "{\"events\": []}\n";
+	ofs.close();
+
+	tmln::FileInput input(path);
+	CHECK(input.is_open() == true);
+	CHECK(input.is_mapped() == true);
+	CHECK(std::string(input.data(), input.size()) == "{\"events\": []}\n");
+
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	tmln::LoadJson load(data, styles);
+	CHECK(load.load_file(path) == true);
+	std::remove(path);
+
+	CHECK(input.open("test_file_input.missing") == false);
+	CHECK(input.is_open() == false);
+	CHECK(input.size() == 0);
+}
+
+TEST_CASE("test FileInput pipe")
+{
+	int fds[2];
+	REQUIRE(pipe(fds) == 0);
+	std::string content(1000, 'x');
+	CHECK(write(fds[1], content.data(), content.size())
+	      == static_cast<ssize_t>(content.size()));
+	close(fds[1]);
+
+	tmln::FileInput input;
+	CHECK(input.open_fd(fds[0]) == true);
+	close(fds[0]);
+	CHECK(input.is_mapped() == false);
+	CHECK(std::string(input.data(), input.size()) == content);
+}
+
+// tmln_follow_file
+
+static size_t
+follow_file_wait_load(tmln::FollowFile& follow)
+{
+	size_t num_events = 0;
+	for (int i = 0; i < 500 && follow.loading(); i++) {
+		size_t num = follow.poll();
+		num_events += num;
+		if (num == 0) {
+			usleep(10000);
+		}
+	}
+	return num_events;
+}
+
+TEST_CASE("test FollowFile")
+{
+	const char* path = "test_follow_file.ndjson";
+	std::ofstream ofs(path);
+	ofs << "{\"label\": \"a\", \"start\": 1, \"end\": 2}\n"
+	    << "{\"label\": \"b\", \"start\": 3,";
+	ofs.flush();
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::FollowFile follow(data, styles);
+	REQUIRE(follow.open(path) == true);
+	CHECK(follow.loading() == true);
+	CHECK(follow_file_wait_load(follow) == 1);
+	REQUIRE(follow.loading() == false);
+	CHECK(data.size() == 1);
+	CHECK(follow.poll() == 0);
+
+	// rest of the incomplete line and an event starting earlier
+	ofs << " \"end\": 4}\n"
+	    << "{\"label\": \"c\", \"start\": 0, \"dur\": 10}\n"
+	    << "not json\n";
+	ofs.flush();
+	CHECK(follow.poll() == 2);
+	CHECK(follow.status() == false);
+	REQUIRE(data.size() == 3);
+	CHECK(data[1].label() == "b");
+	CHECK(data[1].end() == tmln::Ts(4, 0));
+	CHECK(data[2].label() == "c");
+	CHECK(data.span() == tmln::TsSpan(tmln::Ts(0, 0), tmln::Ts(10, 0)));
+
+	std::vector<size_t> result;
+	data.interval_index().query(tmln::TsSpan(tmln::Ts(0, 0),
+						 tmln::Ts(1, 500000000)),
+				    10, result);
+	CHECK(result == std::vector<size_t>({2, 0}));
+	std::remove(path);
+}
+
+TEST_CASE("test FollowFile poll max")
+{
+	const char* path = "test_follow_file_max.ndjson";
+	std::ofstream ofs(path);
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::FollowFile follow(data, styles);
+	REQUIRE(follow.open(path) == true);
+
+	std::string line("{\"label\": \"a\", \"start\": 1, \"end\": 2}\n");
+	size_t num_lines = tmln::FollowFile::POLL_MAX * 2 / line.size() + 1;
+	for (size_t i = 0; i < num_lines; i++) {
+		ofs << line;
+	}
+	ofs.flush();
+
+	size_t num_events = follow.poll();
+	CHECK(num_events > 0);
+	CHECK(num_events <= tmln::FollowFile::POLL_MAX / line.size());
+	for (int i = 0; i < 3; i++) {
+		num_events += follow.poll();
+	}
+	CHECK(num_events == num_lines);
+	CHECK(follow.status() == true);
+	std::remove(path);
+}
+
+TEST_CASE("test FollowFile truncate")
+{
+	const char* path = "test_follow_file_truncate.ndjson";
+	std::ofstream(path) << "{\"label\": \"a\", \"start\": 1, \"end\": 2}\n"
+			    << "{\"label\": \"b\", \"start\": 3, \"end\": 4}\n";
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::FollowFile follow(data, styles);
+	REQUIRE(follow.open(path) == true);
+	CHECK(follow_file_wait_load(follow) == 2);
+
+	// shorter than the read offset, read again from the start
+	std::ofstream(path) << "{\"label\": \"c\", \"start\": 5, \"end\": 6}\n";
+	CHECK(follow.poll() == 1);
+	REQUIRE(data.size() == 3);
+	CHECK(data[2].label() == "c");
+	CHECK(follow.status() == true);
+	std::remove(path);
+}
+
+TEST_CASE("test FollowFile rotate")
+{
+	const char* path = "test_follow_file_rotate.ndjson";
+	const char* path_old = "test_follow_file_rotate.ndjson.1";
+	std::ofstream ofs(path);
+	ofs << "{\"label\": \"a\", \"start\": 1, \"end\": 2}\n";
+	ofs.flush();
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::FollowFile follow(data, styles);
+	REQUIRE(follow.open(path) == true);
+	CHECK(follow_file_wait_load(follow) == 1);
+
+	// written to the old file after the rename, read before reopening
+	REQUIRE(std::rename(path, path_old) == 0);
+	ofs << "{\"label\": \"b\", \"start\": 3, \"end\": 4}\n";
+	ofs.close();
+	std::ofstream(path) << "{\"label\": \"c\", \"start\": 5, \"end\": 6}\n"
+			    << "{\"label\": \"d\", \"start\": 6, \"end\": 7}\n";
+	CHECK(follow.poll() == 1);
+	CHECK(follow.poll() == 2);
+	REQUIRE(data.size() == 4);
+	CHECK(data[1].label() == "b");
+	CHECK(data[3].label() == "d");
+	CHECK(follow.status() == true);
+	std::remove(path);
+	std::remove(path_old);
+}
+
+// tmln_interval_index
+
+static void
+add_test_event(tmln::Data& data, const tmln::Styles& styles,
+	       const tmln::Ts& start, const tmln::Ts& end)
+{
+	tmln::StringPool& strings = data.strings();
+	data.emplace_event(strings.intern(""), strings.intern(""), start, end,
+			   styles.default_style());
+}
+
+TEST_CASE("test IntervalIndex query")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	add_test_event(data, styles, tmln::Ts(0, 0), tmln::Ts(100, 0));
+	add_test_event(data, styles, tmln::Ts(1, 0), tmln::Ts(2, 0));
+	add_test_event(data, styles, tmln::Ts(5, 0), tmln::Ts(6, 0));
+	add_test_event(data, styles, tmln::Ts(10, 0), tmln::Ts(20, 0));
+
+	const tmln::IntervalIndex& index = data.interval_index();
+	CHECK(index.size() == 4);
+
+	std::vector<size_t> result;
+	index.query(tmln::TsSpan(tmln::Ts(3, 0), tmln::Ts(12, 0)), 10, result);
+	CHECK(result == std::vector<size_t>({0, 2, 3}));
+	index.query(tmln::TsSpan(tmln::Ts(3, 0), tmln::Ts(12, 0)), 2, result);
+	CHECK(result == std::vector<size_t>({0, 2}));
+	index.query(tmln::TsSpan(tmln::Ts(200, 0), tmln::Ts(300, 0)), 10,
+		    result);
+	CHECK(result.empty());
+}
+
+TEST_CASE("test IntervalIndex update")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	add_test_event(data, styles, tmln::Ts(5, 0), tmln::Ts(6, 0));
+	CHECK(data.interval_index().size() == 1);
+
+	std::vector<size_t> result;
+	add_test_event(data, styles, tmln::Ts(1, 0), tmln::Ts(2, 0));
+	data.interval_index().query(tmln::TsSpan(tmln::Ts(0, 0),
+						 tmln::Ts(10, 0)),
+				    10, result);
+	CHECK(result == std::vector<size_t>({1, 0}));
+}
+
+TEST_CASE("test IntervalIndex update merge")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	add_test_event(data, styles, tmln::Ts(1, 0), tmln::Ts(2, 0));
+	add_test_event(data, styles, tmln::Ts(3, 0), tmln::Ts(4, 0));
+	add_test_event(data, styles, tmln::Ts(5, 0), tmln::Ts(6, 0));
+	CHECK(data.interval_index().size() == 3);
+
+	// appended out of start order, merged after the first event
+	add_test_event(data, styles, tmln::Ts(7, 0), tmln::Ts(8, 0));
+	add_test_event(data, styles, tmln::Ts(2, 0), tmln::Ts(30, 0));
+	add_test_event(data, styles, tmln::Ts(5, 0), tmln::Ts(5, 500));
+
+	std::vector<size_t> result;
+	data.interval_index().query(tmln::TsSpan(tmln::Ts(0, 0),
+						 tmln::Ts(10, 0)),
+				    10, result);
+	CHECK(result == std::vector<size_t>({0, 4, 1, 2, 5, 3}));
+	data.interval_index().query(tmln::TsSpan(tmln::Ts(10, 0),
+						 tmln::Ts(11, 0)),
+				    10, result);
+	CHECK(result == std::vector<size_t>({4}));
+}
+
+TEST_CASE("test IntervalIndex matches scan")
+{
+	// one long event first, then short events appended partly out
+	// of order, queries must match a linear scan
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	add_test_event(data, styles, tmln::Ts(0, 0), tmln::Ts(1000, 0));
+	unsigned int seed = 1;
+	for (size_t round = 0; round < 3; round++) {
+		for (size_t i = 0; i < 300; i++) {
+			seed = seed * 1103515245 + 12345;
+			int64_t start = (seed >> 8) % 1000;
+			int64_t len = (seed >> 4) % 16;
+			if (round == 0) {
+				start = data.size();
+			}
+			add_test_event(data, styles, tmln::Ts(start, 0),
+				       tmln::Ts(start + len, 0));
+		}
+
+		for (int64_t start = 0; start < 1010; start += 7) {
+			tmln::TsSpan span(tmln::Ts(start, 0),
+					  tmln::Ts(start + 5, 0));
+			std::vector<size_t> result;
+			data.interval_index().query(span, data.size(), result);
+
+			std::vector<size_t> expected;
+			for (size_t i = 0; i < data.size(); i++) {
+				if (span.overlaps(data[i].span())) {
+					expected.push_back(i);
+				}
+			}
+			std::stable_sort(expected.begin(), expected.end(),
+					 [&data](size_t lhs, size_t rhs) {
+						 return data[lhs].start()
+							 < data[rhs].start();
+					 });
+			CHECK(result == expected);
+		}
+	}
+}
+
+// tmln_live_input
+
+static size_t
+live_poll(tmln::LiveInput& live, tmln::Data& data, size_t size)
+{
+	for (int i = 0; i < 200 && data.size() < size; i++) {
+		if (live.poll() == 0) {
+			usleep(10000);
+		}
+	}
+	return data.size();
+}
+
+TEST_CASE("test LiveInput pipe")
+{
+	int fds[2];
+	REQUIRE(pipe(fds) == 0);
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("-");
+	data.finalize();
+	tmln::LiveInput live(data, styles);
+	REQUIRE(live.open_fd(fds[0]) == true);
+	REQUIRE(live.start() == true);
+	CHECK(live.open_fd(fds[0]) == false);
+
+	std::string lines("{\"label\": \"a\", \"start\": 1, \"end\": 2,"
+			  " \"style\": \"s\"}\n{\"label\": \"b\", ");
+	CHECK(write(fds[1], lines.data(), lines.size())
+	      == static_cast<ssize_t>(lines.size()));
+	CHECK(live_poll(live, data, 1) == 1);
+	CHECK(data[0].label() == "a");
+
+	lines = "\"start\": 3, \"end\": 4}\ninvalid\n"
+		"{\"type\": \"style\", \"name\": \"s\", "
+		"\"fg\": \"#112233\"}\n"
+		"{\"label\": \"c\", \"start\": 2, \"end\": 5}";
+	CHECK(write(fds[1], lines.data(), lines.size())
+	      == static_cast<ssize_t>(lines.size()));
+	close(fds[1]);
+	CHECK(live_poll(live, data, 3) == 3);
+	CHECK(data[1].label() == "b");
+	CHECK(data[2].label() == "c");
+	CHECK(data[0].style().fg() == tmln::Color(255, 17, 34, 51));
+	CHECK(live.status() == false);
+	std::vector<size_t> result;
+	data.interval_index().query(tmln::TsSpan(tmln::Ts(3, 0),
+						 tmln::Ts(3, 500000000)),
+				    10, result);
+	CHECK(result == std::vector<size_t>({2, 1}));
+}
+
+TEST_CASE("test LiveInput poll limit")
+{
+	int fds[2];
+	REQUIRE(pipe(fds) == 0);
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("-");
+	data.finalize();
+	tmln::LiveInput live(data, styles);
+	REQUIRE(live.open_fd(fds[0]) == true);
+	REQUIRE(live.start() == true);
+
+	const size_t num_events = tmln::LiveInput::POLL_MAX + 100;
+	bool written = true;
+	std::thread writer([&fds, &written, num_events]() {
+		for (size_t i = 0; i < num_events; i++) {
+			std::string line = "{\"label\": \"e\", \"start\": "
+				+ std::to_string(i) + ", \"end\": "
+				+ std::to_string(i + 1) + "}\n";
+			written = write(fds[1], line.data(), line.size())
+				== static_cast<ssize_t>(line.size())
+				&& written;
+		}
+		close(fds[1]);
+	});
+	writer.join();
+	CHECK(written == true);
+
+	size_t max_poll = 0;
+	for (int i = 0; i < 200 && data.size() < num_events; i++) {
+		size_t num = live.poll();
+		max_poll = std::max(max_poll, num);
+		if (num == 0) {
+			usleep(10000);
+		}
+	}
+	CHECK(data.size() == num_events);
+	CHECK(max_poll <= tmln::LiveInput::POLL_MAX);
+	CHECK(data[num_events - 1].start() == tmln::Ts(num_events - 1, 0));
+}
+
+TEST_CASE("test LiveInput socket")
+{
+	const char* path = "test_live_input.sock";
+	tmln::Styles styles;
+	tmln::ColumnarData data(path);
+	data.finalize();
+	tmln::LiveInput live(data, styles);
+	REQUIRE(live.listen(path) == true);
+	REQUIRE(live.start() == true);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	for (int i = 0; i < 2; i++) {
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		REQUIRE(fd != -1);
+		REQUIRE(connect(fd, reinterpret_cast<struct sockaddr*>(&addr),
+				sizeof(addr)) == 0);
+		std::string line = "{\"label\": \"e" + std::to_string(i)
+			+ "\", \"start\": 1, \"end\": 2}\n";
+		CHECK(write(fd, line.data(), line.size())
+		      == static_cast<ssize_t>(line.size()));
+		close(fd);
+		CHECK(live_poll(live, data, i + 1) == i + 1u);
+	}
+	CHECK(live.status() == true);
+
+	live.close();
+	CHECK(access(path, F_OK) == -1);
+}
+
+// tmln_selection
+
+TEST_CASE("test NumTimeSelection")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	add_test_event(data, styles, tmln::Ts(0, 0), tmln::Ts(100, 0));
+	add_test_event(data, styles, tmln::Ts(1, 0), tmln::Ts(2, 0));
+	add_test_event(data, styles, tmln::Ts(50, 0), tmln::Ts(60, 0));
+
+	tmln::NumTimeSelection sel(data, 10,
+				   tmln::TsSpan(tmln::Ts(40, 0),
+						tmln::Ts(70, 0)));
+	CHECK(sel.size() == 2);
+	CHECK(sel.begin() == 0);
+	CHECK(sel.end() == 2);
+	CHECK(sel.event_span(0).start() == tmln::Ts(0, 0));
+	CHECK(&sel[1] == &data[2]);
+
+	sel.set_selection(10, tmln::TsSpan(tmln::Ts(1, 0), tmln::Ts(3, 0)));
+	CHECK(sel.size() == 2);
+	CHECK(&sel[1] == &data[1]);
+}
+
+TEST_CASE("test NumOffsetSelection update")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	add_test_event(data, styles, tmln::Ts(0, 0), tmln::Ts(1, 0));
+	add_test_event(data, styles, tmln::Ts(1, 0), tmln::Ts(2, 0));
+
+	tmln::NumOffsetSelection sel(data, 3, 1);
+	CHECK(sel.begin() == 1);
+	CHECK(sel.size() == 1);
+
+	add_test_event(data, styles, tmln::Ts(2, 0), tmln::Ts(3, 0));
+	add_test_event(data, styles, tmln::Ts(3, 0), tmln::Ts(4, 0));
+	sel.update();
+	CHECK(sel.begin() == 1);
+	CHECK(sel.end() == 4);
+	CHECK(sel.span().end() == tmln::Ts(4, 0));
+}
+
+// tmln_json_reader
+
+TEST_CASE("test JsonReader tokens")
+{
+	std::string json("{\"a\": [1, -2.5e3, true, false, null],"
+			 " \"b\": {\"c\": \"x\\\"\\u00e5\\ud83d\\ude00\"}}");
+	tmln::JsonReader reader(json.data(), json.size());
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_OBJECT_BEGIN);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_KEY);
+	CHECK(reader.value() == "a");
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_ARRAY_BEGIN);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_NUMBER);
+	CHECK(reader.value() == "1");
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_NUMBER);
+	CHECK(reader.value() == "-2.5e3");
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_TRUE);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_FALSE);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_NULL);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_ARRAY_END);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_KEY);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_OBJECT_BEGIN);
+	CHECK(reader.depth() == 2);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_KEY);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_STRING);
+	CHECK(reader.value() == "x\"\xc3\xa5\xf0\x9f\x98\x80");
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_OBJECT_END);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_OBJECT_END);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_END);
+}
+
+TEST_CASE("test JsonReader stream and skip")
+{
+	// larger than the stream buffer to test refills
+	std::string json("[{\"skip\": [");
+	while (json.size() < tmln::JsonReader::BUF_SIZE * 2) {
+		json += "{\"k\": \"value\"}, ";
+	}
+	json += "{}]}, \"last\"]";
+	std::istringstream is(json);
+	tmln::JsonReader reader(is);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_ARRAY_BEGIN);
+	CHECK(reader.skip(reader.next()) == true);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_STRING);
+	CHECK(reader.value() == "last");
+	CHECK(reader.offset() == json.size() - 1);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_ARRAY_END);
+	CHECK(reader.next() == tmln::JsonReader::TOKEN_END);
+	CHECK(reader.offset() == json.size());
+
+	tmln::JsonReader buffer_reader(json.data(), json.size());
+	CHECK(buffer_reader.offset() == 0);
+	CHECK(buffer_reader.next() == tmln::JsonReader::TOKEN_ARRAY_BEGIN);
+	CHECK(buffer_reader.offset() == 1);
+}
+
+TEST_CASE("test JsonReader errors")
+{
+	const char* invalid[] = {"", "{", "[1,]", "{\"a\" 1}", "[1] 2",
+				 "[tru]", "\"\\x\"", "{]", nullptr};
+	for (const char** json = invalid; *json; json++) {
+		tmln::JsonReader reader(*json, strlen(*json));
+		tmln::JsonReader::Token token;
+		do {
+			token = reader.next();
+		} while (token != tmln::JsonReader::TOKEN_END
+			 && token != tmln::JsonReader::TOKEN_ERROR);
+		CHECK(token == tmln::JsonReader::TOKEN_ERROR);
+	}
+}
+
+// tmln_line_reader
+
+TEST_CASE("test LineReader")
+{
+	std::istringstream is("ab\nc\nlong line\n\"x\ny\"\nend");
+	tmln::LineReader reader(is, 4);
+	const char* data;
+	size_t size;
+	REQUIRE(reader.next(data, size));
+	CHECK(std::string(data, size) == "ab\n");
+	REQUIRE(reader.next(data, size));
+	CHECK(std::string(data, size) == "c\n");
+	REQUIRE(reader.next(data, size));
+	CHECK(std::string(data, size) == "long line\n");
+	REQUIRE(reader.next(data, size));
+	CHECK(std::string(data, size) == "\"x\n");
+	REQUIRE(reader.next(data, size));
+	CHECK(std::string(data, size) == "y\"\n");
+	REQUIRE(reader.next(data, size));
+	CHECK(std::string(data, size) == "end");
+	CHECK(! reader.next(data, size));
+
+	std::istringstream quoted("a,\"x\ny\"\nb\n");
+	tmln::LineReader quoted_reader(quoted, 4, true);
+	REQUIRE(quoted_reader.next(data, size));
+	CHECK(std::string(data, size) == "a,\"x\ny\"\n");
+	REQUIRE(quoted_reader.next(data, size));
+	CHECK(std::string(data, size) == "b\n");
+	CHECK(! quoted_reader.next(data, size));
+}
+
+// tmln_load_async
+
+static size_t
+load_async_poll(tmln::LoadAsync& load, tmln::Data& data, size_t size)
+{
+	for (int i = 0; i < 500 && ! load.done() && data.size() < size; i++) {
+		if (load.poll() == 0) {
+			usleep(10000);
+		}
+	}
+	return data.size();
+}
+
+TEST_CASE("test LoadAsync")
+{
+	const size_t num_events = tmln::LoadAsync::BATCH_MIN * 4;
+	std::atomic<bool> resume(false);
+	auto load_fun = [&resume, num_events](tmln::Data& data,
+					      tmln::Styles& styles) {
+		tmln::StringPool& strings = data.strings();
+		const tmln::Style& style = styles.ref_style("s");
+		for (size_t i = 0; i < num_events; i++) {
+			if (i == num_events / 2) {
+				while (! resume) {
+					usleep(1000);
+				}
+				styles.add_style(tmln::Style(
+					"s", tmln::Color("#112233"),
+					tmln::Color("#445566")));
+			}
+			int64_t sec = num_events - i;
+			tmln::EventBuilder event = data.emplace_event(
+				strings.intern("e" + std::to_string(sec)),
+				strings.intern(""), tmln::Ts(sec, 0),
+				tmln::Ts(sec + 1, 0), style);
+			event.add_step(strings.intern("x"), strings.intern(""),
+				       tmln::Ts(sec, 0), tmln::Ts(sec + 1, 0),
+				       style);
+		}
+		data.finalize();
+		return true;
+	};
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("async");
+	tmln::LoadAsync load(data, styles);
+	REQUIRE(load.start(load_fun) == true);
+	CHECK(load.start(load_fun) == false);
+
+	// the prefix loaded before the load function blocks is available
+	CHECK(load_async_poll(load, data, tmln::LoadAsync::BATCH_MIN)
+	      >= tmln::LoadAsync::BATCH_MIN);
+	CHECK(load.done() == false);
+	CHECK(data[0].label() == "e" + std::to_string(num_events));
+
+	resume = true;
+	load_async_poll(load, data, num_events + 1);
+	REQUIRE(load.done() == true);
+	CHECK(load.status() == true);
+	CHECK(load.cancelled() == false);
+	CHECK(load.num_loaded() == num_events);
+	REQUIRE(data.size() == num_events);
+	CHECK(data[0].label() == "e1");
+	CHECK(data[0].steps().size() == 1);
+	CHECK(data[0].style().fg() == tmln::Color(255, 17, 34, 51));
+	CHECK(load.poll() == 0);
+}
+
+TEST_CASE("test LoadAsync raw steps")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("async", tmln::ColumnarData::STEP_COMPACT,
+				&styles);
+	tmln::LoadAsync load(data, styles);
+	REQUIRE(load.start([](tmln::Data& data, tmln::Styles& styles) {
+		tmln::LoadJson load(data, styles, 1);
+		return load.load_ndjson(
+			"{\"label\": \"a\", \"start\": 1, \"end\": 3, "
+			"\"steps\": [{\"label\": \"x\", \"start\": 1, "
+			"\"end\": 2, \"style\": \"s\"}]}\n"
+			"{\"type\": \"style\", \"name\": \"s\", "
+			"\"fg\": \"#112233\"}\n");
+	}) == true);
+	load_async_poll(load, data, 2);
+	REQUIRE(load.done() == true);
+	REQUIRE(data.size() == 1);
+	CHECK(data.num_steps() == 0);
+	REQUIRE(data[0].steps().size() == 1);
+	CHECK(data[0].steps()[0].label() == "x");
+	CHECK(data[0].steps()[0].style().fg() == tmln::Color(255, 17, 34, 51));
+}
+
+TEST_CASE("test LoadAsync cancel")
+{
+	std::atomic<bool> returned(false);
+	auto load_fun = [&returned](tmln::Data& data, tmln::Styles& styles) {
+		tmln::StringPool& strings = data.strings();
+		for (int64_t i = 0; ! data.cancelled(); i++) {
+			data.emplace_event(strings.intern("e"),
+					   strings.intern(""),
+					   tmln::Ts(i, 0), tmln::Ts(i + 1, 0),
+					   styles.default_style());
+		}
+		returned = true;
+		return false;
+	};
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("async");
+	tmln::LoadAsync load(data, styles);
+	REQUIRE(load.start(load_fun) == true);
+	load_async_poll(load, data, 1);
+	load.cancel();
+	CHECK(load.done() == true);
+	CHECK(load.cancelled() == true);
+	CHECK(returned == true);
+	size_t size = data.size();
+	CHECK(size > 0);
+	CHECK(load.poll() == 0);
+	CHECK(data.size() == size);
+}
+
+TEST_CASE("test LoadAsync poll limit and progress")
+{
+	const size_t num_events = tmln::LoadAsync::POLL_MAX * 2;
+	std::string ndjson;
+	for (size_t i = 0; i < num_events; i++) {
+		ndjson += "{\"label\": \"e\", \"start\": "
+			+ std::to_string(i) + ", \"end\": "
+			+ std::to_string(i + 1) + "}\n";
+	}
+	auto load_fun = [&ndjson](tmln::Data& data, tmln::Styles& styles) {
+		tmln::LoadJson load(data, styles, 1);
+		return load.load_ndjson(ndjson);
+	};
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("async");
+	tmln::LoadAsync load(data, styles);
+	REQUIRE(load.start(load_fun) == true);
+	size_t max_poll = 0;
+	for (int i = 0; i < 500 && ! load.done(); i++) {
+		size_t num = load.poll();
+		max_poll = std::max(max_poll, num);
+		if (num == 0) {
+			usleep(10000);
+		}
+	}
+	REQUIRE(load.done() == true);
+	CHECK(max_poll <= tmln::LoadAsync::POLL_MAX);
+	CHECK(data.size() == num_events);
+	CHECK(data[num_events - 1].label() == "e");
+	CHECK(load.num_bytes() == ndjson.size());
+}
+
+// tmln_load_chrome
+
+TEST_CASE("test LoadChrome")
+{
+	std::string json("{\"traceEvents\": ["
+		"{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+		" \"tid\": 2, \"args\": {\"name\": \"worker\"}},"
+		"{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+		" \"args\": {\"name\": \"app\"}},"
+		"{\"name\": \"outer\", \"cat\": \"c\", \"ph\": \"B\", "
+		" \"ts\": 1000, \"pid\": 1, \"tid\": 2},"
+		"{\"name\": \"inner\", \"ph\": \"X\", \"ts\": 1500.5, "
+		" \"dur\": 100, \"pid\": 1, \"tid\": 2, \"args\": {\"x\": [1]}},"
+		"{\"ph\": \"E\", \"ts\": 3000, \"pid\": 1, \"tid\": 2},"
+		"{\"name\": \"other\", \"ph\": \"B\", \"ts\": 500, "
+		" \"pid\": 1, \"tid\": \"3\"},"
+		"{\"name\": \"counter\", \"ph\": \"C\", \"ts\": 4000, "
+		" \"pid\": 1, \"tid\": 3}"
+		"], \"displayTimeUnit\": \"ms\"}");
+	CHECK(tmln::LoadChrome::is_chrome_trace(json.data(), json.size()));
+	std::string array(" [{\"name\": \"a\", \"ph\": \"X\"}]");
+	CHECK(tmln::LoadChrome::is_chrome_trace(array.data(), array.size()));
+	CHECK(! tmln::LoadChrome::is_chrome_trace(" [", 2));
+	CHECK(! tmln::LoadChrome::is_chrome_trace("[{\"name\": 1}]", 13));
+	CHECK(! tmln::LoadChrome::is_chrome_trace("{\"events\": []}", 14));
+	std::string label("{\"events\": [{\"label\": \"traceEvents\"}]}");
+	CHECK(! tmln::LoadChrome::is_chrome_trace(label.data(), label.size()));
+
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::LoadChrome load(data, styles);
+	CHECK(load.load(json) == true);
+	REQUIRE(data.size() == 2);
+
+	// unmatched B ends at the last timestamp
+	CHECK(data[0].label() == "1/3");
+	CHECK(data[0].info() == "app");
+	CHECK(data[0].start() == tmln::Ts(0, 500000));
+	CHECK(data[0].end() == tmln::Ts(0, 3000000));
+
+	const tmln::Event& worker = data[1];
+	CHECK(worker.label() == "worker");
+	REQUIRE(worker.steps().size() == 2);
+	CHECK(worker.steps()[0].label() == "outer");
+	CHECK(worker.steps()[0].info() == "c");
+	CHECK(worker.steps()[0].start() == tmln::Ts(0, 1000000));
+	CHECK(worker.steps()[0].end() == tmln::Ts(0, 3000000));
+	CHECK(worker.steps()[1].label() == "inner");
+	CHECK(worker.steps()[1].start() == tmln::Ts(0, 1500500));
+	CHECK(worker.steps()[1].end() == tmln::Ts(0, 1600500));
+}
+
+TEST_CASE("test LoadChrome array")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	tmln::LoadChrome load(data, styles);
+	CHECK(load.load("[{\"name\": \"a\", \"ph\": \"X\", \"ts\": 1, "
+			"\"dur\": 1, \"pid\": 1, \"tid\": 1}]") == true);
+	CHECK(data.size() == 1);
+	CHECK(load.load("[{\"name\": \"a\"") == false);
+}
+
+// tmln_load_csv
+
+TEST_CASE("test LoadCsv")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::LoadCsv load(data, styles);
+	load.set_column(tmln::LoadCsv::COLUMN_INFO, "info");
+	CHECK(load.load("start,label,end,info\r\n"
+			"1.5,plain,2,x\r\n"
+			"\n"
+			"3,\"a, \"\"quoted\"\"\nlabel\",4,\r\n"
+			"2,incomplete\n"
+			"1970-01-01T00:00:05Z,iso,6,y") == true);
+	REQUIRE(data.size() == 3);
+	CHECK(data[0].label() == "plain");
+	CHECK(data[0].info() == "x");
+	CHECK(data[0].start() == tmln::Ts(1, 500000000));
+	CHECK(data[0].end() == tmln::Ts(2, 0));
+	CHECK(data[1].label() == "a, \"quoted\"\nlabel");
+	CHECK(data[1].info() == "");
+	CHECK(data[2].label() == "iso");
+	CHECK(data[2].start() == tmln::Ts(5, 0));
+
+	CHECK(load.load("label,start,end\n\"open,1,2\n") == false);
+}
+
+// data counting bytes reported by loaders
+class ProgressData : public tmln::ColumnarData {
+public:
+	ProgressData()
+		: tmln::ColumnarData("memory"),
+		  bytes(0)
+	{
+	}
+
+	virtual void add_progress(size_t num) override
+	{
+		bytes += num;
+	}
+
+	std::atomic<size_t> bytes;
+};
+
+TEST_CASE("test LoadCsv progress")
+{
+	// rows are reported as parsed, the header is not
+	std::string header("start,label,end\n");
+	std::string rows("1,a,2\n3,\"b\nb\",4\n5,c,6");
+	tmln::Styles styles;
+	ProgressData data;
+	tmln::LoadCsv load(data, styles);
+	CHECK(load.load(header + rows) == true);
+	CHECK(data.size() == 3);
+	CHECK(data.bytes == rows.size());
+}
+
+TEST_CASE("test LoadCsv grouped")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("memory");
+	tmln::LoadCsv load(data, styles);
+	load.set_header(false);
+	load.set_unit(1000000);
+	load.set_column(tmln::LoadCsv::COLUMN_EVENT_ID, "0");
+	load.set_column(tmln::LoadCsv::COLUMN_LABEL, "1");
+	load.set_column(tmln::LoadCsv::COLUMN_STEP_LABEL, "2");
+	load.set_column(tmln::LoadCsv::COLUMN_START, "3");
+	load.set_column(tmln::LoadCsv::COLUMN_END, "4");
+	load.set_column(tmln::LoadCsv::COLUMN_STYLE, "5");
+	CHECK(load.load("1\tjob\tlink\t300\t400\tred\n"
+			"2\tother\trun\t50\t60\t\n"
+			"1\tignored\tcompile\t100\t200\tblue\n") == true);
+	REQUIRE(data.size() == 2);
+	CHECK(data[0].label() == "other");
+	CHECK(data[0].steps().size() == 1);
+
+	const tmln::Event& job = data[1];
+	CHECK(job.label() == "job");
+	CHECK(job.start() == tmln::Ts(0, 100000000));
+	CHECK(job.end() == tmln::Ts(0, 400000000));
+	CHECK(job.style().name() == "red");
+	REQUIRE(job.steps().size() == 2);
+	CHECK(job.steps()[0].label() == "compile");
+	CHECK(job.steps()[0].style().name() == "blue");
+	CHECK(job.steps()[1].label() == "link");
+}
+
+TEST_CASE("test LoadCsv parallel")
+{
+	std::string csv("label,start,end,style\n");
+	for (int i = 0; i < 100000; i++) {
+		std::string num = std::to_string(i);
+		csv += "\"event\n" + num + "\"," + num + "," + num + ".5,s"
+			+ std::to_string(i % 7) + "\n";
+	}
+	REQUIRE(csv.size() >= tmln::LoadCsv::PARALLEL_MIN);
+
+	tmln::Styles seq_styles, par_styles;
+	tmln::ColumnarData seq("memory"), par("memory");
+	tmln::LoadCsv seq_load(seq, seq_styles, 1);
+	tmln::LoadCsv par_load(par, par_styles, 3);
+	CHECK(seq_load.load(csv) == true);
+	CHECK(par_load.load(csv) == true);
+	REQUIRE(seq.size() == 100000);
+	REQUIRE(par.size() == seq.size());
+	for (size_t i = 0; i < seq.size(); i += 997) {
+		CHECK(par[i].label() == seq[i].label());
+		CHECK(par[i].end() == seq[i].end());
+		CHECK(par[i].style().name() == seq[i].style().name());
+	}
+}
+
+TEST_CASE("test LoadCsv stream")
+{
+	// quoted newlines across READ_SIZE blocks
+	std::string csv("label,start,end\n");
+	for (int i = 0; csv.size() < tmln::LoadCsv::READ_SIZE * 2; i++) {
+		std::string num = std::to_string(i);
+		csv += "\"event\n" + num + "\"," + num + "," + num + ".5\n";
+	}
+
+	tmln::Styles styles, stream_styles;
+	tmln::ColumnarData data("memory"), stream_data("memory");
+	tmln::LoadCsv load(data, styles);
+	tmln::LoadCsv stream_load(stream_data, stream_styles);
+	std::istringstream is(csv);
+	CHECK(load.load(csv) == true);
+	CHECK(stream_load.load(is) == true);
+	REQUIRE(stream_data.size() == data.size());
+	for (size_t i = 0; i < data.size(); i += 9973) {
+		CHECK(stream_data[i].label() == data[i].label());
+		CHECK(stream_data[i].end() == data[i].end());
+	}
+
+	tmln::ColumnarData grouped("memory");
+	tmln::LoadCsv grouped_load(grouped, styles);
+	grouped_load.set_column(tmln::LoadCsv::COLUMN_EVENT_ID, "id");
+	std::istringstream grouped_is("id,label,start,end\n"
+				      "1,a,3,4\n2,b,1,2\n1,c,1,2\n");
+	CHECK(grouped_load.load(grouped_is) == true);
+	REQUIRE(grouped.size() == 2);
+	CHECK(grouped[0].label() == "a");
+	CHECK(grouped[0].steps().size() == 2);
+}
+
+// tmln_load_files
+
+static bool
+load_files_json(const std::string& path, tmln::Data& data,
+		tmln::Styles& styles)
+{
+	tmln::LoadJson load(data, styles, 1);
+	if (path == "a") {
+		return load.load("{\"events\": ["
+				 "{\"label\": \"a1\", \"start\": 1, \"end\": 2,"
+				 " \"style\": \"s\"},"
+				 "{\"label\": \"a3\", \"start\": 3, \"end\": 4}],"
+				 " \"styles\": [{\"name\": \"s\","
+				 " \"fg\": \"#112233\"}]}");
+	} else if (path == "b") {
+		return load.load("{\"events\": ["
+				 "{\"label\": \"b4\", \"start\": 4, \"end\": 5},"
+				 "{\"label\": \"b0\", \"start\": 0, \"end\": 9,"
+				 " \"steps\": [{\"label\": \"x\", \"start\": 0,"
+				 " \"end\": 1, \"style\": \"t\"}]}]}");
+	}
+	return load.load("{\"events\": [{\"label\": \"c2\", \"start\": 2,"
+			 " \"end\": 3}, invalid");
+}
+
+TEST_CASE("test LoadFiles merge")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("merged");
+	tmln::LoadFiles load(data, styles, load_files_json, 2);
+	CHECK(load.load({"a", "b", "c"}) == false);
+	REQUIRE(load.failed().size() == 1);
+	CHECK(load.failed()[0] == "c");
+
+	REQUIRE(data.sources().size() == 4);
+	CHECK(data.sources()[2] == "b");
+	const char* labels[] = {"b0", "a1", "c2", "a3", "b4"};
+	size_t sources[] = {2, 1, 3, 1, 2};
+	REQUIRE(data.size() == 5);
+	for (size_t i = 0; i < data.size(); i++) {
+		CHECK(data[i].label() == labels[i]);
+		CHECK(data.event_source(i) == sources[i]);
+	}
+
+	CHECK(&data[1].style() == &styles.ref_style("s"));
+	CHECK(data[1].style().fg() == tmln::Color(255, 17, 34, 51));
+	CHECK(&data[2].style() == &styles.default_style());
+	REQUIRE(data[0].steps().size() == 1);
+	CHECK(data[0].steps()[0].style().name() == "t");
+}
+
+// data rejecting all steps
+class RejectStepsData : public tmln::VectorData {
+public:
+	RejectStepsData()
+		: tmln::VectorData("merged")
+	{
+	}
+
+	virtual bool emplace_step(size_t, tmln::StrRef, tmln::StrRef,
+				  const tmln::Ts&, const tmln::Ts&,
+				  const tmln::Style&) override
+	{
+		return false;
+	}
+};
+
+TEST_CASE("test LoadFiles merge rejected")
+{
+	tmln::Styles styles;
+	RejectStepsData data;
+	tmln::LoadFiles load(data, styles, load_files_json, 1);
+	CHECK(load.load({"a", "b"}) == false);
+	REQUIRE(load.failed().size() == 1);
+	CHECK(load.failed()[0] == "b");
+	REQUIRE(data.size() == 4);
+	CHECK(data[0].label() == "b0");
+	CHECK(data[0].steps().size() == 0);
+}
+
+static bool
+load_files_hosts(const std::string& path, tmln::Data& data,
+		 tmln::Styles& styles)
+{
+	// host b runs 2 s ahead of host a, host c 1 s behind
+	tmln::LoadJson load(data, styles, 1);
+	if (path == "a") {
+		return load.load("{\"events\": ["
+				 "{\"label\": \"sync\", \"start\": 10, \"end\": 10},"
+				 "{\"label\": \"a\", \"start\": 11, \"end\": 12},"
+				 "{\"label\": \"sync\", \"start\": 20, \"end\": 20}]}");
+	} else if (path == "b") {
+		return load.load("{\"events\": ["
+				 "{\"label\": \"sync\", \"start\": 12, \"end\": 12},"
+				 "{\"label\": \"b\", \"start\": 12.5, \"end\": 14,"
+				 " \"steps\": [{\"label\": \"x\", \"start\": 13,"
+				 " \"end\": 14}]},"
+				 "{\"label\": \"sync\", \"start\": 22, \"end\": 22}]}");
+	}
+	return load.load("{\"events\": ["
+			 "{\"label\": \"sync\", \"start\": 9, \"end\": 9},"
+			 "{\"label\": \"c\", \"start\": 10.25, \"end\": 11}]}");
+}
+
+TEST_CASE("test LoadFiles offsets")
+{
+	tmln::Styles styles;
+	tmln::ColumnarData data("merged");
+	tmln::LoadFiles load(data, styles, load_files_hosts, 3);
+	load.set_offset("c", tmln::Ts(0, 500000000));
+	load.set_align_marker("sync");
+	CHECK(load.load({"a", "b", "c"}) == true);
+
+	REQUIRE(load.offsets().size() == 3);
+	CHECK(load.offsets()[0] == tmln::Ts(0, 0));
+	CHECK(load.offsets()[1] == tmln::Ts(-2, 0));
+	CHECK(load.offsets()[2] == tmln::Ts(0, 500000000));
+
+	const char* labels[] = {"sync", "sync", "sync", "b", "c", "a",
+				"sync", "sync"};
+	REQUIRE(data.size() == 8);
+	for (size_t i = 0; i < data.size(); i++) {
+		CHECK(data[i].label() == labels[i]);
+	}
+	CHECK(data[0].start() == tmln::Ts(9, 500000000));
+	CHECK(data[3].start() == tmln::Ts(10, 500000000));
+	REQUIRE(data[3].steps().size() == 1);
+	CHECK(data[3].steps()[0].start() == tmln::Ts(11, 0));
+	CHECK(data.span().end() == tmln::Ts(20, 0));
+}
+
 // tmln_load_json
 
 class LoadTest {
@@ -67,8 +1724,9 @@ TEST_CASE("test LoadJson load event")
 			 \"end\": \"1970-01-01T00:01:02.003\"}]}");
 	CHECK(test.status == true);
 	CHECK(test.data.size() == 1);
+	tmln::StringPool& strings = test.data.strings();
 	CHECK(test.data[0] ==
-	      tmln::Event("label", "info",
+	      tmln::Event(strings.intern("label"), strings.intern("info"),
 			  tmln::Ts(1, 0), tmln::Ts(62, 3000000),
 			  test.styles.default_style()));
 }
@@ -108,6 +1766,78 @@ TEST_CASE("test LoadJson load style")
 	CHECK(style.bg() == tmln::Color(255, 0, 0, 255));
 }
 
+TEST_CASE("test LoadJson styles after events")
+{
+	LoadTest test("{\"events\": \
+		       [{\"steps\": [{\"label\": \"step\", \
+				      \"start\": \"1970-01-01T00:00:01\", \
+				      \"end\": \"1970-01-01T00:00:02\", \
+				      \"style\": \"late\"}], \
+		         \"label\": \"label\", \
+			 \"unknown\": {\"nested\": [1, 2]}, \
+			 \"start\": \"1970-01-01T00:00:01\", \
+			 \"end\": \"1970-01-01T00:00:03\", \
+			 \"style\": \"late\"}, \
+			{\"label\": 1, \
+			 \"start\": \"1970-01-01T00:00:01\", \
+			 \"end\": \"1970-01-01T00:00:03\"}], \
+			\"styles\": \
+			[{\"name\": \"late\", \
+			  \"fg\": \"#112233\"}]}");
+	CHECK(test.status == true);
+	CHECK(test.data.size() == 1);
+	CHECK(test.data[0].steps().size() == 1);
+	CHECK(test.data[0].style().name() == "late");
+	CHECK(test.data[0].style().fg() == tmln::Color(255, 17, 34, 51));
+	CHECK(&test.data[0].steps()[0].style() == &test.data[0].style());
+	CHECK(test.styles.has_style("late") == true);
+}
+
+TEST_CASE("test LoadJson numeric timestamps")
+{
+	LoadTest test("{\"unit\": \"ms\", \
+			\"base\": \"1970-01-01T00:01:00\", \
+			\"events\": \
+		       [{\"label\": \"end\", \"start\": 1500, \"end\": 2000, \
+			 \"steps\": [{\"label\": \"step\", \"start\": 1500, \
+				      \"dur\": 0.25}]}, \
+			{\"label\": \"dur\", \"start\": \"1970-01-01T00:00:10\", \
+			 \"dur\": 100}, \
+			{\"label\": \"no end\", \"start\": 1}]}");
+	CHECK(test.status == true);
+	REQUIRE(test.data.size() == 2);
+	CHECK(test.data[0].label() == "dur");
+	CHECK(test.data[0].start() == tmln::Ts(10, 0));
+	CHECK(test.data[0].end() == tmln::Ts(10, 100000000));
+	CHECK(test.data[1].start() == tmln::Ts(61, 500000000));
+	CHECK(test.data[1].end() == tmln::Ts(62, 0));
+	REQUIRE(test.data[1].steps().size() == 1);
+	CHECK(test.data[1].steps()[0].end() == tmln::Ts(61, 500250000));
+}
+
+TEST_CASE("test LoadJson numeric units")
+{
+	LoadTest test("{\"unit\": \"us\", \"base\": -5, \"events\": \
+		       [{\"label\": \"us\", \"start\": 1000005, \
+			 \"end\": 2e6}]}");
+	CHECK(test.status == true);
+	REQUIRE(test.data.size() == 1);
+	CHECK(test.data[0].start() == tmln::Ts(1, 0));
+	CHECK(test.data[0].end() == tmln::Ts(1, 999995000));
+
+	LoadTest invalid("{\"unit\": \"days\", \"events\": []}");
+	CHECK(invalid.status == false);
+}
+
+TEST_CASE("test LoadJson trailing data")
+{
+	LoadTest test("{\"events\": [{\"label\": \"label\", \
+			\"start\": \"1970-01-01T00:00:01\", \
+			\"end\": \"1970-01-01T00:00:03\"}]} garbage");
+	CHECK(test.status == false);
+	CHECK(test.data.size() == 1);
+}
+
 TEST_CASE("test LoadJson missing style field")
 {
 	LoadTest test("{\"events\": [], \
@@ -118,6 +1848,385 @@ TEST_CASE("test LoadJson missing style field")
 	CHECK(test.styles.has_style("example") == false);
 }
 
+static std::string
+parallel_test_json(size_t size, const std::string& tail)
+{
+	std::string json("{\"events\": [");
+	for (int i = 0; json.size() < size; i++) {
+		int sec = 59 - i % 60;
+		std::string ts = std::string("1970-01-01T00:00:")
+			+ (sec < 10 ? "0" : "") + std::to_string(sec);
+		json += std::string(i ? ", " : "")
+			+ "{\"label\": \"e" + std::to_string(i) + " ],{\\\"\", "
+			+ "\"start\": \"" + ts + "\", \"end\": \"" + ts + "\", "
+			+ "\"style\": \"s" + std::to_string(i % 3) + "\", "
+			+ "\"steps\": [{\"label\": \"step\", \"start\": \""
+			+ ts + "\", \"end\": \"" + ts + "\"}]}";
+	}
+	json += tail;
+	json += "], \"styles\": [{\"name\": \"s1\", \"fg\": \"#112233\"}]}";
+	return json;
+}
+
+TEST_CASE("test LoadJson parallel")
+{
+	std::string json = parallel_test_json(tmln::PARALLEL_LOAD_MIN * 3, "");
+	tmln::Styles styles, par_styles;
+	tmln::VectorData data("memory"), par_data("memory");
+	tmln::LoadJson load(data, styles, 1);
+	tmln::LoadJson par_load(par_data, par_styles, 3);
+	CHECK(load.load(json) == true);
+	CHECK(par_load.load(json) == true);
+	CHECK(data.size() > 1000);
+	REQUIRE(par_data.size() == data.size());
+	bool equal = true;
+	for (size_t i = 0; i < data.size() && equal; i++) {
+		equal = data[i].label() == par_data[i].label()
+			&& data[i].start() == par_data[i].start()
+			&& data[i].steps().size() == par_data[i].steps().size()
+			&& data[i].style() == par_data[i].style();
+	}
+	CHECK(equal);
+	CHECK(par_data[0].label().substr(par_data[0].label().find(' '))
+	      == " ],{\"");
+	CHECK(par_styles.get_style("s1").fg() == tmln::Color(255, 17, 34, 51));
+
+	// steps kept raw by the chunks are parsed the same
+	tmln::Styles raw_styles;
+	tmln::ColumnarData raw_data("memory",
+				    tmln::ColumnarData::STEP_COMPACT,
+				    &raw_styles);
+	tmln::LoadJson raw_load(raw_data, raw_styles, 3);
+	CHECK(raw_load.load(json) == true);
+	REQUIRE(raw_data.size() == data.size());
+	CHECK(raw_data.num_steps() == 0);
+	for (size_t i = 0; i < data.size() && equal; i++) {
+		const tmln::Event& event = raw_data[i];
+		equal = data[i].label() == event.label()
+			&& data[i].steps() == event.steps();
+	}
+	CHECK(equal);
+}
+
+TEST_CASE("test LoadJson parallel errors")
+{
+	std::string json = parallel_test_json(tmln::PARALLEL_LOAD_MIN * 3,
+					      ", {\"label\": }");
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	tmln::LoadJson load(data, styles, 3);
+	CHECK(load.load(json) == false);
+	CHECK(data.size() > 1000);
+
+	json = parallel_test_json(tmln::PARALLEL_LOAD_MIN * 3, ", ");
+	tmln::VectorData trailing("memory");
+	tmln::LoadJson trailing_load(trailing, styles, 3);
+	CHECK(trailing_load.load(json) == false);
+}
+
+class CancelledData : public tmln::VectorData {
+public:
+	CancelledData()
+		: tmln::VectorData("cancelled")
+	{
+	}
+
+	virtual bool cancelled() const override { return true; }
+};
+
+TEST_CASE("test LoadJson cancelled")
+{
+	std::string json = parallel_test_json(tmln::PARALLEL_LOAD_MIN * 3, "");
+	tmln::Styles styles;
+	CancelledData data, par_data;
+	tmln::LoadJson load(data, styles, 1);
+	tmln::LoadJson par_load(par_data, styles, 3);
+	CHECK(load.load(json) == false);
+	CHECK(data.size() == 0);
+	CHECK(par_load.load(json) == false);
+	CHECK(par_data.size() == 0);
+}
+
+TEST_CASE("test LoadJson ndjson")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	tmln::LoadJson load(data, styles);
+	CHECK(load.load_ndjson("{\"label\": \"b\", \"start\": 3, "
+			       "\"end\": 4, \"style\": \"s\"}\n"
+			       "\r\n"
+			       "{\"label\": \"a\", \"start\": 1, \"dur\": 1,"
+			       " \"steps\": [{\"label\": \"x\", "
+			       "\"start\": 1, \"end\": 2}]}\n"
+			       "{\"type\": \"style\", \"name\": \"s\", "
+			       "\"fg\": \"#112233\"}\n"
+			       "{\"type\": \"marker\", \"label\": \"m\"}\n"
+			       "{\"label\": \"c\", \"start\": 5, \"end\": 6}")
+	      == true);
+	REQUIRE(data.size() == 3);
+	CHECK(data[0].label() == "a");
+	CHECK(data[0].steps().size() == 1);
+	CHECK(data[1].label() == "b");
+	CHECK(data[1].style().fg() == tmln::Color(255, 17, 34, 51));
+	CHECK(data[2].label() == "c");
+
+	CHECK(load.load_ndjson("{\"label\": \"d\", \"start\": 7, "
+			       "\"end\": 8}\n[1]\n{\"label\"\n") == false);
+	CHECK(data.size() == 4);
+}
+
+TEST_CASE("test LoadJson ndjson parallel")
+{
+	std::string ndjson;
+	for (int i = 0; ndjson.size() < tmln::PARALLEL_LOAD_MIN * 3; i++) {
+		std::string num = std::to_string(i);
+		ndjson += "{\"label\": \"e" + num + "\", \"start\": " + num
+			+ ", \"dur\": 1, \"style\": \"s" + std::to_string(i % 5)
+			+ "\"}\n";
+		if (i % 1000 == 999) {
+			ndjson += "invalid\n";
+		}
+	}
+	ndjson += "{\"type\": \"style\", \"name\": \"s1\", "
+		"\"fg\": \"#112233\"}\n";
+
+	tmln::Styles styles, par_styles;
+	tmln::ColumnarData data("memory"), par_data("memory");
+	tmln::LoadJson load(data, styles, 1);
+	tmln::LoadJson par_load(par_data, par_styles, 3);
+	CHECK(load.load_ndjson(ndjson) == false);
+	CHECK(par_load.load_ndjson(ndjson) == false);
+	CHECK(data.size() > 1000);
+	REQUIRE(par_data.size() == data.size());
+	bool equal = true;
+	for (size_t i = 0; i < data.size() && equal; i++) {
+		equal = data[i].label() == par_data[i].label()
+			&& data[i].start() == par_data[i].start()
+			&& data[i].style() == par_data[i].style();
+	}
+	CHECK(equal);
+	CHECK(par_data[1].style().fg() == tmln::Color(255, 17, 34, 51));
+
+	tmln::Styles stream_styles;
+	tmln::ColumnarData stream_data("memory");
+	tmln::LoadJson stream_load(stream_data, stream_styles, 1);
+	std::istringstream is(ndjson);
+	CHECK(stream_load.load_ndjson(is) == false);
+	REQUIRE(stream_data.size() == data.size());
+	CHECK(stream_data[data.size() - 1].label()
+	      == data[data.size() - 1].label());
+	CHECK(stream_data[1].style().fg() == tmln::Color(255, 17, 34, 51));
+}
+
+// tmln_load_ninja
+
+TEST_CASE("test LoadNinja")
+{
+	std::string log("# ninja log v5\n"
+			"0\t100\t0\told.o\taaaa\n"
+			"0\t50\t0\ta.o\t1111\n"
+			"10\t60\t0\tb.o\t2222\n"
+			"10\t60\t0\tb.d\t2222\n"
+			"60\t80\t0\td.o\t4444\r\n"
+			"55\t90\t0\tc.o\t3333\n"
+			"95\t120\t0\tlink\t5555\n");
+	CHECK(tmln::LoadNinja::is_ninja_log(log.data(), log.size()));
+
+	tmln::Styles styles;
+	ProgressData data;
+	tmln::LoadNinja load(data, styles);
+	CHECK(load.load(log) == true);
+	CHECK(data.bytes == log.size());
+	REQUIRE(data.size() == 2);
+
+	const tmln::Event& job0 = data[0];
+	CHECK(job0.label() == "job 0");
+	REQUIRE(job0.steps().size() == 2);
+	CHECK(job0.steps()[0].label() == "a.o");
+	CHECK(job0.steps()[1].label() == "c.o");
+	CHECK(job0.end() == tmln::Ts(0, 90000000));
+
+	const tmln::Event& job1 = data[1];
+	REQUIRE(job1.steps().size() == 3);
+	CHECK(job1.steps()[0].label() == "b.o b.d");
+	CHECK(job1.steps()[0].info() == "2222");
+	CHECK(job1.steps()[1].label() == "d.o");
+	CHECK(job1.steps()[2].label() == "link");
+	CHECK(job1.start() == tmln::Ts(0, 10000000));
+	CHECK(job1.end() == tmln::Ts(0, 120000000));
+
+	tmln::ColumnarData stream_data("memory");
+	tmln::LoadNinja stream_load(stream_data, styles);
+	std::istringstream is(log);
+	CHECK(stream_load.load(is) == true);
+	REQUIRE(stream_data.size() == 2);
+	CHECK(stream_data[1].steps().size() == 3);
+}
+
+TEST_CASE("test LoadNinja invalid")
+{
+	tmln::Styles styles;
+	tmln::VectorData data("memory");
+	tmln::LoadNinja load(data, styles);
+	CHECK(load.load("# ninja log v4\n") == false);
+	std::istringstream is("# ninja log v4\n1\t2\t0\tx\ty\n");
+	CHECK(load.load(is) == false);
+	CHECK(load.load("# ninja log v5\n1\t2\n3\t4\t0\tx\ty\n") == false);
+	CHECK(data.size() == 1);
+}
+
+// tmln_snapshot
+
+TEST_CASE("test snapshot write and MmapData")
+{
+	const char* path = "test_snapshot.tmlnb";
+	tmln::Styles styles;
+	styles.add_style(tmln::Style("example", tmln::Color("#112233"),
+				     tmln::Color("#0000ff")));
+	tmln::VectorData data("memory");
+	tmln::StringPool& strings = data.strings();
+	tmln::EventBuilder builder =
+		data.emplace_event(strings.intern("event"),
+				   strings.intern("info"),
+				   tmln::Ts(1, 0), tmln::Ts(3, 0),
+				   styles.get_style("example"));
+	builder.add_step(strings.intern("step"), strings.intern(""),
+			 tmln::Ts(1, 0), tmln::Ts(2, 0),
+			 styles.default_style());
+	data.emplace_event(strings.intern("event"), strings.intern(""),
+			   tmln::Ts(2, 0), tmln::Ts(5, 0),
+			   styles.get_style("red"));
+	CHECK(tmln::write_snapshot(data, path) == true);
+
+	tmln::Styles mmap_styles;
+	tmln::MmapData mmap_data(path, mmap_styles);
+	CHECK(mmap_data.is_open() == true);
+	CHECK(mmap_data.size() == 2);
+	CHECK(mmap_data.span() == data.span());
+	CHECK(mmap_data.event_span(1) == data.event_span(1));
+	CHECK(mmap_data[0].label() == "event");
+	CHECK(mmap_data[0].info() == "info");
+	CHECK(&mmap_data[0].label() == &mmap_data[1].label());
+	CHECK(mmap_data[0].style() == styles.get_style("example"));
+	CHECK(mmap_data[0].steps().size() == 1);
+	CHECK(mmap_data[0].steps()[0].label() == "step");
+	CHECK(mmap_data[0].steps()[0].end() == tmln::Ts(2, 0));
+	CHECK(mmap_data[1].style().name() == "red");
+	CHECK(mmap_styles.has_style("example") == true);
+	std::remove(path);
+}
+
+TEST_CASE("test snapshot empty data")
+{
+	const char* path = "test_snapshot_empty.tmlnb";
+	tmln::ColumnarData data("memory");
+	data.finalize();
+	REQUIRE(tmln::write_snapshot(data, path) == true);
+
+	tmln::Styles styles;
+	tmln::MmapData mmap_data(path, styles);
+	CHECK(mmap_data.is_open() == true);
+	CHECK(mmap_data.size() == 0);
+	std::remove(path);
+}
+
+TEST_CASE("test MmapData invalid file")
+{
+	tmln::Styles styles;
+	tmln::MmapData missing("does-not-exist.tmlnb", styles);
+	CHECK(missing.is_open() == false);
+	CHECK(missing.size() == 0);
+}
+
+// tmln_sort
+
+TEST_CASE("test parallel_sort")
+{
+	std::vector<int> values;
+	for (size_t i = 0; i < 3 * tmln::PARALLEL_SORT_MIN; i++) {
+		values.push_back((i * 7919) % 10007);
+	}
+	std::vector<int> expected(values);
+	std::sort(expected.begin(), expected.end());
+
+	tmln::parallel_sort(values.begin(), values.end(), std::less<int>(), 3);
+	CHECK(values == expected);
+}
+
+// tmln_string_pool
+
+TEST_CASE("test StringPool")
+{
+	tmln::StringPool pool;
+	CHECK(pool.size() == 1);
+	CHECK(pool.str(0) == "");
+	tmln::StrId id = pool.intern_id("fetch");
+	CHECK(id == 1);
+	CHECK(pool.intern_id(std::string("fetch")) == id);
+	CHECK(pool.intern("fetch").id() == id);
+	CHECK(pool.intern("fetch") == pool.ref(id));
+	CHECK(pool.ref(id).str() == "fetch");
+	CHECK(&pool.ref(id).str() == &pool.str(id));
+	CHECK(pool.intern_id("link") == 2);
+	CHECK(pool.size() == 3);
+	CHECK(pool.intern("fetch") != pool.intern("link"));
+
+	tmln::StringPool other;
+	other.intern_id("link");
+	CHECK(other.intern("fetch").id() != id);
+	CHECK(other.intern("fetch") == pool.intern("fetch"));
+	CHECK(other.intern("link") != pool.intern("fetch"));
+}
+
+// tmln_style
+
+TEST_CASE("test Styles ids")
+{
+	tmln::Styles styles;
+	CHECK(styles.default_style().id() == 0);
+	CHECK(&styles.style(0) == &styles.default_style());
+
+	tmln::StyleId black = styles.get_style("black").id();
+	CHECK(black != 0);
+	CHECK(styles.style(black).name() == "black");
+
+	// referenced before added, bound to the same id
+	tmln::StyleId late = styles.ref_id("late");
+	CHECK(styles.has_style("late") == false);
+	CHECK(styles.style(late).fg() == styles.default_style().fg());
+	styles.add_style(tmln::Style("late", tmln::Color("#112233"),
+				     tmln::Color("white")));
+	CHECK(styles.ref_id("late") == late);
+	CHECK(styles.has_style("late") == true);
+	CHECK(styles.style(late).fg() == tmln::Color(255, 17, 34, 51));
+
+	tmln::StyleId color = styles.ref_id("#445566");
+	CHECK(styles.style(color).fg() == tmln::Color(255, 68, 85, 102));
+	CHECK(styles.size() == color + 1u);
+}
+
+TEST_CASE("test ColumnarData style ids")
+{
+	tmln::Styles styles, other;
+	tmln::ColumnarData data("memory");
+	tmln::StringPool& strings = data.strings();
+	const tmln::Style& red = styles.get_style("red");
+	data.emplace_event(strings.intern("a"), strings.intern(""),
+			   tmln::Ts(1, 0), tmln::Ts(2, 0), red);
+	CHECK(data.style_id(0) == red.id());
+
+	// same id in another palette
+	const tmln::Style& blue = other.get_style("blue");
+	const tmln::Style& other_red = other.get_style("red");
+	data.emplace_event(strings.intern("b"), strings.intern(""),
+			   tmln::Ts(2, 0), tmln::Ts(3, 0), other_red);
+	data.emplace_event(strings.intern("c"), strings.intern(""),
+			   tmln::Ts(3, 0), tmln::Ts(4, 0), blue);
+	CHECK(&data[0].style() == &red);
+	CHECK(&data[1].style() == &other_red);
+	CHECK(&data[2].style() == &blue);
+}
+
 // tmln_time, Ts
 
 TEST_CASE("test Ts")
@@ -127,6 +2236,77 @@ TEST_CASE("test Ts")
 	CHECK(tmln::Ts(20, 10000000) == tmln::Ts("1970-01-01T00:00:20.010"));
 }
 
+TEST_CASE("test Ts ns")
+{
+	static_assert(sizeof(tmln::Ts) == sizeof(int64_t), "Ts not compact");
+	static_assert(tmln::Ts(1, 5) < tmln::Ts(2, 0), "Ts not constexpr");
+
+	CHECK(tmln::Ts(2, 20).ns() == 2000000020);
+	CHECK(tmln::Ts::from_ns(2000000020) == tmln::Ts(2, 20));
+	CHECK(tmln::Ts::from_ns(2000000020).sec() == 2);
+	CHECK(tmln::Ts::from_ns(2000000020).nsec() == 20);
+	CHECK(tmln::Ts::from_ns(-1).sec() == -1);
+	CHECK(tmln::Ts::from_ns(-1).nsec() == 999999999);
+	CHECK(tmln::TsSpan(tmln::Ts(1, 0), tmln::Ts(3, 5)).ns() == 2000000005);
+}
+
+TEST_CASE("test Ts parse_iso8601")
+{
+	const char* valid[] = {
+		"2022-01-24T15:40:50",
+		"2022-01-24T15:40:50.332",
+		"2000-02-29T23:59:59.123456789",
+		"1969-12-31T23:59:59.5",
+		"1600-03-01T00:00:00",
+		nullptr
+	};
+	for (const char** str = valid; *str; str++) {
+		tmln::Ts ts;
+		CHECK(tmln::Ts::parse_iso8601(*str, strlen(*str), ts) == true);
+		CHECK(ts == tmln::Ts::parse_strptime(*str));
+	}
+
+	tmln::Ts ts;
+	const char* frac = "1970-01-01T00:00:01.1234567891";
+	CHECK(tmln::Ts::parse_iso8601(frac, strlen(frac), ts) == true);
+	CHECK(ts == tmln::Ts(1, 123456789));
+	CHECK(tmln::Ts("1970-01-01T00:00:01Z") == tmln::Ts(1, 0));
+	CHECK(tmln::Ts("1970-01-01T02:00:01+02:00") == tmln::Ts(1, 0));
+	CHECK(tmln::Ts("1970-01-01T00:00:01.5-0130") == tmln::Ts(5401, 500000000));
+
+	const char* invalid[] = {
+		"", "2022-01-24", "2022-1-24T15:40:50", "2022-13-24T15:40:50",
+		"2022-01-24T15:40:50.", "2022-01-24T15:40:50+2",
+		"2022-01-24T15:40:50 ", nullptr
+	};
+	for (const char** str = invalid; *str; str++) {
+		CHECK(tmln::Ts::parse_iso8601(*str, strlen(*str), ts) == false);
+	}
+}
+
+TEST_CASE("test Ts parse_number")
+{
+	tmln::Ts ts;
+	CHECK(tmln::Ts::parse_number("12", tmln::NSEC_PER_SEC, ts) == true);
+	CHECK(ts == tmln::Ts(12, 0));
+	CHECK(tmln::Ts::parse_number("-1.5", 1000, ts) == true);
+	CHECK(ts == tmln::Ts::from_ns(-1500));
+	CHECK(tmln::Ts::parse_number(".5", tmln::NSEC_PER_SEC, ts) == true);
+	CHECK(ts == tmln::Ts(0, 500000000));
+	CHECK(tmln::Ts::parse_number("1e3", 1, ts) == true);
+	CHECK(ts == tmln::Ts::from_ns(1000));
+
+	const char* end;
+	CHECK(tmln::Ts::parse_number("3ms", 1, ts, end) == true);
+	CHECK(std::string(end) == "ms");
+
+	const char* invalid[] = {"", "-", "abc", ".", "-.", "1x", "12 ",
+				 nullptr};
+	for (const char** str = invalid; *str; str++) {
+		CHECK(tmln::Ts::parse_number(*str, 1, ts) == false);
+	}
+}
+
 TEST_CASE("test Ts.to_sec")
 {
 	CHECK(tmln::Ts(0, 0).to_sec() == 0.0);